@@ -0,0 +1,212 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include "AnalyticMemory.h"
+#include "Checkpoint.h"
+
+using namespace std;
+
+namespace HybridSim
+{
+	AnalyticMemory::AnalyticMemory(string name, uint64_t read_latency, uint64_t write_latency, uint64_t transfer_cycles,
+			uint64_t channels, uint64_t queue_depth, uint64_t transfer_size)
+	{
+		if ((channels == 0) || (queue_depth == 0) || (transfer_size == 0))
+		{
+			cerr << "ERROR: Analytic " << name << " model needs at least one channel, a queue depth, and a transfer size.\n";
+			abort();
+		}
+
+		this->name = name;
+		this->read_latency = read_latency;
+		this->write_latency = write_latency;
+		this->transfer_cycles = transfer_cycles;
+		this->num_channels = channels;
+		this->queue_depth = queue_depth;
+		this->transfer_size = transfer_size;
+
+		currentClockCycle = 0;
+		channel_free = vector<uint64_t>(num_channels, 0);
+		outstanding = 0;
+		next_seq = 0;
+
+		ReadDone = NULL;
+		CriticalLine = NULL;
+		WriteDone = NULL;
+
+		num_reads = 0;
+		num_writes = 0;
+		num_rejected = 0;
+		sum_channel_wait = 0;
+	}
+
+	bool AnalyticMemory::addTransaction(bool isWrite, uint64_t addr, uint64_t id)
+	{
+		if (outstanding >= queue_depth)
+		{
+			num_rejected++;
+			return false;
+		}
+
+		// Start the transfer as soon as the channel is free.
+		uint64_t channel = (addr / transfer_size) % num_channels;
+		uint64_t start = (channel_free[channel] > currentClockCycle) ? channel_free[channel] : currentClockCycle;
+		channel_free[channel] = start + transfer_cycles;
+		sum_channel_wait += start - currentClockCycle;
+		outstanding++;
+
+		if (isWrite)
+		{
+			num_writes++;
+			events.push(AnalyticEvent(start + write_latency + transfer_cycles, next_seq++, ANALYTIC_WRITE_DONE, addr, id));
+		}
+		else
+		{
+			num_reads++;
+			events.push(AnalyticEvent(start + read_latency, next_seq++, ANALYTIC_CRITICAL_LINE, addr, id));
+			events.push(AnalyticEvent(start + read_latency + transfer_cycles, next_seq++, ANALYTIC_READ_DONE, addr, id));
+		}
+
+		return true;
+	}
+
+	uint64_t AnalyticMemory::quietUpdates()
+	{
+		// A transaction added from now on makes its first callback at least this many cycles later.
+		uint64_t quiet = (read_latency < write_latency + transfer_cycles) ? read_latency : write_latency + transfer_cycles;
+
+		// The next event is handled by update() when currentClockCycle reaches its cycle.
+		if (!events.empty() && (events.top().cycle - currentClockCycle < quiet))
+			quiet = events.top().cycle - currentClockCycle;
+		return quiet;
+	}
+
+	void AnalyticMemory::update()
+	{
+		while (!events.empty() && (events.top().cycle <= currentClockCycle))
+		{
+			AnalyticEvent e = events.top();
+			events.pop();
+
+			if (e.type == ANALYTIC_CRITICAL_LINE)
+			{
+				if (CriticalLine != NULL)
+					(*CriticalLine)(e.id, e.addr, currentClockCycle);
+			}
+			else if (e.type == ANALYTIC_READ_DONE)
+			{
+				outstanding--;
+				if (ReadDone != NULL)
+					(*ReadDone)(e.id, e.addr, currentClockCycle);
+			}
+			else
+			{
+				outstanding--;
+				if (WriteDone != NULL)
+					(*WriteDone)(e.id, e.addr, currentClockCycle);
+			}
+		}
+
+		step();
+	}
+
+	void AnalyticMemory::RegisterCallbacks(BackendCompleteCB *readDone, BackendCompleteCB *criticalLine, BackendCompleteCB *writeDone)
+	{
+		ReadDone = readDone;
+		CriticalLine = criticalLine;
+		WriteDone = writeDone;
+	}
+
+	void AnalyticMemory::saveStats()
+	{
+		cerr << "Analytic " << name << " reads: " << num_reads << "\n";
+		cerr << "Analytic " << name << " writes: " << num_writes << "\n";
+		cerr << "Analytic " << name << " rejected adds: " << num_rejected << "\n";
+		cerr << "Analytic " << name << " average channel wait: " 
+			<< ((num_reads + num_writes) ? ((double)sum_channel_wait / (num_reads + num_writes)) : 0.0) << " cycles\n";
+	}
+
+	void AnalyticMemory::saveCheckpoint(ostream &out)
+	{
+		checkpoint_section(out, "analytic_" + name);
+		checkpoint_write(out, currentClockCycle);
+		checkpoint_write(out, channel_free);
+		checkpoint_write(out, outstanding);
+		checkpoint_write(out, next_seq);
+		checkpoint_write(out, num_reads);
+		checkpoint_write(out, num_writes);
+		checkpoint_write(out, num_rejected);
+		checkpoint_write(out, sum_channel_wait);
+
+		// Events are popped in (cycle, seq) order no matter how they were pushed, so any order works here.
+		priority_queue<AnalyticEvent> copy = events;
+		out << copy.size() << "\n";
+		while (!copy.empty())
+		{
+			AnalyticEvent e = copy.top();
+			copy.pop();
+			out << e.cycle << " " << e.seq << " " << e.type << " " << e.addr << " " << e.id << "\n";
+		}
+	}
+
+	void AnalyticMemory::loadCheckpoint(istream &in)
+	{
+		checkpoint_expect(in, "analytic_" + name);
+		checkpoint_read(in, currentClockCycle);
+		checkpoint_read(in, channel_free);
+		checkpoint_read(in, outstanding);
+		checkpoint_read(in, next_seq);
+		checkpoint_read(in, num_reads);
+		checkpoint_read(in, num_writes);
+		checkpoint_read(in, num_rejected);
+		checkpoint_read(in, sum_channel_wait);
+
+		if (channel_free.size() != num_channels)
+		{
+			cerr << "ERROR: Analytic " << name << " checkpoint has " << channel_free.size() << " channels but the ini file has " 
+				<< num_channels << ".\n";
+			abort();
+		}
+
+		uint64_t num_events;
+		checkpoint_read(in, num_events);
+		events = priority_queue<AnalyticEvent>();
+		for (uint64_t i = 0; i < num_events; i++)
+		{
+			uint64_t cycle, seq, type, addr, id;
+			checkpoint_read(in, cycle);
+			checkpoint_read(in, seq);
+			checkpoint_read(in, type);
+			checkpoint_read(in, addr);
+			checkpoint_read(in, id);
+			events.push(AnalyticEvent(cycle, seq, (AnalyticEventType) type, addr, id));
+		}
+	}
+}
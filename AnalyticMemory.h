@@ -0,0 +1,119 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_ANALYTICMEMORY_H
+#define HYBRIDSIM_ANALYTICMEMORY_H
+
+#include <iostream>
+#include <queue>
+
+#include "MemoryBackend.h"
+
+namespace HybridSim
+{
+	// AnalyticMemory is a fixed latency plus bandwidth queue model of a memory.
+	// It is much faster than DRAMSim or NVDIMMSim and is meant for first pass design space
+	// sweeps where latency/bandwidth level fidelity is enough.
+	//
+	// Addresses are interleaved across channels in units of transfer_size bytes. Each channel
+	// can start one transfer every transfer_cycles cycles (this is what limits bandwidth). A
+	// transaction completes latency + transfer_cycles cycles after its transfer starts.
+	// For reads, the critical line callback happens after latency cycles (when the first data
+	// is back), so critical line first still works with the analytic flash. The callbacks return the
+	// id given to addTransaction().
+	class AnalyticMemory: public MemoryBackend, public SimulatorObject
+	{
+		public:
+		AnalyticMemory(string name, uint64_t read_latency, uint64_t write_latency, uint64_t transfer_cycles,
+				uint64_t channels, uint64_t queue_depth, uint64_t transfer_size);
+
+		bool addTransaction(bool isWrite, uint64_t addr, uint64_t id);
+		bool returnsIds() { return true; }
+		uint64_t quietUpdates();
+		uint64_t freeSlots() { return queue_depth - outstanding; }
+		void update();
+		void RegisterCallbacks(BackendCompleteCB *readDone, BackendCompleteCB *criticalLine, BackendCompleteCB *writeDone);
+		void saveStats();
+		void saveCheckpoint(ostream &out);
+		void loadCheckpoint(istream &in);
+
+		enum AnalyticEventType
+		{
+			ANALYTIC_CRITICAL_LINE,
+			ANALYTIC_READ_DONE,
+			ANALYTIC_WRITE_DONE
+		};
+
+		class AnalyticEvent
+		{
+			public:
+			uint64_t cycle;
+			uint64_t seq; // Breaks ties so events on the same cycle happen in the order they were scheduled.
+			AnalyticEventType type;
+			uint64_t addr;
+			uint64_t id;
+
+			AnalyticEvent(uint64_t c, uint64_t s, AnalyticEventType t, uint64_t a, uint64_t i) : cycle(c), seq(s), type(t), addr(a), id(i) {}
+
+			// priority_queue is a max heap, so the comparison is reversed to pop the earliest event first.
+			bool operator<(const AnalyticEvent &e) const
+			{
+				if (cycle != e.cycle)
+					return cycle > e.cycle;
+				return seq > e.seq;
+			}
+		};
+
+		string name;
+		uint64_t read_latency;
+		uint64_t write_latency;
+		uint64_t transfer_cycles;
+		uint64_t num_channels;
+		uint64_t queue_depth;
+		uint64_t transfer_size;
+
+		vector<uint64_t> channel_free; // First cycle each channel can start a new transfer.
+		priority_queue<AnalyticEvent> events;
+		uint64_t outstanding; // Transactions accepted but not finished yet.
+		uint64_t next_seq;
+
+		BackendCompleteCB *ReadDone;
+		BackendCompleteCB *CriticalLine;
+		BackendCompleteCB *WriteDone;
+
+		// Stats
+		uint64_t num_reads;
+		uint64_t num_writes;
+		uint64_t num_rejected;
+		uint64_t sum_channel_wait;
+	};
+}
+
+#endif
@@ -0,0 +1,166 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include "BufferedWriter.h"
+
+using namespace std;
+
+namespace HybridSim
+{
+	BufferedWriter::BufferedWriter()
+	{
+		buffer_bytes = 0;
+		running = false;
+		busy = false;
+		done = false;
+	}
+
+	BufferedWriter::~BufferedWriter()
+	{
+		this->close();
+	}
+
+	uint64_t BufferedWriter::open(string filename, uint64_t buffer_bytes, bool append)
+	{
+		if (running)
+		{
+			cerr << "ERROR: BufferedWriter::open() called while " << this->filename << " is still open.\n";
+			abort();
+		}
+		if (buffer_bytes == 0)
+		{
+			cerr << "ERROR: BufferedWriter::open() called with a 0 byte buffer for " << filename << ".\n";
+			abort();
+		}
+
+		this->filename = filename;
+		file.open(filename.c_str(), ios_base::out | ios_base::binary | (append ? ios_base::app : ios_base::trunc));
+		if (!file.is_open())
+		{
+			cerr << "ERROR: HybridSim output file " << filename << " failed to open.\n";
+			abort();
+		}
+		file.seekp(0, ios_base::end);
+		uint64_t size = file.tellp();
+
+		this->buffer_bytes = buffer_bytes;
+		active.clear();
+		active.reserve(buffer_bytes);
+		full.clear();
+		full.reserve(buffer_bytes);
+
+		busy = false;
+		done = false;
+		running = true;
+		worker = std::thread(&BufferedWriter::run, this);
+
+		return size;
+	}
+
+	void BufferedWriter::put_uint64(uint64_t v)
+	{
+		char bytes[8];
+		for (int i = 0; i < 8; i++)
+			bytes[i] = (char)((v >> (8 * i)) & 0xFF);
+		this->write(bytes, 8);
+	}
+
+	void BufferedWriter::hand_off()
+	{
+		// Wait for the writer to finish the previous buffer, then give it this one.
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			while (busy)
+				cv.wait(guard);
+			full.swap(active);
+			busy = true;
+		}
+		cv.notify_all();
+		active.clear();
+	}
+
+	void BufferedWriter::flush()
+	{
+		if (!running)
+			return;
+
+		if (!active.empty())
+			this->hand_off();
+
+		std::unique_lock<std::mutex> guard(lock);
+		while (busy)
+			cv.wait(guard);
+	}
+
+	void BufferedWriter::close()
+	{
+		if (!running)
+			return;
+
+		this->flush();
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			done = true;
+		}
+		cv.notify_all();
+		worker.join();
+		running = false;
+		file.close();
+	}
+
+	void BufferedWriter::run()
+	{
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				while (!busy && !done)
+					cv.wait(guard);
+				if (!busy)
+					return;
+			}
+
+			file.write(&full[0], full.size());
+			file.flush();
+			if (!file.good())
+			{
+				cerr << "ERROR: Writing " << filename << " failed.\n";
+				abort();
+			}
+			full.clear();
+
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				busy = false;
+			}
+			cv.notify_all();
+		}
+	}
+}
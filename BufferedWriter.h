@@ -0,0 +1,92 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_BUFFEREDWRITER_H
+#define HYBRIDSIM_BUFFEREDWRITER_H
+
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "config.h"
+
+namespace HybridSim
+{
+	// BufferedWriter writes a file on a background thread, so the simulator only copies bytes into memory.
+	// It is shared by the outputs that can produce a record per access (the missed page record and the
+	// debug traces).
+	//
+	// Bytes are added to one of two fixed size buffers. When the active buffer is full it is handed to the
+	// writer thread and the other one becomes active. If the writer still has not finished the previous
+	// buffer, the simulator waits for it, so memory use is bounded by the two buffers. Nothing reaches the
+	// file until a buffer fills or flush() is called.
+	class BufferedWriter
+	{
+		public:
+		BufferedWriter();
+		~BufferedWriter();
+
+		// Open filename and start the writer thread. With append, the bytes are added to the end of an
+		// existing file. Returns the size the file had when it was opened (0 if it is new or truncated).
+		uint64_t open(string filename, uint64_t buffer_bytes, bool append);
+		void write(const char *data, size_t size)
+		{
+			active.insert(active.end(), data, data + size);
+			if (active.size() >= buffer_bytes)
+				this->hand_off();
+		}
+		void put_uint64(uint64_t v); // Little endian.
+		void flush(); // Wait until every byte so far is in the file.
+		void close(); // Flush and stop the writer thread.
+		bool is_open() { return running; }
+
+		// Writer thread body.
+		void run();
+
+		string filename;
+		uint64_t buffer_bytes;
+
+		vector<char> active; // Filled by the simulator.
+		vector<char> full; // Being written by the writer thread.
+
+		ofstream file; // Only touched by the writer thread while it is running.
+		std::thread worker;
+		std::mutex lock;
+		std::condition_variable cv;
+		bool running;
+		bool busy; // full is being written.
+		bool done; // Shut down the writer thread.
+
+		void hand_off();
+	};
+}
+
+#endif
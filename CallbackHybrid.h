@@ -82,6 +82,7 @@ private:
 };
 
 typedef CallbackBase <void, uint, uint64_t, uint64_t> TransactionCompleteCB;
+typedef CallbackBase <void, uint64_t, uint64_t, uint64_t> TransactionIdCompleteCB; // (transaction id, address, cycle)
 typedef CallbackBase <void, uint, vector<vector<double> >, uint64_t> FlashPowerCB;
 } // namespace HybridSim
 
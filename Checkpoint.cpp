@@ -0,0 +1,180 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include "Checkpoint.h"
+
+namespace HybridSim
+{
+	void checkpoint_section(ostream &out, string name)
+	{
+		out << name << "\n";
+	}
+
+	void checkpoint_expect(istream &in, string name)
+	{
+		string s;
+		in >> s;
+		if (s != name)
+		{
+			cerr << "ERROR: Bad checkpoint file. Expected section " << name << " but found \"" << s << "\"\n";
+			abort();
+		}
+	}
+
+	void checkpoint_write(ostream &out, const uint64_t &v)
+	{
+		out << v << "\n";
+	}
+
+	void checkpoint_read(istream &in, uint64_t &v)
+	{
+		in >> v;
+		if (in.fail())
+		{
+			cerr << "ERROR: Bad checkpoint file. Failed to read a number.\n";
+			abort();
+		}
+	}
+
+	void checkpoint_write(ostream &out, const pair<uint64_t, uint64_t> &v)
+	{
+		out << v.first << " " << v.second << "\n";
+	}
+
+	void checkpoint_read(istream &in, pair<uint64_t, uint64_t> &v)
+	{
+		checkpoint_read(in, v.first);
+		checkpoint_read(in, v.second);
+	}
+
+	void checkpoint_write(ostream &out, const cache_line &v)
+	{
+		out << v.valid << " " << v.dirty << " " << v.locked << " " << v.lock_count << " " << v.tag << " " << v.data << " " 
+			<< v.ts << " " << v.prefetched << " " << v.used << "\n";
+	}
+
+	void checkpoint_read(istream &in, cache_line &v)
+	{
+		uint64_t valid, dirty, locked, prefetched, used;
+		checkpoint_read(in, valid);
+		checkpoint_read(in, dirty);
+		checkpoint_read(in, locked);
+		checkpoint_read(in, v.lock_count);
+		checkpoint_read(in, v.tag);
+		checkpoint_read(in, v.data);
+		checkpoint_read(in, v.ts);
+		checkpoint_read(in, prefetched);
+		checkpoint_read(in, used);
+		v.valid = valid;
+		v.dirty = dirty;
+		v.locked = locked;
+		v.prefetched = prefetched;
+		v.used = used;
+	}
+
+	void checkpoint_write(ostream &out, const Pending &v)
+	{
+		out << v.op << " " << v.id << " " << v.orig_addr << " " << v.flash_addr << " " << v.cache_addr << " " << v.victim_tag << " " 
+			<< v.victim_valid << " " << v.callback_sent << " " << v.type << "\n";
+	}
+
+	void checkpoint_read(istream &in, Pending &v)
+	{
+		uint64_t op, victim_valid, callback_sent, type;
+		checkpoint_read(in, op);
+		checkpoint_read(in, v.id);
+		checkpoint_read(in, v.orig_addr);
+		checkpoint_read(in, v.flash_addr);
+		checkpoint_read(in, v.cache_addr);
+		checkpoint_read(in, v.victim_tag);
+		checkpoint_read(in, victim_valid);
+		checkpoint_read(in, callback_sent);
+		checkpoint_read(in, type);
+		v.op = (PendingOperation) op;
+		v.victim_valid = victim_valid;
+		v.callback_sent = callback_sent;
+		v.type = (TransactionType) type;
+	}
+
+	void checkpoint_write(ostream &out, const Transaction &v)
+	{
+		// The data pointer is not used by HybridSim, so it is not saved.
+		out << v.transactionType << " " << v.address << " " << v.id << "\n";
+	}
+
+	void checkpoint_read(istream &in, Transaction &v)
+	{
+		uint64_t type;
+		checkpoint_read(in, type);
+		checkpoint_read(in, v.address);
+		checkpoint_read(in, v.id);
+		v.transactionType = (TransactionType) type;
+		v.data = NULL;
+	}
+
+	void checkpoint_write(ostream &out, const StreamBuffer &v)
+	{
+		// The stride is written as its two's complement so that it is read back like every other number.
+		out << (uint64_t)v.stride << " " << v.depth << " " << v.last_prefetch << " " << v.cycle << "\n";
+	}
+
+	void checkpoint_read(istream &in, StreamBuffer &v)
+	{
+		uint64_t stride;
+		checkpoint_read(in, stride);
+		checkpoint_read(in, v.depth);
+		checkpoint_read(in, v.last_prefetch);
+		checkpoint_read(in, v.cycle);
+		v.stride = (int64_t)stride;
+	}
+
+	void checkpoint_write(ostream &out, const unordered_set<uint64_t> &v)
+	{
+		out << v.bucket_count() << " " << v.size() << "\n";
+		for (unordered_set<uint64_t>::const_iterator it = v.begin(); it != v.end(); it++)
+			out << (*it) << "\n";
+	}
+
+	void checkpoint_read(istream &in, unordered_set<uint64_t> &v)
+	{
+		uint64_t buckets, size;
+		checkpoint_read(in, buckets);
+		checkpoint_read(in, size);
+
+		vector<uint64_t> elements(size);
+		for (uint64_t i = 0; i < size; i++)
+			checkpoint_read(in, elements[i]);
+
+		v.clear();
+		v.rehash(buckets);
+		for (vector<uint64_t>::reverse_iterator it = elements.rbegin(); it != elements.rend(); it++)
+			v.insert(*it);
+	}
+}
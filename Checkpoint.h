@@ -0,0 +1,201 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_CHECKPOINT_H
+#define HYBRIDSIM_CHECKPOINT_H
+
+#include <iostream>
+#include <vector>
+
+#include "config.h"
+#include "LruTable.h"
+
+// Helpers for reading and writing checkpoints (see HybridSystem::saveCheckpoint).
+//
+// Checkpoints are plain text. Every section starts with its name so that a checkpoint written by
+// a different version of the simulator is caught right away instead of being silently misread.
+// Containers are written as their size followed by their elements.
+//
+// Unordered containers are also written with their bucket count and are read back in reverse
+// order into a table with the same bucket count. With libstdc++ this rebuilds the same iteration
+// order, which matters because the TLB victim search breaks ties by iteration order. Without it, a resumed run could pick a different victim than the original run.
+
+namespace HybridSim
+{
+	void checkpoint_section(ostream &out, string name);
+	void checkpoint_expect(istream &in, string name);
+
+	// Element types.
+	void checkpoint_write(ostream &out, const uint64_t &v);
+	void checkpoint_read(istream &in, uint64_t &v);
+	void checkpoint_write(ostream &out, const pair<uint64_t, uint64_t> &v);
+	void checkpoint_read(istream &in, pair<uint64_t, uint64_t> &v);
+	void checkpoint_write(ostream &out, const cache_line &v);
+	void checkpoint_read(istream &in, cache_line &v);
+	void checkpoint_write(ostream &out, const Pending &v);
+	void checkpoint_read(istream &in, Pending &v);
+	void checkpoint_write(ostream &out, const Transaction &v);
+	void checkpoint_read(istream &in, Transaction &v);
+	void checkpoint_write(ostream &out, const StreamBuffer &v);
+	void checkpoint_read(istream &in, StreamBuffer &v);
+	void checkpoint_write(ostream &out, const unordered_set<uint64_t> &v);
+	void checkpoint_read(istream &in, unordered_set<uint64_t> &v);
+
+	// Containers.
+	template <class T>
+	void checkpoint_write(ostream &out, const list<T> &v)
+	{
+		out << v.size() << "\n";
+		for (typename list<T>::const_iterator it = v.begin(); it != v.end(); it++)
+			checkpoint_write(out, *it);
+	}
+
+	template <class T>
+	void checkpoint_read(istream &in, list<T> &v)
+	{
+		uint64_t size;
+		checkpoint_read(in, size);
+		v.clear();
+		for (uint64_t i = 0; i < size; i++)
+		{
+			T e;
+			checkpoint_read(in, e);
+			v.push_back(e);
+		}
+	}
+
+	template <class T>
+	void checkpoint_write(ostream &out, const vector<T> &v)
+	{
+		out << v.size() << "\n";
+		for (size_t i = 0; i < v.size(); i++)
+			checkpoint_write(out, v[i]);
+	}
+
+	template <class T>
+	void checkpoint_read(istream &in, vector<T> &v)
+	{
+		uint64_t size;
+		checkpoint_read(in, size);
+		v.clear();
+		for (uint64_t i = 0; i < size; i++)
+		{
+			T e;
+			checkpoint_read(in, e);
+			v.push_back(e);
+		}
+	}
+
+	template <class T>
+	void checkpoint_write(ostream &out, const set<T> &v)
+	{
+		out << v.size() << "\n";
+		for (typename set<T>::const_iterator it = v.begin(); it != v.end(); it++)
+			checkpoint_write(out, *it);
+	}
+
+	template <class T>
+	void checkpoint_read(istream &in, set<T> &v)
+	{
+		uint64_t size;
+		checkpoint_read(in, size);
+		v.clear();
+		for (uint64_t i = 0; i < size; i++)
+		{
+			T e;
+			checkpoint_read(in, e);
+			v.insert(e);
+		}
+	}
+
+	template <class T>
+	void checkpoint_write(ostream &out, const unordered_map<uint64_t, T> &v)
+	{
+		out << v.bucket_count() << " " << v.size() << "\n";
+		for (typename unordered_map<uint64_t, T>::const_iterator it = v.begin(); it != v.end(); it++)
+		{
+			out << (*it).first << " ";
+			checkpoint_write(out, (*it).second);
+		}
+	}
+
+	template <class T>
+	void checkpoint_read(istream &in, unordered_map<uint64_t, T> &v)
+	{
+		uint64_t buckets, size;
+		checkpoint_read(in, buckets);
+		checkpoint_read(in, size);
+
+		vector<pair<uint64_t, T> > elements;
+		for (uint64_t i = 0; i < size; i++)
+		{
+			pair<uint64_t, T> e;
+			checkpoint_read(in, e.first);
+			checkpoint_read(in, e.second);
+			elements.push_back(e);
+		}
+
+		v.clear();
+		v.rehash(buckets);
+		for (typename vector<pair<uint64_t, T> >::reverse_iterator it = elements.rbegin(); it != elements.rend(); it++)
+			v.insert(*it);
+	}
+
+	// LRU tables are written from the least to the most recently used entry, so inserting the entries in
+	// that order rebuilds the LRU order. The capacity comes from the ini file.
+	template <class T>
+	void checkpoint_write(ostream &out, const LruTable<T> &v)
+	{
+		out << v.size() << "\n";
+		for (int64_t i = v.oldest(); i != LruTable<T>::NONE; i = v.newer(i))
+		{
+			out << v.entry(i).key << " ";
+			checkpoint_write(out, v.entry(i).value);
+		}
+	}
+
+	template <class T>
+	void checkpoint_read(istream &in, LruTable<T> &v)
+	{
+		uint64_t size;
+		checkpoint_read(in, size);
+		v.clear();
+		for (uint64_t i = 0; i < size; i++)
+		{
+			uint64_t key;
+			T e;
+			checkpoint_read(in, key);
+			checkpoint_read(in, e);
+			v.insert(key, e, NULL);
+		}
+	}
+}
+
+#endif
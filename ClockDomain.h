@@ -0,0 +1,92 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_CLOCKDOMAIN_H
+#define HYBRIDSIM_CLOCKDOMAIN_H
+
+#include <stdint.h>
+
+namespace HybridSim
+{
+	// ClockDomain decides how many times a backend (DRAMSim or NVDIMM) should be updated on each
+	// controller cycle when the backend runs on a different clock than the controller.
+	// This is done with a fractional accumulator so no rounding error builds up over a long run.
+	// A frequency of 0 means the backend is updated exactly once per controller cycle (the
+	// original behavior). This is the only clock crossing: HybridSim never calls DRAMSim's
+	// setCPUClockSpeed(), so each DRAMSim update is one DRAM cycle.
+	class ClockDomain
+	{
+		public:
+		uint64_t frequency; // Backend clock in Hz (0 means same as the controller).
+		uint64_t controller_frequency; // CYCLES_PER_SECOND
+		uint64_t accumulator;
+		uint64_t backend_cycles; // Number of backend updates done so far.
+
+		ClockDomain() : frequency(0), controller_frequency(1), accumulator(0), backend_cycles(0) {}
+
+		ClockDomain(uint64_t freq, uint64_t controller_freq) : frequency(freq), controller_frequency(controller_freq),
+			accumulator(0), backend_cycles(0) {}
+
+		// Advance one controller cycle. Returns the number of backend updates to do on this cycle.
+		uint64_t tick()
+		{
+			if (frequency == 0)
+			{
+				backend_cycles++;
+				return 1;
+			}
+
+			accumulator += frequency;
+			uint64_t n = 0;
+			while (accumulator >= controller_frequency)
+			{
+				accumulator -= controller_frequency;
+				n++;
+			}
+			backend_cycles += n;
+			return n;
+		}
+
+		// Number of upcoming controller cycles that do no more than the given number of backend updates
+		// all together (used by the flash thread to turn MemoryBackend::quietUpdates() into cycles).
+		uint64_t quiet_cycles(uint64_t updates)
+		{
+			if (frequency == 0)
+				return updates;
+
+			// The largest k with (accumulator + k*frequency) / controller_frequency <= updates.
+			if (updates > (1ULL << 32))
+				updates = 1ULL << 32;
+			return ((updates + 1) * controller_frequency - accumulator - 1) / frequency;
+		}
+	};
+}
+
+#endif
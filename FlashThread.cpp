@@ -0,0 +1,313 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011,
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns,
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include "FlashThread.h"
+
+using namespace std;
+
+namespace HybridSim
+{
+	FlashThread::FlashThread(MemoryBackend *nv, ClockDomain clock, uint64_t start_cycle, TraceWriter *nvdimm_trace)
+	{
+		flash = nv;
+		flash_clock = clock;
+		debug_nvdimm_trace = nvdimm_trace;
+
+		sends = 0;
+		tentatives = 0;
+		events_taken = 0;
+
+		flash_cycle = start_cycle;
+		added = false;
+		adds = 0;
+		requests_taken = 0;
+
+		requests_sent = 0;
+		events_sent = 0;
+		input_done = start_cycle;
+		flash_done = start_cycle;
+		tentative_done = 0;
+		tentative_accepted = false;
+		controller_waiting = false;
+		flash_waiting = false;
+		done = false;
+
+		// Hook the NVDIMM callbacks so they are recorded on the flash thread instead of
+		// going straight into the controller.
+		typedef Callback <FlashThread, void, uint64_t, uint64_t, uint64_t> backend_callback_t;
+		nv_read_cb = new backend_callback_t(this, &FlashThread::ReadCallback);
+		nv_write_cb = new backend_callback_t(this, &FlashThread::WriteCallback);
+		nv_crit_cb = new backend_callback_t(this, &FlashThread::CriticalLineCallback);
+		flash->RegisterCallbacks(nv_read_cb, nv_crit_cb, nv_write_cb);
+
+		accept_limit = flash->freeSlots();
+		safe_cycle = start_cycle + flash_clock.quiet_cycles(flash->quietUpdates());
+
+		worker = std::thread(&FlashThread::run, this);
+	}
+
+	FlashThread::~FlashThread()
+	{
+		done = true;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			flash_cv.notify_one();
+		}
+		worker.join();
+
+		delete nv_read_cb;
+		delete nv_write_cb;
+		delete nv_crit_cb;
+	}
+
+	bool FlashThread::send(uint64_t cycle, bool isWrite, uint64_t address, uint64_t id)
+	{
+		// Read safe_cycle before accept_limit. accept_limit only goes up, so it is at least the value that
+		// was published with safe_cycle.
+		uint64_t safe = safe_cycle;
+		if (sends < accept_limit)
+		{
+			// The flash is certain to take it, so there is no need to wait.
+			requests_out.push_back(FlashRequest(cycle, isWrite, address, id, false));
+			sends++;
+			return true;
+		}
+
+		// The flash is full and nothing can finish (and free a slot) before safe_cycle, so it is certain to
+		// refuse it.
+		if (cycle < safe)
+			return false;
+
+		// Let the flash thread catch up and try it.
+		requests_out.push_back(FlashRequest(cycle, isWrite, address, id, true));
+		tentatives++;
+		publish_requests();
+		if (tentative_done < tentatives)
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			controller_waiting = true;
+			while (tentative_done < tentatives)
+				controller_cv.wait(guard);
+			controller_waiting = false;
+		}
+
+		if (!tentative_accepted)
+			return false;
+		sends++;
+		return true;
+	}
+
+	void FlashThread::publish_requests()
+	{
+		if (requests_out.empty())
+			return;
+
+		std::lock_guard<std::mutex> guard(lock);
+		requests_shared.insert(requests_shared.end(), requests_out.begin(), requests_out.end());
+		requests_sent += requests_out.size();
+		requests_out.clear();
+		if (flash_waiting)
+			flash_cv.notify_one();
+	}
+
+	void FlashThread::end_cycle(uint64_t cycle)
+	{
+		// Nothing more can be sent on this cycle, so the flash thread can simulate it.
+		publish_requests();
+		input_done = cycle + 1;
+		if (flash_waiting)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			flash_cv.notify_one();
+		}
+
+		// Wait until every callback the flash makes on this cycle is known.
+		if (safe_cycle <= cycle)
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			controller_waiting = true;
+			while (safe_cycle <= cycle)
+				controller_cv.wait(guard);
+			controller_waiting = false;
+		}
+
+		if (events_sent != events_taken)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			events_in.splice(events_in.end(), events_shared);
+			events_taken = events_sent;
+		}
+	}
+
+	bool FlashThread::next_event(uint64_t cycle, FlashEvent &e)
+	{
+		if (events_in.empty())
+			return false;
+
+		// If this fires, a backend made a callback it promised not to make (see MemoryBackend::quietUpdates()).
+		assert(events_in.front().cycle >= cycle);
+
+		// Events are stored in cycle order, so only the front needs to be checked.
+		if (events_in.front().cycle != cycle)
+			return false;
+
+		e = events_in.front();
+		events_in.pop_front();
+		return true;
+	}
+
+	void FlashThread::wait()
+	{
+		if (flash_done >= input_done)
+			return;
+
+		std::unique_lock<std::mutex> guard(lock);
+		controller_waiting = true;
+		while (flash_done < input_done)
+			controller_cv.wait(guard);
+		controller_waiting = false;
+	}
+
+	// The backend passes its own cycle count, which is in the flash clock domain. The events are
+	// stamped with the controller cycle instead so they can be applied on the right controller cycle.
+	void FlashThread::ReadCallback(uint64_t id, uint64_t addr, uint64_t cycle)
+	{
+		events_out.push_back(FlashEvent(FLASH_READ_DONE, id, addr, flash_cycle));
+	}
+
+	void FlashThread::CriticalLineCallback(uint64_t id, uint64_t addr, uint64_t cycle)
+	{
+		events_out.push_back(FlashEvent(FLASH_CRITICAL_LINE, id, addr, flash_cycle));
+	}
+
+	void FlashThread::WriteCallback(uint64_t id, uint64_t addr, uint64_t cycle)
+	{
+		events_out.push_back(FlashEvent(FLASH_WRITE_DONE, id, addr, flash_cycle));
+	}
+
+	void FlashThread::run()
+	{
+		while (!done)
+		{
+			// Read input_done first, since the requests for a finished cycle are sent before input_done moves.
+			uint64_t ready = input_done;
+			take_requests();
+
+			// Add the request the controller issued on this cycle (before the flash is updated, like the
+			// controller does).
+			if (!added && !requests_in.empty() && (requests_in.front().cycle == flash_cycle))
+				add_request();
+
+			if (ready > flash_cycle)
+			{
+				for (uint64_t i = flash_clock.tick(); i > 0; i--)
+					flash->update();
+				finish_cycle();
+				continue;
+			}
+
+			// Wait for the controller to finish the cycle or send a request.
+			std::unique_lock<std::mutex> guard(lock);
+			flash_waiting = true;
+			while ((!done) && (input_done <= flash_cycle) && (requests_sent == requests_taken))
+				flash_cv.wait(guard);
+			flash_waiting = false;
+		}
+	}
+
+	void FlashThread::take_requests()
+	{
+		if (requests_sent == requests_taken)
+			return;
+
+		std::lock_guard<std::mutex> guard(lock);
+		requests_in.insert(requests_in.end(), requests_shared.begin(), requests_shared.end());
+		requests_taken += requests_shared.size();
+		requests_shared.clear();
+	}
+
+	void FlashThread::add_request()
+	{
+		FlashRequest tmp = requests_in.front();
+		requests_in.pop_front();
+		added = true;
+
+		bool accepted = flash->addTransaction(tmp.isWrite, tmp.address, tmp.id);
+		if (accepted)
+		{
+			adds++;
+			if (debug_nvdimm_trace != NULL)
+				debug_nvdimm_trace->write(flash_cycle, tmp.isWrite, tmp.address);
+		}
+		else if (!tmp.tentative)
+		{
+			cerr << "ERROR: The flash backend did not accept a transaction it promised to accept (see MemoryBackend::freeSlots()).\n";
+			abort();
+		}
+		accept_limit = adds + flash->freeSlots();
+
+		if (tmp.tentative)
+		{
+			tentative_accepted = accepted;
+			tentative_done++;
+			wake_controller();
+		}
+	}
+
+	void FlashThread::finish_cycle()
+	{
+		if (!events_out.empty())
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			events_shared.insert(events_shared.end(), events_out.begin(), events_out.end());
+			events_sent += events_out.size();
+			events_out.clear();
+		}
+
+		flash_cycle++;
+		added = false;
+		accept_limit = adds + flash->freeSlots();
+		flash_done = flash_cycle;
+
+		// No callbacks will be made on the cycles the backend promises to be quiet for, even if the
+		// controller sends more requests.
+		safe_cycle = flash_cycle + flash_clock.quiet_cycles(flash->quietUpdates());
+		wake_controller();
+	}
+
+	void FlashThread::wake_controller()
+	{
+		if (controller_waiting)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			controller_cv.notify_one();
+		}
+	}
+}
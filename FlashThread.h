@@ -0,0 +1,167 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011,
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns,
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_FLASHTHREAD_H
+#define HYBRIDSIM_FLASHTHREAD_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "config.h"
+#include "MemoryBackend.h"
+#include "ClockDomain.h"
+#include "TraceWriter.h"
+
+namespace HybridSim
+{
+	// FlashThread steps the flash backend (NVDIMM or the analytic model) on its own host thread
+	// (FLASH_THREAD=1). The results are the same as stepping it on the controller thread.
+	//
+	// The flash thread simulates flash cycle c as soon as the controller has finished issuing on
+	// cycle c. Each request is added on the cycle the controller issued it and each callback is
+	// stamped with the controller cycle it was made on. The controller applies the callbacks at
+	// the end of that same cycle, so it only has to wait for the flash thread when it reaches a
+	// cycle the flash thread has not finished yet. It can run ahead without waiting while the
+	// backend promises that there will be no callbacks (MemoryBackend::quietUpdates()).
+	//
+	// The controller also needs to know on the cycle it issues a request whether the flash took
+	// it. It does not wait while the backend promises to accept it (MemoryBackend::freeSlots()).
+	// Otherwise it waits for the flash thread to catch up and try the request.
+	//
+	// The analytic flash makes both promises. NVDIMM does not, so with NVDIMM the two threads
+	// mostly take turns and the flash thread does not make the run faster.
+	class FlashThread
+	{
+		public:
+		enum FlashEventType
+		{
+			FLASH_READ_DONE,
+			FLASH_CRITICAL_LINE,
+			FLASH_WRITE_DONE
+		};
+
+		class FlashRequest
+		{
+			public:
+			uint64_t cycle; // Controller cycle the request left the flash_queue.
+			bool isWrite;
+			uint64_t address;
+			uint64_t id;
+			bool tentative; // The controller is waiting to find out if the flash takes it.
+
+			FlashRequest(uint64_t c, bool w, uint64_t a, uint64_t i, bool t) : cycle(c), isWrite(w), address(a), id(i), tentative(t) {}
+		};
+
+		class FlashEvent
+		{
+			public:
+			FlashEventType type;
+			uint64_t id;
+			uint64_t address;
+			uint64_t cycle; // Cycle the callback was made on (in controller cycles, not NVDIMM cycles).
+
+			FlashEvent() : type(FLASH_READ_DONE), id(0), address(0), cycle(0) {}
+			FlashEvent(FlashEventType t, uint64_t i, uint64_t a, uint64_t c) : type(t), id(i), address(a), cycle(c) {}
+		};
+
+		FlashThread(MemoryBackend *nv, ClockDomain clock, uint64_t start_cycle, TraceWriter *nvdimm_trace);
+		~FlashThread();
+
+		// Controller side interface.
+		// send() returns false if the flash did not take the request on this cycle (like MemoryBackend::addTransaction()).
+		bool send(uint64_t cycle, bool isWrite, uint64_t address, uint64_t id);
+		// end_cycle() is called once per controller cycle where the flash would be updated. It waits until all
+		// of the callbacks for the cycle are known, and next_event() then returns them in order.
+		void end_cycle(uint64_t cycle);
+		bool next_event(uint64_t cycle, FlashEvent &e);
+		// Wait until the flash thread has simulated every cycle the controller has finished.
+		void wait();
+
+		// NVDIMM callbacks (run on the flash thread).
+		void ReadCallback(uint64_t id, uint64_t addr, uint64_t cycle);
+		void CriticalLineCallback(uint64_t id, uint64_t addr, uint64_t cycle);
+		void WriteCallback(uint64_t id, uint64_t addr, uint64_t cycle);
+
+		void publish_requests();
+
+		// Flash thread body.
+		void run();
+		void take_requests();
+		void add_request();
+		void finish_cycle();
+		void wake_controller();
+
+		MemoryBackend *flash;
+		ClockDomain flash_clock; // Owned by the flash thread once it starts.
+		TraceWriter *debug_nvdimm_trace;
+		BackendCompleteCB *nv_read_cb;
+		BackendCompleteCB *nv_write_cb;
+		BackendCompleteCB *nv_crit_cb;
+
+		// Controller owned state (only touched by the controller thread).
+		vector<FlashRequest> requests_out; // Requests sent since the last end_cycle().
+		list<FlashEvent> events_in; // Callbacks waiting to be applied to the controller.
+		uint64_t sends; // Requests the flash has taken or is certain to take.
+		uint64_t tentatives; // Tentative requests sent.
+		uint64_t events_taken;
+
+		// Flash thread owned state (only touched by the flash thread).
+		list<FlashRequest> requests_in; // Requests for cycles the flash thread has not added yet.
+		vector<FlashEvent> events_out; // Callbacks made on the cycle being simulated.
+		uint64_t flash_cycle; // Cycle being simulated (in controller cycles).
+		bool added; // A request was already added on flash_cycle.
+		uint64_t adds; // Requests the flash has taken.
+		uint64_t requests_taken;
+
+		// Shared between the threads. The vectors are only touched with lock held.
+		std::mutex lock;
+		std::condition_variable controller_cv;
+		std::condition_variable flash_cv;
+		vector<FlashRequest> requests_shared;
+		list<FlashEvent> events_shared;
+		std::atomic<uint64_t> requests_sent; // Requests put in requests_shared so far.
+		std::atomic<uint64_t> events_sent; // Callbacks put in events_shared so far.
+		std::atomic<uint64_t> input_done; // Controller cycles finished + 1 (issuing for the cycle is done).
+		std::atomic<uint64_t> flash_done; // Flash cycles finished + 1.
+		std::atomic<uint64_t> safe_cycle; // All callbacks before this cycle are in events_shared.
+		std::atomic<uint64_t> accept_limit; // The flash is certain to take requests until it has taken this many.
+		std::atomic<uint64_t> tentative_done; // Tentative requests tried so far.
+		std::atomic<bool> tentative_accepted;
+		std::atomic<bool> controller_waiting;
+		std::atomic<bool> flash_waiting;
+		std::atomic<bool> done; // Shut down the flash thread.
+
+		std::thread worker;
+	};
+}
+
+#endif
@@ -52,15 +52,25 @@ namespace HybridSim
 		public:
 			HybridSystem(uint id, string ini);
 			bool addTransaction(bool isWrite, uint64_t addr);
+			bool addTransaction(bool isWrite, uint64_t addr, uint64_t &id);
 			bool WillAcceptTransaction();
 			void update();
 			void RegisterCallbacks(
 					TransactionCompleteCB *readDone,
 					TransactionCompleteCB *writeDone);
+			void RegisterIdCallbacks(
+					TransactionIdCompleteCB *readDone,
+					TransactionIdCompleteCB *writeDone);
 			void mmio(uint64_t operation, uint64_t address);
 			void syncAll();
 			void reportPower();
 			void printLogfile();
+			void setFunctional(uint64_t accesses);
+			bool isFunctional();
+			bool isQuiescent();
+			uint64_t drain();
+			void saveCheckpoint(string filename);
+			void loadCheckpoint(string filename);
 	};
 	HybridSystem *getMemorySystemInstance(uint id, string ini);
 
@@ -28,7 +28,11 @@
 * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 *********************************************************************************/
 
+#include <chrono>
+#include <unistd.h>
+
 #include "HybridSystem.h"
+#include "Checkpoint.h"
 
 using namespace std;
 
@@ -61,35 +65,33 @@ namespace HybridSim {
 		inipathPrefix.append("/");
 
 		iniReader.read(hybridsim_ini);
-		if (ENABLE_LOGGER)
+		if (LOGGER_ON)
 			log.init();
 
 		// Make sure that there are more cache pages than pages per set. 
 		assert(CACHE_PAGES >= SET_SIZE);
 
 		systemID = id;
-		cerr << "Creating DRAM with " << dram_ini << "\n";
-		uint64_t dram_size = (CACHE_PAGES * PAGE_SIZE) >> 20;
-		dram_size = (dram_size == 0) ? 1 : dram_size; // DRAMSim requires a minimum of 1 MB, even if HybridSim isn't going to use it.
-		dram_size = (OVERRIDE_DRAM_SIZE == 0) ? dram_size : OVERRIDE_DRAM_SIZE; // If OVERRIDE_DRAM_SIZE is non-zero, then use it.
-		dram = DRAMSim::getMemorySystemInstance(dram_ini, sys_ini, inipathPrefix, "resultsfilename", dram_size);
-
-		cerr << "Creating Flash with " << flash_ini << "\n";
-		flash = NVDSim::getNVDIMMInstance(1,flash_ini,"ini/def_system.ini",inipathPrefix,"");
+		dram = getDRAMBackendInstance(inipathPrefix);
+		flash = getFlashBackendInstance(inipathPrefix);
 		cerr << "Done with creating memories" << endl;
 
-		// Set up the callbacks for DRAM.
-		typedef DRAMSim::Callback <HybridSystem, void, uint, uint64_t, uint64_t> dramsim_callback_t;
-		DRAMSim::TransactionCompleteCB *read_cb = new dramsim_callback_t(this, &HybridSystem::DRAMReadCallback);
-		DRAMSim::TransactionCompleteCB *write_cb = new dramsim_callback_t(this, &HybridSystem::DRAMWriteCallback);
-		dram->RegisterCallbacks(read_cb, write_cb, NULL);
+		// Set up the callbacks for the backends.
+		typedef Callback <HybridSystem, void, uint64_t, uint64_t, uint64_t> backend_callback_t;
+		read_cb = new backend_callback_t(this, &HybridSystem::DRAMReadCallback);
+		write_cb = new backend_callback_t(this, &HybridSystem::DRAMWriteCallback);
+		dram->RegisterCallbacks(read_cb, NULL, write_cb);
+
+		nv_read_cb = new backend_callback_t(this, &HybridSystem::FlashReadCallback);
+		nv_write_cb = new backend_callback_t(this, &HybridSystem::FlashWriteCallback);
+		nv_crit_cb = new backend_callback_t(this, &HybridSystem::FlashCriticalLineCallback);
+		flash->RegisterCallbacks(nv_read_cb, nv_crit_cb, nv_write_cb);
+		dram_ids = dram->returnsIds();
+		flash_ids = flash->returnsIds();
 
-		// Set up the callbacks for NVDIMM.
-		typedef NVDSim::Callback <HybridSystem, void, uint64_t, uint64_t, uint64_t, bool> nvdsim_callback_t;
-		NVDSim::Callback_t *nv_read_cb = new nvdsim_callback_t(this, &HybridSystem::FlashReadCallback);
-		NVDSim::Callback_t *nv_write_cb = new nvdsim_callback_t(this, &HybridSystem::FlashWriteCallback);
-		NVDSim::Callback_t *nv_crit_cb = new nvdsim_callback_t(this, &HybridSystem::FlashCriticalLineCallback);
-		flash->RegisterCallbacks(nv_read_cb, nv_crit_cb, nv_write_cb, NULL);
+		// Set up the backend clocks.
+		dram_clock = ClockDomain(DRAM_CYCLES_PER_SECOND, CYCLES_PER_SECOND);
+		flash_clock = ClockDomain(FLASH_CYCLES_PER_SECOND, CYCLES_PER_SECOND);
 
 		// Need to check the queue when we start.
 		check_queue = true;
@@ -100,6 +102,13 @@ namespace HybridSim {
 		// No active transaction to start with.
 		active_transaction_flag = false;
 
+		// Start in functional mode if FUNCTIONAL_ACCESSES is set (used to warm up the cache).
+		functional_accesses_left = FUNCTIONAL_ACCESSES;
+		functional_ticks = 0;
+		functional_accesses = 0;
+		functional_misses = 0;
+		functional_skipped = 0;
+
 		// Call the restore cache state function.
 		// If ENABLE_RESTORE is set, then this will fill the cache table.
 		restoreCacheTable();
@@ -180,6 +189,14 @@ namespace HybridSim {
 		// Initialize size/max counters.
 		// Note: Some of this is just debug info, but I'm keeping it around because it is useful.
 		pending_count = 0; // This is used by TraceBasedSim for MAX_PENDING.
+		next_transaction_id = 1;
+		next_internal_id = INTERNAL_ID_BASE;
+		ReadDone = NULL;
+		WriteDone = NULL;
+		ReadDoneId = NULL;
+		WriteDoneId = NULL;
+		dram_writes_outstanding = 0;
+		flash_writes_outstanding = 0;
 		max_dram_pending = 0;
 		pending_pages_max = 0;
 		trans_queue_max = 0;
@@ -198,48 +215,82 @@ namespace HybridSim {
 		unique_stream_buffers = 0;
 		stream_buffer_hits = 0;
 
-		// Create file descriptors for debugging output (if needed).
-		if (DEBUG_VICTIM) 
+		if (ENABLE_STREAM_BUFFER)
 		{
-			debug_victim.open("debug_victim.log", ios_base::out | ios_base::trunc);
-			if (!debug_victim.is_open())
+			if ((ONE_MISS_TABLE_SIZE == 0) || (NUM_STREAM_BUFFERS == 0) || (STREAM_BUFFER_LENGTH == 0) || (STREAM_BUFFER_MAX_STRIDE == 0))
 			{
-				cerr << "ERROR: HybridSim debug_victim file failed to open.\n";
+				cerr << "ERROR: ONE_MISS_TABLE_SIZE, NUM_STREAM_BUFFERS, STREAM_BUFFER_LENGTH and STREAM_BUFFER_MAX_STRIDE must be greater than 0.\n";
 				abort();
 			}
-		}
-
-		if (DEBUG_NVDIMM_TRACE) 
-		{
-			debug_nvdimm_trace.open("nvdimm_trace.log", ios_base::out | ios_base::trunc);
-			if (!debug_nvdimm_trace.is_open())
+			if (STREAM_BUFFER_MAX_LENGTH < STREAM_BUFFER_LENGTH)
 			{
-				cerr << "ERROR: HybridSim debug_nvdimm_trace file failed to open.\n";
+				cerr << "ERROR: STREAM_BUFFER_MAX_LENGTH must be at least STREAM_BUFFER_LENGTH.\n";
 				abort();
 			}
+			one_miss_table.init(ONE_MISS_TABLE_SIZE);
+			stream_buffers.init(NUM_STREAM_BUFFERS);
 		}
 
-		if (DEBUG_FULL_TRACE) 
+		// Report these in the machine readable epoch statistics too.
+		uint64_t *epoch_counters[] = {&tlb_misses, &tlb_hits, &total_prefetches, &unused_prefetches, &unused_prefetch_victims, 
+			&prefetch_hit_nops, &prefetch_cheat_count, &unique_one_misses, &unique_stream_buffers, &stream_buffer_hits};
+		const char *epoch_counter_names[] = {"tlb_misses", "tlb_hits", "prefetches", "unused_prefetches", "unused_prefetch_victims", 
+			"prefetch_hit_nops", "prefetch_cheat_count", "unique_one_misses", "unique_stream_buffers", "stream_buffer_hits"};
+		for (size_t i = 0; i < sizeof(epoch_counters) / sizeof(epoch_counters[0]); i++)
+			log.add_epoch_counter(epoch_counter_names[i], epoch_counters[i]);
+
+		// Create file descriptors for debugging output (if needed).
+		if (DEBUG_VICTIM) 
 		{
-			debug_full_trace.open("full_trace.log", ios_base::out | ios_base::trunc);
-			if (!debug_full_trace.is_open())
+			debug_victim.open("debug_victim.log", ios_base::out | ios_base::trunc);
+			if (!debug_victim.is_open())
 			{
-				cerr << "ERROR: HybridSim debug_full_trace file failed to open.\n";
+				cerr << "ERROR: HybridSim debug_victim file failed to open.\n";
 				abort();
 			}
 		}
+
+		// The trace files are opened on the first access.
+		full_trace.init("full_trace", "FULL_TRACE", FULL_TRACE, DEBUG_TRACE_BUFFER);
+		nvdimm_trace.init("nvdimm_trace", "NVDIMM_TRACE", NVDIMM_TRACE, DEBUG_TRACE_BUFFER);
+
+		// Start the flash thread last, since it takes over the NVDIMM callbacks and the nvdimm trace file.
+		flash_thread = NULL;
+		if (FLASH_THREAD)
+		{
+			cerr << "Stepping the flash on a separate thread\n";
+			flash_thread = new FlashThread(flash, flash_clock, currentClockCycle, nvdimm_trace.enabled() ? &nvdimm_trace : NULL);
+		}
+
+		transaction_trace.init(TRANSACTION_TRACE_SAMPLE, TRANSACTION_TRACE_BUFFER);
+
+		// Publish the live statistics in shared memory (if requested).
+		next_live_stats_cycle = 0;
+		live_stats_last_cycle = 0;
+		live_stats_last_ns = 0;
+		if (LIVE_STATS != "none")
+			this->open_live_stats(LIVE_STATS);
 	}
 
 	HybridSystem::~HybridSystem()
 	{
+		// Stop the flash thread before closing the files it writes to.
+		if (flash_thread != NULL)
+			delete flash_thread;
+
 		if (DEBUG_VICTIM)
 			debug_victim.close();
 
-		if (DEBUG_NVDIMM_TRACE)
-			debug_nvdimm_trace.close();
+		nvdimm_trace.close();
+		full_trace.close();
 
-		if (DEBUG_FULL_TRACE)
-			debug_full_trace.close();
+		delete dram;
+		delete flash;
+		delete read_cb;
+		delete write_cb;
+		delete nv_read_cb;
+		delete nv_write_cb;
+		delete nv_crit_cb;
 	}
 
 	// static allocator for the library interface
@@ -251,6 +302,9 @@ namespace HybridSim {
 
 	void HybridSystem::update()
 	{
+		PROFILE_CYCLE();
+		PROFILE(PROFILE_UPDATE);
+
 		// Process the transaction queue.
 		// This will fill the dram_queue and flash_queue.
 
@@ -265,8 +319,10 @@ namespace HybridSim {
 		bool idle = (trans_queue.empty()) && (pending_pages.empty());
 		bool flash_idle = (flash_queue.empty()) && (flash_pending.empty());
 		bool dram_idle = (dram_queue.empty()) && (dram_pending.empty());
-		if (ENABLE_LOGGER)
+		PROFILE_START(log_timer, PROFILE_LOGGER);
+		if (LOGGER_ON)
 			log.access_update(trans_queue_size, idle, flash_idle, dram_idle);
+		PROFILE_STOP(log_timer);
 
 
 		// See if there are any transactions ready to be processed.
@@ -282,6 +338,7 @@ namespace HybridSim {
 		bool sent_transaction = false;
 
 
+		PROFILE_START(scan_timer, PROFILE_TRANS_QUEUE);
 		list<Transaction>::iterator it = trans_queue.begin();
 		while((it != trans_queue.end()) && (pending_pages.size() < NUM_SETS) && (check_queue) && (delay_counter == 0))
 		{
@@ -297,7 +354,7 @@ namespace HybridSim {
 				contention_lock(flash_addr);
 
 				// Log the page access.
-				if (ENABLE_LOGGER)
+				if (LOGGER_FULL)
 					log.access_page(page_addr);
 
 				// Set this transaction as active and start the delay counter, which
@@ -310,8 +367,13 @@ namespace HybridSim {
 				// Check that this page is in the TLB.
 				// Do not do this for SYNC_ALL_COUNTER transactions because the page address refers
 				// to the cache line, not the flash page address, so the TLB isn't needed.
+				// A TLB miss adds TLB_MISS_DELAY to the controller delay.
 				if ((*it).transactionType != SYNC_ALL_COUNTER)
-					check_tlb(page_addr);
+				{
+					if (check_tlb(page_addr))
+						delay_counter += TLB_MISS_DELAY;
+				}
+				this->trace(active_transaction.id, TransactionTrace::TRACE_LOOKUP, delay_counter);
 
 				// Delete this item and skip to the next.
 				it = trans_queue.erase(it);
@@ -340,7 +402,7 @@ namespace HybridSim {
 			else
 			{
 				// Log the set conflict.
-				if (ENABLE_LOGGER)
+				if (LOGGER_FULL)
 					log.access_set_conflict(SET_INDEX(page_addr));
 
 				// Skip to the next and do nothing else.
@@ -355,11 +417,13 @@ namespace HybridSim {
 		{
 			this->check_queue = false;
 		}
+		PROFILE_STOP(scan_timer);
 
 
 		// Process DRAM transaction queue until it is empty or addTransaction returns false.
 		// Note: This used to be a while, but was changed ot an if to only allow one
 		// transaction to be sent to the DRAM per cycle.
+		PROFILE_START(issue_timer, PROFILE_ISSUE);
 		bool not_full = true;
 		if (not_full && !dram_queue.empty())
 		{
@@ -369,11 +433,13 @@ namespace HybridSim {
 				isWrite = true;
 			else
 				isWrite = false;
-			not_full = dram->addTransaction(isWrite, tmp.address);
+			not_full = dram->addTransaction(isWrite, tmp.address, tmp.id);
 			if (not_full)
 			{
 				dram_queue.pop_front();
 				dram_pending_set.insert(tmp.address);
+				if (isWrite)
+					dram_writes_outstanding++;
 			}
 		}
 
@@ -390,20 +456,26 @@ namespace HybridSim {
 				isWrite = true;
 			else
 				isWrite = false;
-			not_full = flash->addTransaction(isWrite, tmp.address);
+
+			// The flash thread owns the flash when there is one (it writes the nvdimm trace too).
+			if (flash_thread != NULL)
+				not_full = flash_thread->send(currentClockCycle, isWrite, tmp.address, tmp.id);
+			else
+				not_full = flash->addTransaction(isWrite, tmp.address, tmp.id);
 
 			if (not_full)
 			{
 				flash_queue.pop_front();
+				if (isWrite)
+					flash_writes_outstanding++;
 
-				if (DEBUG_NVDIMM_TRACE)
-				{
-					debug_nvdimm_trace << currentClockCycle << " " << (isWrite ? 1 : 0) << " " << tmp.address << "\n";
-					debug_nvdimm_trace.flush();
-				}
+				if ((flash_thread == NULL) && nvdimm_trace.enabled())
+					nvdimm_trace.write(currentClockCycle, isWrite, tmp.address);
 			}
 		}
 
+		PROFILE_STOP(issue_timer);
+
 		// Decrement the delay counter.
 		if (delay_counter > 0)
 		{
@@ -412,18 +484,54 @@ namespace HybridSim {
 
 
 		// Update the logger.
-		if (ENABLE_LOGGER)
+		PROFILE_START(log_update_timer, PROFILE_LOGGER);
+		if (LOGGER_ON)
 			log.update();
-
-		// Update the memories.
-		dram->update();
-		flash->update();
+		PROFILE_STOP(log_update_timer);
+
+		// Publish the live statistics.
+		if (live_stats.is_open() && (currentClockCycle >= next_live_stats_cycle))
+			this->publish_live_stats(false);
+
+		// Update the memories (as many times as their clocks need for this controller cycle).
+		PROFILE_START(dram_timer, PROFILE_DRAM_UPDATE);
+		for (uint64_t i = dram_clock.tick(); i > 0; i--)
+			dram->update();
+		PROFILE_STOP(dram_timer);
+		PROFILE_START(flash_timer, PROFILE_FLASH_UPDATE);
+		if (flash_thread != NULL)
+		{
+			// Apply the flash callbacks made on this cycle.
+			flash_thread->end_cycle(currentClockCycle);
+			FlashThread::FlashEvent e;
+			while (flash_thread->next_event(currentClockCycle, e))
+			{
+				if (e.type == FlashThread::FLASH_READ_DONE)
+					FlashReadCallback(e.id, e.address, e.cycle);
+				else if (e.type == FlashThread::FLASH_CRITICAL_LINE)
+					FlashCriticalLineCallback(e.id, e.address, e.cycle);
+				else
+					FlashWriteCallback(e.id, e.address, e.cycle);
+			}
+		}
+		else
+		{
+			for (uint64_t i = flash_clock.tick(); i > 0; i--)
+				flash->update();
+		}
+		PROFILE_STOP(flash_timer);
 
 		// Increment the cycle count.
 		step();
 	}
 
 	bool HybridSystem::addTransaction(bool isWrite, uint64_t addr)
+	{
+		uint64_t id;
+		return addTransaction(isWrite, addr, id);
+	}
+
+	bool HybridSystem::addTransaction(bool isWrite, uint64_t addr, uint64_t &id)
 	{
 		if (DEBUG_CACHE)
 			cerr << "\n" << currentClockCycle << ": " << "Adding transaction for address=" << addr << " isWrite=" << isWrite << endl;
@@ -438,11 +546,16 @@ namespace HybridSim {
 			type = DATA_READ;
 		}
 		Transaction t = Transaction(type, addr, NULL);
-		return addTransaction(t);
+		bool accepted = addTransaction(t);
+		id = t.id;
+		return accepted;
 	}
 
 	bool HybridSystem::addTransaction(Transaction &trans)
 	{
+		PROFILE(PROFILE_ADD_TRANSACTION);
+
+		trans.id = next_transaction_id++;
 
 		if (REMAP_MMIO)
 		{
@@ -454,16 +567,21 @@ namespace HybridSim {
 				{
 					if (ReadDone != NULL)
 						(*ReadDone)(systemID, trans.address, currentClockCycle);
+					if (ReadDoneId != NULL)
+						(*ReadDoneId)(trans.id, trans.address, currentClockCycle);
 				}
 				else if (trans.transactionType == DATA_WRITE)
 				{
 					if (WriteDone != NULL)
 						(*WriteDone)(systemID, trans.address, currentClockCycle);
+					if (WriteDoneId != NULL)
+						(*WriteDoneId)(trans.id, trans.address, currentClockCycle);
 				}
 				else
 					assert(0);
 
-				log.mmio_dropped();
+				if (LOGGER_ON)
+					log.mmio_dropped();
 
 				return true;
 			}
@@ -472,10 +590,18 @@ namespace HybridSim {
 				// Subtract 0.5 GB from the address to adjust for MMIO.
 				trans.address -= HALFGB;
 
-				log.mmio_remapped();
+				if (LOGGER_ON)
+					log.mmio_remapped();
 			}
 		}
 
+		if (functional_accesses_left > 0)
+		{
+			// Apply the access to the cache state right now instead of queueing it.
+			FunctionalAccess(trans);
+			return true;
+		}
+
 		pending_count += 1;
 
 		trans_queue.push_back(trans);
@@ -488,14 +614,12 @@ namespace HybridSim {
 		}
 
 		// Start the logging for this access.
-		if (ENABLE_LOGGER)
-			log.access_start(trans.address);
+		if (LOGGER_ON)
+			log.access_start(trans.id, trans.address);
+		this->trace(trans.id, TransactionTrace::TRACE_ENQUEUE, trans.address);
 
-		if (DEBUG_FULL_TRACE)
-		{
-			debug_full_trace << currentClockCycle << " " << ((trans.transactionType == DATA_WRITE) ? 1 : 0) << " " << trans.address << "\n";
-			debug_full_trace.flush();
-		}
+		if (full_trace.enabled())
+			full_trace.write(currentClockCycle, (trans.transactionType == DATA_WRITE), trans.address);
 
 		// Restart queue checking.
 		this->check_queue = true;
@@ -508,6 +632,16 @@ namespace HybridSim {
 		// Create prefetch transaction.
 		Transaction prefetch_transaction = Transaction(PREFETCH, prefetch_addr, NULL);
 
+		// In functional mode, the prefetch is applied to the cache right away like any other access.
+		if (functional_accesses_left > 0)
+		{
+			FunctionalAccess(prefetch_transaction);
+			return;
+		}
+
+		// Prefetches need their own ids since their DRAM and flash operations are matched by id.
+		prefetch_transaction.id = next_internal_id++;
+
 		// Push the operation onto the front of the transaction queue (so it executes immediately).
 		trans_queue.push_front(prefetch_transaction);
 		trans_queue_size += 1;
@@ -521,7 +655,7 @@ namespace HybridSim {
 	void HybridSystem::addFlush(uint64_t flush_addr)
 	{
 		// Create flush transaction.
-		Transaction flush_transaction = Transaction(FLUSH, flush_addr, NULL);
+		Transaction flush_transaction = Transaction(FLUSH, flush_addr, NULL, next_internal_id++);
 
 		// Push the operation onto the front of the transaction queue (so it executes immediately).
 		trans_queue.push_front(flush_transaction);
@@ -542,6 +676,8 @@ namespace HybridSim {
 
 	void HybridSystem::ProcessTransaction(Transaction &trans)
 	{
+		PROFILE(PROFILE_PROCESS_TRANSACTION);
+
 		// trans.address is the original address that we must use to callback.
 		// But for our processing, we must use an aligned address (which is aligned to a page in the NV address space).
 		uint64_t addr = ALIGN(trans.address);
@@ -611,8 +747,9 @@ namespace HybridSim {
 		// Place access_process here and combine it with access_cache.
 		// Tell the logger when the access is processed (used for timing the time in queue).
 		// Only do this for DATA_READ and DATA_WRITE.
-		if ((ENABLE_LOGGER) && ((trans.transactionType == DATA_READ) || (trans.transactionType == DATA_WRITE)))
-			log.access_process(trans.address, trans.transactionType == DATA_READ, hit);
+		if (LOGGER_ON && ((trans.transactionType == DATA_READ) || (trans.transactionType == DATA_WRITE)))
+			log.access_process(trans.id, trans.address, trans.transactionType == DATA_READ, hit);
+		this->trace(trans.id, hit ? TransactionTrace::TRACE_HIT : TransactionTrace::TRACE_MISS, set_index);
 
 		// Handle prefetching operations.
 		if (ENABLE_PERFECT_PREFETCHING && ((trans.transactionType == DATA_READ) || (trans.transactionType == DATA_WRITE)))
@@ -655,9 +792,9 @@ namespace HybridSim {
 
 			// Issue operation to the DRAM.
 			if (trans.transactionType == DATA_READ)
-				CacheRead(trans.address, addr, cache_address);
+				CacheRead(trans.id, trans.address, addr, cache_address);
 			else if(trans.transactionType == DATA_WRITE)
-				CacheWrite(trans.address, addr, cache_address);
+				CacheWrite(trans.id, trans.address, addr, cache_address);
 			else if(trans.transactionType == FLUSH)
 			{
 				Flush(cache_address);
@@ -800,7 +937,7 @@ namespace HybridSim {
 					cur_line.tag = TAG(page_address);
 					cur_line.dirty = false;
 					cur_line.valid = true;
-					cur_line.ts = currentClockCycle;
+					cur_line.ts = lru_cycle();
 					cur_line.used = false;
 
 					// Since this is a prefetch, also keep track of that.
@@ -824,7 +961,7 @@ namespace HybridSim {
 
 			// Log the victim, set, etc.
 			// THIS MUST HAPPEN AFTER THE CUR_LINE IS SET TO THE VICTIM LINE.
-			if ((ENABLE_LOGGER) && ((trans.transactionType == DATA_READ) || (trans.transactionType == DATA_WRITE)))
+			if (LOGGER_FULL && ((trans.transactionType == DATA_READ) || (trans.transactionType == DATA_WRITE)))
 				log.access_miss(PAGE_ADDRESS(addr), victim_flash_addr, set_index, victim, cur_line.dirty, cur_line.valid);
 
 			// Lock the victim page so it will not be selected for eviction again during the processing of this
@@ -847,6 +984,7 @@ namespace HybridSim {
 
 
 			Pending p;
+			p.id = trans.id;
 			p.orig_addr = trans.address;
 			p.flash_addr = addr;
 			p.cache_addr = cache_address;
@@ -867,6 +1005,181 @@ namespace HybridSim {
 		}
 	}
 
+	void HybridSystem::setFunctional(uint64_t accesses)
+	{
+		functional_accesses_left = accesses;
+	}
+
+	bool HybridSystem::isFunctional()
+	{
+		return (functional_accesses_left > 0);
+	}
+
+	bool HybridSystem::isQuiescent()
+	{
+		// Controller: nothing waiting to be looked up and no page still locked by an operation.
+		if ((!trans_queue.empty()) || (active_transaction_flag) || (delay_counter > 0) || (pending_count > 0) || 
+				(!pending_pages.empty()))
+			return false;
+
+		// Memories: nothing waiting to be issued, no outstanding reads and no posted writes.
+		if ((!dram_queue.empty()) || (!flash_queue.empty()) || (!dram_pending.empty()) || (!flash_pending.empty()))
+			return false;
+		return ((dram_writes_outstanding == 0) && (flash_writes_outstanding == 0));
+	}
+
+	uint64_t HybridSystem::drain()
+	{
+		uint64_t cycles = 0;
+		while (!isQuiescent())
+		{
+			update();
+			cycles++;
+		}
+		return cycles;
+	}
+
+	uint64_t HybridSystem::lru_cycle()
+	{
+		// Timestamp for the LRU state of the cache, TLB and stream buffers.
+		// Functional accesses do not advance currentClockCycle, so each one adds a tick to keep
+		// the timestamps in access order.
+		return currentClockCycle + functional_ticks;
+	}
+
+	void HybridSystem::FunctionalAccess(Transaction &trans)
+	{
+		// Functional accesses update the cache tags, dirty bits, LRU timestamps, TLB and stream buffers
+		// with no DRAM/flash traffic, no queueing and no logging. The callback happens immediately.
+		// Transactions that are still in flight from detailed mode continue normally in update().
+		uint64_t addr = ALIGN(trans.address);
+		uint64_t set_index = SET_INDEX(addr);
+		uint64_t tag = TAG(addr);
+
+		functional_ticks++;
+		if (trans.transactionType != PREFETCH)
+			functional_accesses++;
+
+		// Do not touch lines that detailed mode is working on.
+		if (!contention_is_unlocked(addr))
+		{
+			functional_skipped++;
+		}
+		else
+		{
+			if (trans.transactionType != PREFETCH)
+				check_tlb(PAGE_ADDRESS(addr));
+
+			// Look for a hit and pick the LRU victim in the same pass.
+			bool hit = false;
+			uint64_t cache_address = 0;
+			uint64_t victim = 0;
+			bool victim_init = false;
+			for (uint64_t i=0; i<SET_SIZE; i++)
+			{
+				uint64_t cur_address = (i * NUM_SETS + set_index) * PAGE_SIZE;
+				cache_line &cur_line = cache[cur_address];
+
+				if (cur_line.valid && (cur_line.tag == tag))
+				{
+					hit = true;
+					cache_address = cur_address;
+					break;
+				}
+
+				if ((!cur_line.locked) && ((!victim_init) || (cur_line.ts < cache[victim].ts)))
+				{
+					victim = cur_address;
+					victim_init = true;
+				}
+			}
+
+			if (hit)
+			{
+				if (trans.transactionType == PREFETCH)
+				{
+					prefetch_hit_nops++;
+				}
+				else
+				{
+					cache_line &cur_line = cache[cache_address];
+					cur_line.ts = lru_cycle();
+					if ((cur_line.prefetched) && (cur_line.used == false))
+						unused_prefetches--;
+					cur_line.used = true;
+					if (trans.transactionType == DATA_WRITE)
+						cur_line.dirty = true;
+
+					if (ENABLE_STREAM_BUFFER)
+						stream_buffer_hit_handler(PAGE_ADDRESS(addr));
+				}
+			}
+			else if (!victim_init)
+			{
+				// Every line in the set is locked.
+				functional_skipped++;
+			}
+			else
+			{
+				cache_line &cur_line = cache[victim];
+				if ((cur_line.prefetched) && (cur_line.used == false))
+				{
+					unused_prefetches--;
+					unused_prefetch_victims++;
+				}
+
+				cur_line.tag = tag;
+				cur_line.valid = true;
+				cur_line.dirty = (trans.transactionType == DATA_WRITE);
+				cur_line.ts = lru_cycle();
+				cur_line.used = (trans.transactionType != PREFETCH);
+				cur_line.prefetched = (trans.transactionType == PREFETCH);
+				if (trans.transactionType == PREFETCH)
+				{
+					total_prefetches++;
+					unused_prefetches++;
+				}
+				else
+				{
+					functional_misses++;
+
+					// The prefetches issued here are applied functionally too (see addPrefetch).
+					if (SEQUENTIAL_PREFETCHING_WINDOW > 0)
+						issue_sequential_prefetches(addr);
+
+					if (ENABLE_STREAM_BUFFER)
+						stream_buffer_miss_handler(PAGE_ADDRESS(addr));
+				}
+			}
+		}
+
+		// Leave functional mode only now, so the prefetches from the last functional access were applied
+		// functionally too, but before the callback, so the caller sees the new mode if it adds more accesses.
+		if (trans.transactionType != PREFETCH)
+			functional_accesses_left--;
+
+		// Complete the access. This skips ReadDoneCallback/WriteDoneCallback since there is nothing to log.
+		TransactionCompleteCB *done = NULL;
+		TransactionIdCompleteCB *done_id = NULL;
+		if (trans.transactionType == DATA_READ)
+		{
+			done = ReadDone;
+			done_id = ReadDoneId;
+		}
+		else if (trans.transactionType == DATA_WRITE)
+		{
+			done = WriteDone;
+			done_id = WriteDoneId;
+		}
+		uint64_t callback_addr = trans.address;
+		if ((REMAP_MMIO) && (trans.address >= THREEPOINTFIVEGB))
+			callback_addr += HALFGB;
+		if (done != NULL)
+			(*done)(systemID, callback_addr, currentClockCycle);
+		if (done_id != NULL)
+			(*done_id)(trans.id, callback_addr, currentClockCycle);
+	}
+
 	void HybridSystem::VictimRead(Pending p)
 	{
 		if (DEBUG_CACHE)
@@ -882,24 +1195,27 @@ namespace HybridSim {
 
 #if SINGLE_WORD
 		// Schedule a read from DRAM to get the line being evicted.
-		Transaction t = Transaction(DATA_READ, p.cache_addr, NULL);
+		Transaction t = Transaction(DATA_READ, p.cache_addr, NULL, p.id);
 		dram_queue.push_back(t);
 #else
 		// Schedule reads for the entire page.
-		dram_pending_wait[p.cache_addr] = unordered_set<uint64_t>();
+		unordered_set<uint64_t> &wait = dram_pending_wait[dram_key(p.id, p.cache_addr)];
+		wait.clear();
 		for(uint64_t i=0; i<PAGE_SIZE/BURST_SIZE; i++)
 		{
 			uint64_t addr = p.cache_addr + i*BURST_SIZE;
-			dram_pending_wait[p.cache_addr].insert(addr);
-			Transaction t = Transaction(DATA_READ, addr, NULL);
+			wait.insert(addr);
+			Transaction t = Transaction(DATA_READ, addr, NULL, p.id);
 			dram_queue.push_back(t);
 		}
 #endif
 
+		this->trace(p.id, TransactionTrace::TRACE_VICTIM_READ);
+
 		// Add a record in the DRAM's pending table.
 		p.op = VICTIM_READ;
-		assert(dram_pending.count(p.cache_addr) == 0);
-		dram_pending[p.cache_addr] = p;
+		assert(dram_pending.count(dram_key(p.id, p.cache_addr)) == 0);
+		dram_pending[dram_key(p.id, p.cache_addr)] = p;
 	}
 
 	void HybridSystem::VictimReadFinish(uint64_t addr, Pending p)
@@ -914,24 +1230,24 @@ namespace HybridSim {
 		if (DEBUG_CACHE)
 			cerr << " num_left=0 (SINGLE_WORD)\n";
 #else
-		uint64_t cache_page_addr = p.cache_addr;
+		uint64_t key = dram_key(p.id, p.cache_addr);
 
 		if (DEBUG_CACHE)
-			cerr << " num_left=" << dram_pending_wait[cache_page_addr].size() << "\n"; 
+			cerr << " num_left=" << dram_pending_wait[key].size() << "\n"; 
 
 		// Remove the read that just finished from the wait set.
-		dram_pending_wait[cache_page_addr].erase(addr);
+		dram_pending_wait[key].erase(addr);
 
-		if (!dram_pending_wait[cache_page_addr].empty())
+		if (!dram_pending_wait[key].empty())
 		{
 			// If not done with this line, then re-enter pending map.
-			dram_pending[cache_page_addr] = p;
+			dram_pending[key] = p;
 			dram_pending_set.erase(addr);
 			return;
 		}
 
 		// The line has completed. Delete the wait set object and move on.
-		dram_pending_wait.erase(cache_page_addr);
+		dram_pending_wait.erase(key);
 #endif
 
 
@@ -952,6 +1268,7 @@ namespace HybridSim {
 		contention_unlock(p.flash_addr, p.orig_addr, "VICTIM_READ", p.victim_valid, victim_address, true, p.cache_addr);
 
 		// Schedule a write to the flash to simulate the transfer
+		this->trace(p.id, TransactionTrace::TRACE_VICTIM_READ_DONE);
 		VictimWrite(p);
 	}
 
@@ -966,13 +1283,13 @@ namespace HybridSim {
 
 #if SINGLE_WORD
 		// Schedule a write to Flash to save the evicted line.
-		Transaction t = Transaction(DATA_WRITE, victim_flash_addr, NULL);
+		Transaction t = Transaction(DATA_WRITE, victim_flash_addr, NULL, p.id);
 		flash_queue.push_back(t);
 #else
 		// Schedule writes for the entire page.
 		for(uint64_t i=0; i<PAGE_SIZE/FLASH_BURST_SIZE; i++)
 		{
-			Transaction t = Transaction(DATA_WRITE, victim_flash_addr + i*FLASH_BURST_SIZE, NULL);
+			Transaction t = Transaction(DATA_WRITE, victim_flash_addr + i*FLASH_BURST_SIZE, NULL, p.id);
 			flash_queue.push_back(t);
 		}
 #endif
@@ -998,23 +1315,26 @@ namespace HybridSim {
 
 #if SINGLE_WORD
 		// Schedule a read from Flash to get the new line 
-		Transaction t = Transaction(DATA_READ, page_addr, NULL);
+		Transaction t = Transaction(DATA_READ, page_addr, NULL, p.id);
 		flash_queue.push_back(t);
 #else
 		// Schedule reads for the entire page.
-		flash_pending_wait[page_addr] = unordered_set<uint64_t>();
+		unordered_set<uint64_t> &wait = flash_pending_wait[flash_key(p.id, page_addr)];
+		wait.clear();
 		for(uint64_t i=0; i<PAGE_SIZE/FLASH_BURST_SIZE; i++)
 		{
 			uint64_t addr = page_addr + i*FLASH_BURST_SIZE;
-			flash_pending_wait[page_addr].insert(addr);
-			Transaction t = Transaction(DATA_READ, addr, NULL);
+			wait.insert(addr);
+			Transaction t = Transaction(DATA_READ, addr, NULL, p.id);
 			flash_queue.push_back(t);
 		}
 #endif
 
+		this->trace(p.id, TransactionTrace::TRACE_LINE_READ);
+
 		// Add a record in the Flash's pending table.
 		p.op = LINE_READ;
-		flash_pending[page_addr] = p;
+		flash_pending[flash_key(p.id, page_addr)] = p;
 	}
 
 
@@ -1031,23 +1351,23 @@ namespace HybridSim {
 		if (DEBUG_CACHE)
 			cerr << " num_left=0 (SINGLE_WORD)\n";
 #else
-		uint64_t page_addr = PAGE_ADDRESS(p.flash_addr);
+		uint64_t key = flash_key(p.id, PAGE_ADDRESS(p.flash_addr));
 
 		if (DEBUG_CACHE)
-			cerr << " num_left=" << flash_pending_wait[page_addr].size() << "\n"; 
+			cerr << " num_left=" << flash_pending_wait[key].size() << "\n"; 
 
 		// Remove the read that just finished from the wait set.
-		flash_pending_wait[page_addr].erase(addr);
+		flash_pending_wait[key].erase(addr);
 
-		if (!flash_pending_wait[page_addr].empty())
+		if (!flash_pending_wait[key].empty())
 		{
 			// If not done with this line, then re-enter pending map.
-			flash_pending[PAGE_ADDRESS(addr)] = p;
+			flash_pending[key] = p;
 			return;
 		}
 
 		// The line has completed. Delete the wait set object and move on.
-		flash_pending_wait.erase(page_addr);
+		flash_pending_wait.erase(key);
 #endif
 
 
@@ -1059,6 +1379,7 @@ namespace HybridSim {
 		{
 			cerr << "The line read to Flash line " << PAGE_ADDRESS(addr) << " has completed.\n";
 		}
+		this->trace(p.id, TransactionTrace::TRACE_LINE_READ_DONE);
 
 
 		// Update the cache state
@@ -1066,7 +1387,7 @@ namespace HybridSim {
 		cur_line.tag = TAG(p.flash_addr);
 		cur_line.dirty = false;
 		cur_line.valid = true;
-		cur_line.ts = currentClockCycle;
+		cur_line.ts = lru_cycle();
 		cur_line.used = false;
 		if (p.type == PREFETCH)
 		{
@@ -1112,15 +1433,17 @@ namespace HybridSim {
 		if (DEBUG_CACHE)
 			cerr << currentClockCycle << ": " << "Performing LINE_WRITE for (" << p.flash_addr << ", " << p.cache_addr << ")\n";
 
+		this->trace(p.id, TransactionTrace::TRACE_LINE_WRITE);
+
 #if SINGLE_WORD
 		// Schedule a write to DRAM to simulate the write of the line that was read from Flash.
-		Transaction t = Transaction(DATA_WRITE, p.cache_addr, NULL);
+		Transaction t = Transaction(DATA_WRITE, p.cache_addr, NULL, p.id);
 		dram_queue.push_back(t);
 #else
 		// Schedule writes for the entire page.
 		for(uint64_t i=0; i<PAGE_SIZE/BURST_SIZE; i++)
 		{
-			Transaction t = Transaction(DATA_WRITE, p.cache_addr + i*BURST_SIZE, NULL);
+			Transaction t = Transaction(DATA_WRITE, p.cache_addr + i*BURST_SIZE, NULL, p.id);
 			dram_queue.push_back(t);
 		}
 #endif
@@ -1129,7 +1452,7 @@ namespace HybridSim {
 	}
 
 
-	void HybridSystem::CacheRead(uint64_t orig_addr, uint64_t flash_addr, uint64_t cache_addr)
+	void HybridSystem::CacheRead(uint64_t id, uint64_t orig_addr, uint64_t flash_addr, uint64_t cache_addr)
 	{
 		if (DEBUG_CACHE)
 			cerr << currentClockCycle << ": " << "Performing CACHE_READ for (" << flash_addr << ", " << cache_addr << ")\n";
@@ -1139,14 +1462,14 @@ namespace HybridSim {
 
 		assert(cache_addr == PAGE_ADDRESS(data_addr));
 
-		Transaction t = Transaction(DATA_READ, data_addr, NULL);
+		Transaction t = Transaction(DATA_READ, data_addr, NULL, id);
 		dram_queue.push_back(t);
 
 		// Update the cache state
 		// This could be done here or in CacheReadFinish
 		// It really doesn't matter (AFAICT) as long as it is consistent.
 		cache_line cur_line = cache[cache_addr];
-		cur_line.ts = currentClockCycle;
+		cur_line.ts = lru_cycle();
 		if ((cur_line.prefetched) && (cur_line.used == false)) // Note: this if statement must come before cur_line.used is set to true.
 			unused_prefetches--;
 		cur_line.used = true;
@@ -1155,6 +1478,7 @@ namespace HybridSim {
 		// Add a record in the DRAM's pending table.
 		Pending p;
 		p.op = CACHE_READ;
+		p.id = id;
 		p.orig_addr = orig_addr;
 		p.flash_addr = flash_addr;
 		p.cache_addr = cache_addr;
@@ -1162,11 +1486,8 @@ namespace HybridSim {
 		p.victim_valid = false;
 		p.callback_sent = false;
 		p.type = DATA_READ;
-		assert(dram_pending.count(data_addr) == 0);
-		dram_pending[data_addr] = p;
-
-		// Assertions for "this can't happen" situations.
-		assert(dram_pending.count(data_addr) != 0);
+		assert(dram_pending.count(dram_key(id, data_addr)) == 0);
+		dram_pending[dram_key(id, data_addr)] = p;
 	}
 
 	void HybridSystem::CacheReadFinish(uint64_t addr, Pending p)
@@ -1178,7 +1499,7 @@ namespace HybridSim {
 		// Only do this if it hasn't been sent already by the critical cache line first callback.
 		// Also, do not do this for prefetch since it does not have an external caller waiting on it.
 		if (!p.callback_sent)
-			ReadDoneCallback(systemID, p.orig_addr, currentClockCycle);
+			ReadDoneCallback(systemID, p.id, p.orig_addr, currentClockCycle);
 
 		// Erase the page from the pending set.
 		// Note: the if statement is needed to ensure that the VictimRead operation (if it was invoked as part of a cache miss)
@@ -1187,7 +1508,7 @@ namespace HybridSim {
 		contention_unlock(p.flash_addr, p.orig_addr, "CACHE_READ", p.victim_valid, victim_address, true, p.cache_addr);
 	}
 
-	void HybridSystem::CacheWrite(uint64_t orig_addr, uint64_t flash_addr, uint64_t cache_addr)
+	void HybridSystem::CacheWrite(uint64_t id, uint64_t orig_addr, uint64_t flash_addr, uint64_t cache_addr)
 	{
 		if (DEBUG_CACHE)
 			cerr << currentClockCycle << ": " << "Performing CACHE_WRITE for (" << flash_addr << ", " << cache_addr << ")\n";
@@ -1195,13 +1516,14 @@ namespace HybridSim {
 		// Compute the actual DRAM address of the data word we care about.
 		uint64_t data_addr = cache_addr + PAGE_OFFSET(flash_addr);
 
-		Transaction t = Transaction(DATA_WRITE, data_addr, NULL);
+		Transaction t = Transaction(DATA_WRITE, data_addr, NULL, id);
 		dram_queue.push_back(t);
 
 		// Finish the operation by updating cache state, doing the callback, and removing the pending set.
 		// Note: This is only split up so the LineWrite operation can reuse the second half
 		// of CacheWrite without actually issuing a new write.
 		Pending p;
+		p.id = id;
 		p.orig_addr = orig_addr;
 		p.flash_addr = flash_addr;
 		p.cache_addr = cache_addr;
@@ -1224,7 +1546,7 @@ namespace HybridSim {
 		if ((cur_line.prefetched) && (cur_line.used == false)) // Note: this if statement must come before cur_line.used is set to true.
 			unused_prefetches--;
 		cur_line.used = true;
-		cur_line.ts = currentClockCycle;
+		cur_line.ts = lru_cycle();
 		cache[p.cache_addr] = cur_line;
 
 		if (DEBUG_CACHE)
@@ -1234,7 +1556,7 @@ namespace HybridSim {
 		// This is done immediately rather than waiting for callback.
 		// Only do this if it hasn't been sent already by the critical cache line first callback.
 		if (!p.callback_sent)
-			WriteDoneCallback(systemID, p.orig_addr, currentClockCycle);
+			WriteDoneCallback(systemID, p.id, p.orig_addr, currentClockCycle);
 
 		// Erase the page from the pending set.
 		// Note: the if statement is needed to ensure that the VictimRead operation (if it was invoked as part of a cache miss)
@@ -1267,15 +1589,28 @@ namespace HybridSim {
 		WriteDone = writeDone;
 	}
 
+	void HybridSystem::RegisterIdCallbacks(TransactionIdCompleteCB *readDone, TransactionIdCompleteCB *writeDone)
+	{
+		ReadDoneId = readDone;
+		WriteDoneId = writeDone;
+	}
+
 
-	void HybridSystem::DRAMReadCallback(uint id, uint64_t addr, uint64_t cycle)
+	void HybridSystem::DRAMReadCallback(uint64_t id, uint64_t addr, uint64_t cycle)
 	{
-		// Determine which address to look up in the pending table.
-		// If there is an entry for this page in the dram_pending_wait, then that
+		PROFILE(PROFILE_DRAM_CALLBACK);
+
+		// Determine which key to look up in the pending table.
+		// If the DRAM returns ids, then that is the key.
+		// Otherwise, if there is an entry for this page in the dram_pending_wait, then that
 		// means this is for a VICTIM_READ operation and we should use the page address.
 		// Otherwise, this is for a CACHE_READ operation and we should use the addr directly.
 		uint64_t pending_addr;
-		if (dram_pending_wait.count(PAGE_ADDRESS(addr)) != 0)
+		if (dram_ids)
+		{
+			pending_addr = id;
+		}
+		else if (dram_pending_wait.count(PAGE_ADDRESS(addr)) != 0)
 		{
 			pending_addr = PAGE_ADDRESS(addr);
 		}
@@ -1318,10 +1653,14 @@ namespace HybridSim {
 		dram_pending_set.erase(addr);
 	}
 
-	void HybridSystem::DRAMWriteCallback(uint id, uint64_t addr, uint64_t cycle)
+	void HybridSystem::DRAMWriteCallback(uint64_t id, uint64_t addr, uint64_t cycle)
 	{
+		PROFILE(PROFILE_DRAM_CALLBACK);
+
 		// Nothing to do (it doesn't matter when the DRAM write finishes for the cache controller, as long as it happens).
+		// It is only tracked so isQuiescent() knows when all posted writes are done.
 		dram_pending_set.erase(addr);
+		dram_writes_outstanding--;
 	}
 
 	void HybridSystem::DRAMPowerCallback(double a, double b, double c, double d)
@@ -1329,15 +1668,18 @@ namespace HybridSim {
 		printf("power callback: %0.3f, %0.3f, %0.3f, %0.3f\n",a,b,c,d);
 	}
 
-	void HybridSystem::FlashReadCallback(uint64_t id, uint64_t addr, uint64_t cycle, bool unmapped)
+	void HybridSystem::FlashReadCallback(uint64_t id, uint64_t addr, uint64_t cycle)
 	{
-		if (flash_pending.count(PAGE_ADDRESS(addr)) != 0)
+		PROFILE(PROFILE_FLASH_CALLBACK);
+
+		uint64_t key = flash_key(id, PAGE_ADDRESS(addr));
+		if (flash_pending.count(key) != 0)
 		{
 			// Get the pending object.
-			Pending p = flash_pending[PAGE_ADDRESS(addr)];
+			Pending p = flash_pending[key];
 
 			// Remove this pending object from flash_pending
-			flash_pending.erase(PAGE_ADDRESS(addr));
+			flash_pending.erase(key);
 
 			if (p.op == LINE_READ)
 			{
@@ -1352,24 +1694,27 @@ namespace HybridSim {
 		else
 		{
 			ERROR("FlashReadCallback received an address not in the pending set.");
-			cerr << "flash_pending count was " << flash_pending.count(PAGE_ADDRESS(addr)) << "\n";
+			cerr << "flash_pending count was " << flash_pending.count(key) << "\n";
 			cerr << "address: " << addr << " page: " << PAGE_ADDRESS(addr) << " set: " << SET_INDEX(addr) << "\n";
 			abort();
 		}
 	}
 
-	void HybridSystem::FlashCriticalLineCallback(uint64_t id, uint64_t addr, uint64_t cycle, bool unmapped)
+	void HybridSystem::FlashCriticalLineCallback(uint64_t id, uint64_t addr, uint64_t cycle)
 	{
+		PROFILE(PROFILE_FLASH_CALLBACK);
+
 		// This function is called to implement critical line first for reads.
 		// This allows HybridSim to tell the external user it can make progress as soon as the data
 		// it is waiting for is back in the memory controller.
 
 		//cerr << cycle << ": Critical Line Callback Received for address " << addr << "\n";
 
-		if (flash_pending.count(PAGE_ADDRESS(addr)) != 0)
+		uint64_t key = flash_key(id, PAGE_ADDRESS(addr));
+		if (flash_pending.count(key) != 0)
 		{
 			// Get the pending object.
-			Pending p = flash_pending[PAGE_ADDRESS(addr)];
+			Pending p = flash_pending[key];
 
 			// Note: DO NOT REMOVE THIS FROM THE PENDING SET.
 
@@ -1383,10 +1728,11 @@ namespace HybridSim {
 				}
 					
 				// Make the callback and mark it as being called.
+				this->trace(p.id, TransactionTrace::TRACE_CRITICAL_LINE);
 				if (p.type == DATA_READ)
-					ReadDoneCallback(systemID, p.orig_addr, currentClockCycle);
+					ReadDoneCallback(systemID, p.id, p.orig_addr, currentClockCycle);
 				else if(p.type == DATA_WRITE)
-					WriteDoneCallback(systemID, p.orig_addr, currentClockCycle);
+					WriteDoneCallback(systemID, p.id, p.orig_addr, currentClockCycle);
 				else
 				{
 					// Do nothing because this is a PREFETCH.
@@ -1395,7 +1741,7 @@ namespace HybridSim {
 				// Mark the pending item's callback as being sent so it isn't sent again later.
 				p.callback_sent = true;
 
-				flash_pending[PAGE_ADDRESS(addr)] = p;
+				flash_pending[key] = p;
 			}
 			else
 			{
@@ -1411,9 +1757,13 @@ namespace HybridSim {
 
 	}
 
-	void HybridSystem::FlashWriteCallback(uint64_t id, uint64_t addr, uint64_t cycle, bool unmapped)
+	void HybridSystem::FlashWriteCallback(uint64_t id, uint64_t addr, uint64_t cycle)
 	{
+		PROFILE(PROFILE_FLASH_CALLBACK);
+
 		// Nothing to do (it doesn't matter when the flash write finishes for the cache controller, as long as it happens).
+		// It is only tracked so isQuiescent() knows when all posted writes are done.
+		flash_writes_outstanding--;
 
 		if (DEBUG_CACHE)
 			cerr << "The write to Flash line " << PAGE_ADDRESS(addr) << " has completed.\n";
@@ -1421,51 +1771,53 @@ namespace HybridSim {
 
 
 
-	void HybridSystem::ReadDoneCallback(uint sysID, uint64_t orig_addr, uint64_t cycle)
+	void HybridSystem::ReadDoneCallback(uint sysID, uint64_t id, uint64_t orig_addr, uint64_t cycle)
 	{
-		if (ReadDone != NULL)
+		uint64_t callback_addr = orig_addr;
+		if (REMAP_MMIO)
 		{
-			uint64_t callback_addr = orig_addr;
-			if (REMAP_MMIO)
+			if (orig_addr >= THREEPOINTFIVEGB)
 			{
-				if (orig_addr >= THREEPOINTFIVEGB)
-				{
-					// Give the same address in the callback that we originally received.
-					callback_addr += HALFGB;
-				}
+				// Give the same address in the callback that we originally received.
+				callback_addr += HALFGB;
 			}
+		}
 
-			// Call the callback.
+		// Call the callbacks.
+		if (ReadDone != NULL)
 			(*ReadDone)(sysID, callback_addr, cycle);
-		}
+		if (ReadDoneId != NULL)
+			(*ReadDoneId)(id, callback_addr, cycle);
 
 		// Finish the logging for this access.
-		if (ENABLE_LOGGER)
-			log.access_stop(orig_addr);
+		this->trace(id, TransactionTrace::TRACE_COMPLETE, 0);
+		if (LOGGER_ON)
+			log.access_stop(id);
 	}
 
 
-	void HybridSystem::WriteDoneCallback(uint sysID, uint64_t orig_addr, uint64_t cycle)
+	void HybridSystem::WriteDoneCallback(uint sysID, uint64_t id, uint64_t orig_addr, uint64_t cycle)
 	{
-		if (WriteDone != NULL)
+		uint64_t callback_addr = orig_addr;
+		if (REMAP_MMIO)
 		{
-			uint64_t callback_addr = orig_addr;
-			if (REMAP_MMIO)
+			if (orig_addr >= THREEPOINTFIVEGB)
 			{
-				if (orig_addr >= THREEPOINTFIVEGB)
-				{
-					// Give the same address in the callback that we originally received.
-					callback_addr += HALFGB;
-				}
+				// Give the same address in the callback that we originally received.
+				callback_addr += HALFGB;
 			}
+		}
 
-			// Call the callback.
+		// Call the callbacks.
+		if (WriteDone != NULL)
 			(*WriteDone)(sysID, callback_addr, cycle);
-		}
+		if (WriteDoneId != NULL)
+			(*WriteDoneId)(id, callback_addr, cycle);
 
 		// Finish the logging for this access.
-		if (ENABLE_LOGGER)
-			log.access_stop(orig_addr);
+		this->trace(id, TransactionTrace::TRACE_COMPLETE, 1);
+		if (LOGGER_ON)
+			log.access_stop(id);
 	}
 
 	void HybridSystem::reportPower()
@@ -1477,11 +1829,121 @@ namespace HybridSim {
 
 	string HybridSystem::SetOutputFileName(string tracefilename) { return ""; }
 
+	void HybridSystem::open_live_stats(string name)
+	{
+		if (LIVE_STATS_PERIOD == 0)
+		{
+			cerr << "ERROR: LIVE_STATS_PERIOD must be greater than 0.\n";
+			abort();
+		}
+
+		vector<pair<string, uint64_t> > r = this->live_stats_record(false, 0);
+		vector<string> names;
+		for (size_t i = 0; i < r.size(); i++)
+			names.push_back(r[i].first);
+		live_stats.open(name, names);
+		next_live_stats_cycle = currentClockCycle;
+	}
+
+	static uint64_t host_ns()
+	{
+		return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	vector<pair<string, uint64_t> > HybridSystem::live_stats_record(bool finished, uint64_t now_ns)
+	{
+		// The Logger only adds up the queue length and idle cycles when they change, so bring them up to date.
+		if (LOGGER_ON)
+			log.settle(currentClockCycle);
+
+		// Simulated cycles per host second since the last snapshot.
+		uint64_t rate = 0;
+		if ((live_stats_last_ns != 0) && (now_ns > live_stats_last_ns))
+			rate = (uint64_t)((currentClockCycle - live_stats_last_cycle) * 1e9 / (now_ns - live_stats_last_ns));
+
+		// Everything is for the whole run so far. The order is the order of the values in the segment.
+		vector<pair<string, uint64_t> > r;
+		r.push_back(make_pair("pid", (uint64_t)getpid()));
+		r.push_back(make_pair("finished", (uint64_t)finished));
+		r.push_back(make_pair("cycle", currentClockCycle));
+		r.push_back(make_pair("cycles_per_second", rate));
+		r.push_back(make_pair("accesses", LOGGER_ON ? log.num_accesses : 0));
+		r.push_back(make_pair("reads", LOGGER_ON ? log.num_reads : 0));
+		r.push_back(make_pair("writes", LOGGER_ON ? log.num_writes : 0));
+		r.push_back(make_pair("hits", LOGGER_ON ? log.num_hits : 0));
+		r.push_back(make_pair("misses", LOGGER_ON ? log.num_misses : 0));
+		r.push_back(make_pair("read_hits", LOGGER_ON ? log.num_read_hits : 0));
+		r.push_back(make_pair("read_misses", LOGGER_ON ? log.num_read_misses : 0));
+		r.push_back(make_pair("write_hits", LOGGER_ON ? log.num_write_hits : 0));
+		r.push_back(make_pair("write_misses", LOGGER_ON ? log.num_write_misses : 0));
+		r.push_back(make_pair("sum_latency", LOGGER_ON ? log.sum_latency : 0));
+		r.push_back(make_pair("trans_queue", trans_queue_size));
+		r.push_back(make_pair("dram_queue", (uint64_t)dram_queue.size()));
+		r.push_back(make_pair("flash_queue", (uint64_t)flash_queue.size()));
+		r.push_back(make_pair("dram_pending", (uint64_t)dram_pending.size()));
+		r.push_back(make_pair("flash_pending", (uint64_t)flash_pending.size()));
+		r.push_back(make_pair("pending_pages", (uint64_t)pending_pages.size()));
+		r.push_back(make_pair("max_queue_length", LOGGER_ON ? log.max_queue_length : 0));
+		r.push_back(make_pair("idle_cycles", LOGGER_ON ? log.idle_counter : 0));
+		r.push_back(make_pair("flash_idle_cycles", LOGGER_ON ? log.flash_idle_counter : 0));
+		r.push_back(make_pair("dram_idle_cycles", LOGGER_ON ? log.dram_idle_counter : 0));
+		r.push_back(make_pair("tlb_hits", tlb_hits));
+		r.push_back(make_pair("tlb_misses", tlb_misses));
+		r.push_back(make_pair("prefetches", total_prefetches));
+		r.push_back(make_pair("unused_prefetches", unused_prefetches));
+		r.push_back(make_pair("prefetch_hit_nops", prefetch_hit_nops));
+		r.push_back(make_pair("stream_buffer_hits", stream_buffer_hits));
+		r.push_back(make_pair("unique_stream_buffers", unique_stream_buffers));
+		r.push_back(make_pair("functional_accesses", functional_accesses));
+		return r;
+	}
+
+	void HybridSystem::publish_live_stats(bool finished)
+	{
+		uint64_t now_ns = host_ns();
+		vector<pair<string, uint64_t> > r = this->live_stats_record(finished, now_ns);
+		vector<uint64_t> values(r.size());
+		for (size_t i = 0; i < r.size(); i++)
+			values[i] = r[i].second;
+		live_stats.publish(values);
+
+		live_stats_last_cycle = currentClockCycle;
+		live_stats_last_ns = now_ns;
+		next_live_stats_cycle = currentClockCycle + LIVE_STATS_PERIOD;
+	}
+
+	void HybridSystem::close_live_stats()
+	{
+		// Mark the snapshot as final and remove the segment's name. A tool that is already attached still
+		// sees the final snapshot.
+		if (!live_stats.is_open())
+			return;
+		this->publish_live_stats(true);
+		live_stats.close(true);
+	}
+
+	void HybridSystem::close_streams()
+	{
+		// Flush and close every file that is written through a buffer. They are reopened (appending) on the
+		// next write.
+		log.close_streams();
+		full_trace.close();
+		nvdimm_trace.close();
+	}
+
 	void HybridSystem::printLogfile()
 	{
 		// Save the cache table if necessary.
 		saveCacheTable();
 
+		this->close_live_stats();
+
+		if (flash_thread != NULL)
+			flash_thread->wait();
+		full_trace.flush();
+		nvdimm_trace.flush();
+		cerr << "DRAM updates: " << dram_clock.backend_cycles << "\n";
+		cerr << "Flash updates: " << ((flash_thread != NULL) ? flash_thread->flash_clock.backend_cycles : flash_clock.backend_cycles) << "\n";
 		cerr << "TLB Misses: " << tlb_misses << "\n";
 		cerr << "TLB Hits: " << tlb_hits << "\n";
 		cerr << "Total prefetches: " << total_prefetches << "\n";
@@ -1490,6 +1952,13 @@ namespace HybridSim {
 		cerr << "Prefetch hit NOPs: " << prefetch_hit_nops << "\n";
 		cerr << "Prefetch cheat count: " << prefetch_cheat_count << "\n";
 
+		if (functional_ticks > 0)
+		{
+			cerr << "Functional accesses: " << functional_accesses << "\n";
+			cerr << "Functional misses: " << functional_misses << "\n";
+			cerr << "Functional accesses skipped (page busy): " << functional_skipped << "\n";
+		}
+
 		if (ENABLE_STREAM_BUFFER)
 		{
 			cerr << "Unique one misses: " << unique_one_misses << "\n";
@@ -1497,10 +1966,22 @@ namespace HybridSim {
 			cerr << "Stream buffers hits: " << stream_buffer_hits << "\n";
 		}
 
+#ifdef HYBRIDSIM_PROFILE
+		profiler.print(cerr);
+#endif
+
+		if (transaction_trace.enabled())
+		{
+			uint64_t traced = transaction_trace.write_chrome("hybridsim_transactions.json");
+			cerr << "Transaction trace: " << traced << " accesses written to hybridsim_transactions.json\n";
+		}
+
 		// Print out the log file.
-		if (ENABLE_LOGGER)
+		if (LOGGER_ON)
 		{
 			log.print();
+			if (flash_thread != NULL)
+				flash_thread->wait();
 			flash->saveStats();
 		}
 	}
@@ -1592,6 +2073,7 @@ namespace HybridSim {
 				// This is a point of weirdness with the replay warmup design (since we can't restore the system
 				// exactly as it was), but it is unavoidable. In flight transactions are simply lost. Although, if
 				// replay warmup is done right, the system should run until all transactions are processed.
+				// Use saveCheckpoint()/loadCheckpoint() to keep the in flight transactions.
 				line.locked = false;
 
 				// Put this in the cache.
@@ -1600,7 +2082,7 @@ namespace HybridSim {
 		
 			inFile.close();
 
-			flash->loadNVState(NVDIMM_RESTORE_FILE);
+			flash->loadState(NVDIMM_RESTORE_FILE);
 		}
 	}
 
@@ -1640,10 +2122,199 @@ namespace HybridSim {
 
 			savefile.close();
 
-			flash->saveNVState(NVDIMM_SAVE_FILE);
+			if (flash_thread != NULL)
+				flash_thread->wait();
+			flash->saveState(NVDIMM_SAVE_FILE);
 		}
 	}
 
+	void HybridSystem::saveCheckpoint(string filename)
+	{
+		ofstream out;
+		out.open(filename.c_str(), ios_base::out | ios_base::trunc);
+		if (!out.is_open())
+		{
+			cerr << "ERROR: Failed to open checkpoint file: " << filename << "\n";
+			abort();
+		}
+		saveCheckpoint(out);
+		out.close();
+
+		cerr << "Saved checkpoint at cycle " << currentClockCycle << " to " << filename << "\n";
+	}
+
+	void HybridSystem::loadCheckpoint(string filename)
+	{
+		ifstream in;
+		in.open(filename.c_str(), ifstream::in);
+		if (!in.is_open())
+		{
+			cerr << "ERROR: Failed to open checkpoint file: " << filename << "\n";
+			abort();
+		}
+		loadCheckpoint(in);
+		in.close();
+
+		cerr << "Resumed from checkpoint " << filename << " at cycle " << currentClockCycle << "\n";
+	}
+
+	void HybridSystem::saveCheckpoint(ostream &out)
+	{
+		// The flash state lives on another thread, so it cannot be saved.
+		if (flash_thread != NULL)
+		{
+			cerr << "ERROR: Checkpoints do not work with FLASH_THREAD.\n";
+			abort();
+		}
+
+		// A checkpoint is a sync point for the debug traces (a resumed run starts new ones).
+		full_trace.flush();
+		nvdimm_trace.flush();
+
+		// Parameters that must match when the checkpoint is loaded.
+		checkpoint_section(out, "hybridsim_checkpoint");
+		out << PAGE_SIZE << " " << SET_SIZE << " " << CACHE_PAGES << " " << TOTAL_PAGES << " " << LOGGER_ON << "\n";
+		out << DRAM_BACKEND << " " << FLASH_BACKEND << "\n";
+
+		// Controller state.
+		checkpoint_section(out, "controller");
+		out << currentClockCycle << " " << check_queue << " " << delay_counter << " " << active_transaction_flag << " " 
+			<< pending_count << " " << dram_writes_outstanding << " " << flash_writes_outstanding << " " << next_transaction_id << " " << next_internal_id << "\n";
+		checkpoint_write(out, active_transaction);
+		out << max_dram_pending << " " << pending_pages_max << " " << trans_queue_max << " " << trans_queue_size << "\n";
+		out << dram_clock.accumulator << " " << dram_clock.backend_cycles << " " 
+			<< flash_clock.accumulator << " " << flash_clock.backend_cycles << "\n";
+		out << functional_accesses_left << " " << functional_ticks << " " << functional_accesses << " " 
+			<< functional_misses << " " << functional_skipped << "\n";
+
+		checkpoint_section(out, "cache");
+		checkpoint_write(out, cache);
+
+		checkpoint_section(out, "queues");
+		checkpoint_write(out, trans_queue);
+		checkpoint_write(out, dram_queue);
+		checkpoint_write(out, flash_queue);
+
+		checkpoint_section(out, "pending");
+		checkpoint_write(out, dram_pending);
+		checkpoint_write(out, flash_pending);
+		checkpoint_write(out, dram_pending_wait);
+		checkpoint_write(out, flash_pending_wait);
+		checkpoint_write(out, dram_pending_set);
+		checkpoint_write(out, dram_bad_address);
+
+		checkpoint_section(out, "contention");
+		checkpoint_write(out, pending_flash_addr);
+		checkpoint_write(out, pending_pages);
+		checkpoint_write(out, set_counter);
+
+		checkpoint_section(out, "tlb");
+		checkpoint_write(out, tlb_base_set);
+		out << tlb_misses << " " << tlb_hits << "\n";
+
+		checkpoint_section(out, "prefetch");
+		out << total_prefetches << " " << unused_prefetches << " " << unused_prefetch_victims << " " << prefetch_hit_nops << " " 
+			<< prefetch_cheat_count << "\n";
+		checkpoint_write(out, prefetch_counter);
+		checkpoint_write(out, prefetch_cheat_map);
+		// The perfect prefetches that have not been issued yet (the constructor loaded the whole prefetch file).
+		checkpoint_write(out, prefetch_access_number);
+		checkpoint_write(out, prefetch_flush_addr);
+		checkpoint_write(out, prefetch_new_addr);
+
+		checkpoint_section(out, "stream_buffer");
+		checkpoint_write(out, one_miss_table);
+		checkpoint_write(out, stream_buffers);
+		out << unique_one_misses << " " << unique_stream_buffers << " " << stream_buffer_hits << "\n";
+
+		if (LOGGER_ON)
+			log.saveCheckpoint(out);
+
+		// The backends save their own state.
+		dram->saveCheckpoint(out);
+		flash->saveCheckpoint(out);
+
+		checkpoint_section(out, "end");
+	}
+
+	void HybridSystem::loadCheckpoint(istream &in)
+	{
+		if (flash_thread != NULL)
+		{
+			cerr << "ERROR: Checkpoints do not work with FLASH_THREAD.\n";
+			abort();
+		}
+
+		checkpoint_expect(in, "hybridsim_checkpoint");
+		uint64_t page_size, set_size, cache_pages, total_pages, enable_logger;
+		string dram_backend, flash_backend;
+		in >> page_size >> set_size >> cache_pages >> total_pages >> enable_logger >> dram_backend >> flash_backend;
+		if ((page_size != PAGE_SIZE) || (set_size != SET_SIZE) || (cache_pages != CACHE_PAGES) || (total_pages != TOTAL_PAGES) ||
+				(enable_logger != (uint64_t)LOGGER_ON) || (dram_backend != DRAM_BACKEND) || (flash_backend != FLASH_BACKEND))
+		{
+			cerr << "ERROR: Attempted to load a checkpoint and PAGE_SIZE, SET_SIZE, CACHE_PAGES, TOTAL_PAGES, ENABLE_LOGGER "
+				<< "(or a STATS=none build), DRAM_BACKEND or FLASH_BACKEND does not match in the checkpoint and ini file.\n";
+			abort();
+		}
+
+		checkpoint_expect(in, "controller");
+		uint64_t check_queue_flag, active_flag;
+		in >> currentClockCycle >> check_queue_flag >> delay_counter >> active_flag >> pending_count 
+			>> dram_writes_outstanding >> flash_writes_outstanding >> next_transaction_id >> next_internal_id;
+		check_queue = check_queue_flag;
+		active_transaction_flag = active_flag;
+		checkpoint_read(in, active_transaction);
+		in >> max_dram_pending >> pending_pages_max >> trans_queue_max >> trans_queue_size;
+		in >> dram_clock.accumulator >> dram_clock.backend_cycles >> flash_clock.accumulator >> flash_clock.backend_cycles;
+		in >> functional_accesses_left >> functional_ticks >> functional_accesses >> functional_misses >> functional_skipped;
+
+		checkpoint_expect(in, "cache");
+		checkpoint_read(in, cache);
+
+		checkpoint_expect(in, "queues");
+		checkpoint_read(in, trans_queue);
+		checkpoint_read(in, dram_queue);
+		checkpoint_read(in, flash_queue);
+
+		checkpoint_expect(in, "pending");
+		checkpoint_read(in, dram_pending);
+		checkpoint_read(in, flash_pending);
+		checkpoint_read(in, dram_pending_wait);
+		checkpoint_read(in, flash_pending_wait);
+		checkpoint_read(in, dram_pending_set);
+		checkpoint_read(in, dram_bad_address);
+
+		checkpoint_expect(in, "contention");
+		checkpoint_read(in, pending_flash_addr);
+		checkpoint_read(in, pending_pages);
+		checkpoint_read(in, set_counter);
+
+		checkpoint_expect(in, "tlb");
+		checkpoint_read(in, tlb_base_set);
+		in >> tlb_misses >> tlb_hits;
+
+		checkpoint_expect(in, "prefetch");
+		in >> total_prefetches >> unused_prefetches >> unused_prefetch_victims >> prefetch_hit_nops >> prefetch_cheat_count;
+		checkpoint_read(in, prefetch_counter);
+		checkpoint_read(in, prefetch_cheat_map);
+		checkpoint_read(in, prefetch_access_number);
+		checkpoint_read(in, prefetch_flush_addr);
+		checkpoint_read(in, prefetch_new_addr);
+
+		checkpoint_expect(in, "stream_buffer");
+		checkpoint_read(in, one_miss_table);
+		checkpoint_read(in, stream_buffers);
+		in >> unique_one_misses >> unique_stream_buffers >> stream_buffer_hits;
+
+		if (LOGGER_ON)
+			log.loadCheckpoint(in);
+
+		dram->loadCheckpoint(in);
+		flash->loadCheckpoint(in);
+
+		checkpoint_expect(in, "end");
+	}
+
 
 
 	// Page Contention functions
@@ -1846,6 +2517,7 @@ namespace HybridSim {
 		p.victim_valid = false; // MUST SET THIS TO FALSE SINCE SYNC PAGE AND VICTIM PAGE MATCH.
 		p.callback_sent = false;
 		p.type = trans.transactionType;
+		p.id = trans.id;
 
 		// The line MUST be dirty for a sync operation to be valid.
 		assert(cur_line.dirty);
@@ -1899,7 +2571,7 @@ namespace HybridSim {
 	void HybridSystem::addSync(uint64_t addr)
 	{
 		// Create flush transaction.
-		Transaction t = Transaction(SYNC, addr, NULL);
+		Transaction t = Transaction(SYNC, addr, NULL, next_internal_id++);
 
 		// Push the operation onto the front of the transaction queue so it stays at the front.
 		trans_queue.push_front(t);
@@ -1917,7 +2589,7 @@ namespace HybridSim {
 	void HybridSystem::addSyncCounter(uint64_t addr, bool initial)
 	{
 		// Create flush transaction.
-		Transaction t = Transaction(SYNC_ALL_COUNTER, addr, NULL);
+		Transaction t = Transaction(SYNC_ALL_COUNTER, addr, NULL, next_internal_id++);
 
 		if (initial)
 		{
@@ -2007,12 +2679,14 @@ namespace HybridSim {
 		addSyncCounter(0, true);
 	}
 
-	void HybridSystem::check_tlb(uint64_t page_addr)
+	bool HybridSystem::check_tlb(uint64_t page_addr)
 	{
+		// Returns true on a TLB miss.
+
 		// A TLB_SIZE of 0 disables the TLB.
 		// This means we always have the tags in SRAM on the CPU.
 		if (TLB_SIZE == 0)
-			return;
+			return false;
 
 		// TLB processing code.
 		uint64_t tlb_base_addr = TLB_BASE_ADDRESS(page_addr);
@@ -2047,17 +2721,18 @@ namespace HybridSim {
 			assert(tlb_base_set.size() < TLB_MAX_ENTRIES);
 			
 			// Insert the new page with the current clock cycle.
-			tlb_base_set[tlb_base_addr] = currentClockCycle;
+			tlb_base_set[tlb_base_addr] = lru_cycle();
 
-			// Add TLB_MISS_DELAY to the controller delay.
-			delay_counter += TLB_MISS_DELAY;
+			return true;
 		}
 		else
 		{
 			// TLB hit. Just update the timestamp for the LRU algorithm.
 			//cerr << "TLB hit with address " << page_addr << ".\n";
 			tlb_hits++;
-			tlb_base_set[tlb_base_addr] = currentClockCycle;
+			tlb_base_set[tlb_base_addr] = lru_cycle();
+
+			return false;
 		}
 	}
 
@@ -2067,139 +2742,127 @@ namespace HybridSim {
 		if ((miss_page == 0) || (miss_page == (TOTAL_PAGES - 1)*PAGE_SIZE))
 			return;
 
-		// Calculate the neighboring pages.
-		uint64_t prior_page = miss_page - PAGE_SIZE;
-		uint64_t next_page = miss_page + PAGE_SIZE;
-
-		// Look through the one miss table to see if there are any matches.
-		bool stream_detected = false;
-		list<pair<uint64_t, uint64_t> >::iterator it;
-		for (it=one_miss_table.begin(); it != one_miss_table.end(); it++)
+		if (one_miss_table.erase(miss_page))
 		{
-			uint64_t entry_page = (*it).first;
-			//uint64_t entry_cycle = (*it).second;
-
-			if (entry_page == miss_page)
-			{
-				// Somehow we managed to miss the same page twice in a short period of time.
-				// Go ahead and remove this entry to make room for this to be readded.
-				it = one_miss_table.erase(it);
-
-				if (DEBUG_STREAM_BUFFER)
-					cerr << currentClockCycle << " : Stream buffer one miss double hit. miss_page=" << miss_page << "\n";
-			}
-			if (entry_page == prior_page)
-			{
-				// Stream detected!
-				stream_detected = true;
-
-				if (DEBUG_STREAM_BUFFER)
-					cerr << currentClockCycle << " : New stream detected. Allocating stream buffer at addr " << next_page << "\n";
-
-
-				// Remove the entry for the prior page.
-				it = one_miss_table.erase(it);
-
-				// Save the next page in the stream buffer table
-				// This is the address we will detect on a hit to the buffer.
-				stream_buffers[next_page] = currentClockCycle;
-				unique_stream_buffers++;
-
-				if (stream_buffers.size() > NUM_STREAM_BUFFERS)
-				{
-					// Evict stream buffer with oldest cycle.
-					unordered_map<uint64_t, uint64_t>::iterator sb_it;
-					uint64_t oldest_key = 0;
-					uint64_t oldest_cycle = currentClockCycle;
-					for (sb_it=stream_buffers.begin(); sb_it != stream_buffers.end(); sb_it++)
-					{
-						uint64_t cur_sb_cycle = (*sb_it).second;
-						if (cur_sb_cycle < oldest_cycle)
-						{
-							oldest_key = (*sb_it).first;
-							oldest_cycle = cur_sb_cycle;
-						}
-					}
-					stream_buffers.erase(oldest_key);
-
-					if (DEBUG_STREAM_BUFFER)
-						cerr << currentClockCycle << " : Stream buffer evicted addr=" << oldest_key << "\n";
-				}
-
-				// Issue prefetches to start the stream.
-				// Count down from the top address. This must be done because addPrefetch puts transactions at the front
-				// of the queue and we want page_addr+PAGE_SIZE to be the first prefetch issued.
-				for (int i=STREAM_BUFFER_LENGTH; i > 0; i--)
-				{
-					// Compute the next prefetch address.
-					uint64_t prefetch_address = miss_page + (i * PAGE_SIZE);
+			// Somehow we managed to miss the same page twice in a short period of time.
+			// Go ahead and remove this entry to make room for this to be readded.
+			if (DEBUG_STREAM_BUFFER)
+				cerr << currentClockCycle << " : Stream buffer one miss double hit. miss_page=" << miss_page << "\n";
+		}
 
-					// If address is above the legal address space for the main memory, then do not issue this prefetch.
-					if (prefetch_address >= (TOTAL_PAGES * PAGE_SIZE))
-						continue;
+		// Look for an earlier miss that this one continues, trying the shortest stride first (and ascending
+		// before descending streams).
+		int64_t stride = 0;
+		for (uint64_t i = 1; (i <= STREAM_BUFFER_MAX_STRIDE) && (stride == 0); i++)
+		{
+			uint64_t distance = i * PAGE_SIZE;
+			if ((miss_page >= distance) && (one_miss_table.find(miss_page - distance) != NULL))
+				stride = distance;
+			else if ((STREAM_BUFFER_DESCENDING) && (miss_page + distance < TOTAL_PAGES * PAGE_SIZE) && 
+					(one_miss_table.find(miss_page + distance) != NULL))
+				stride = -(int64_t)distance;
+		}
 
-					// Add the prefetch.
-					addPrefetch(prefetch_address);
-				}
+		if (stride != 0)
+		{
+			// Stream detected!
+			uint64_t next_page = miss_page + stride;
 
-				break;
-			}
+			if (DEBUG_STREAM_BUFFER)
+				cerr << currentClockCycle << " : New stream detected. Allocating stream buffer at addr " << next_page 
+					<< " stride=" << stride << "\n";
+
+			// Remove the entry for the prior page.
+			one_miss_table.erase(miss_page - stride);
+
+			// Save the next page in the stream buffer table
+			// This is the address we will detect on a hit to the buffer.
+			StreamBuffer stream;
+			stream.stride = stride;
+			stream.depth = STREAM_BUFFER_LENGTH;
+			stream.last_prefetch = miss_page + STREAM_BUFFER_LENGTH * stride;
+			stream.cycle = lru_cycle();
+			uint64_t evicted;
+			if (stream_buffers.insert(next_page, stream, &evicted) && DEBUG_STREAM_BUFFER)
+				cerr << currentClockCycle << " : Stream buffer evicted addr=" << evicted << "\n";
+			unique_stream_buffers++;
+
+			// Issue prefetches to start the stream.
+			this->stream_buffer_prefetch(miss_page, stride, 1, STREAM_BUFFER_LENGTH);
 		}
-
-		if (!stream_detected)
+		else
 		{
 			// Insert miss address into the one_miss_table.
-			one_miss_table.push_back(make_pair(miss_page, currentClockCycle));
+			uint64_t evicted;
+			if (one_miss_table.insert(miss_page, lru_cycle(), &evicted) && DEBUG_STREAM_BUFFER)
+				cerr << currentClockCycle << " : One miss evicted addr=" << evicted << "\n";
 			unique_one_misses++;
 
 			if (DEBUG_STREAM_BUFFER)
 				cerr << currentClockCycle << " : One miss detected addr=" << miss_page << "\n";
 		}
-
-		// Enforce the size of the one miss table.
-		if (one_miss_table.size() > ONE_MISS_TABLE_SIZE)
-		{
-			if (DEBUG_STREAM_BUFFER)
-			{
-				cerr << currentClockCycle << " : One miss evicted addr=" << one_miss_table.front().first << "\n";
-			}
-
-			one_miss_table.pop_front();
-		}
-
 	}
 
 	void HybridSystem::stream_buffer_hit_handler(uint64_t hit_page)
 	{
-		if (stream_buffers.count(hit_page) == 1)
+		StreamBuffer *found = stream_buffers.find(hit_page);
+		if (found != NULL)
 		{
 			// Stream buffer hit!
 			stream_buffer_hits++;
 
-			uint64_t next_page = hit_page + PAGE_SIZE;
-			uint64_t prefetch_address = hit_page + (STREAM_BUFFER_LENGTH * PAGE_SIZE);
+			StreamBuffer stream = *found;
+			uint64_t next_page = hit_page + stream.stride;
+
+			// Every hit shows the stream is being used, so run one more page ahead of it (up to the maximum).
+			if (stream.depth < STREAM_BUFFER_MAX_LENGTH)
+				stream.depth++;
+			uint64_t prefetch_address = hit_page + stream.depth * stream.stride;
 
 			if ((DEBUG_STREAM_BUFFER==1) && (DEBUG_STREAM_BUFFER_HIT==1))
 			{
 				cerr << currentClockCycle << " : Stream Buffer Hit. hit_page=" << hit_page
-					<< " prior cycle=" << stream_buffers[hit_page] << " next_page=" << next_page 
-					<< " prefetch_addr=" << prefetch_address << "\n";
+					<< " prior cycle=" << stream.cycle << " next_page=" << next_page 
+					<< " prefetch_addr=" << prefetch_address << " depth=" << stream.depth << "\n";
 			}
 
 			// Remove the current stream buffer entry and replace it with the next page.
 			stream_buffers.erase(hit_page);
 
-			// If the prefetch address is out of range, then do nothing.
+			// If the prefetch address is out of range (above or, for descending streams, below the address
+			// space), then the stream is done.
 			if (prefetch_address < (TOTAL_PAGES * PAGE_SIZE))
 			{
-				// If it is in range, add the prefetch and readd the stream buffer.
-				addPrefetch(prefetch_address);
-				stream_buffers[next_page] = currentClockCycle;
+				// If it is in range, add the prefetches up to it and readd the stream buffer.
+				uint64_t first = ((int64_t)(stream.last_prefetch - hit_page) / stream.stride) + 1;
+				this->stream_buffer_prefetch(hit_page, stream.stride, first, stream.depth);
+				stream.last_prefetch = prefetch_address;
+				stream.cycle = lru_cycle();
+				stream_buffers.insert(next_page, stream, NULL);
 			}
 		}
 
 	}
 
+	void HybridSystem::stream_buffer_prefetch(uint64_t page, int64_t stride, uint64_t first, uint64_t last)
+	{
+		// Prefetch page + i*stride for i from first to last.
+		// Count down from the furthest page. This must be done because addPrefetch puts transactions at the front
+		// of the queue and we want the page closest to the stream to be the first prefetch issued.
+		for (uint64_t i = last; i >= first; i--)
+		{
+			// Compute the next prefetch address.
+			uint64_t prefetch_address = page + i * stride;
+
+			// If address is outside the legal address space for the main memory, then do not issue this prefetch.
+			if (prefetch_address >= (TOTAL_PAGES * PAGE_SIZE))
+				continue;
+
+			// Add the prefetch.
+			addPrefetch(prefetch_address);
+		}
+	}
+
 
 // Extra functions for C interface (used by Python front end)
 class HybridSim_C_Callbacks
@@ -2324,6 +2987,36 @@ extern "C"
 		hs->printLogfile();
 	}
 
+	void HybridSim_C_setFunctional(HybridSystem *hs, uint64_t accesses)
+	{
+		hs->setFunctional(accesses);
+	}
+
+	bool HybridSim_C_isFunctional(HybridSystem *hs)
+	{
+		return hs->isFunctional();
+	}
+
+	bool HybridSim_C_isQuiescent(HybridSystem *hs)
+	{
+		return hs->isQuiescent();
+	}
+
+	uint64_t HybridSim_C_drain(HybridSystem *hs)
+	{
+		return hs->drain();
+	}
+
+	void HybridSim_C_saveCheckpoint(HybridSystem *hs, char *filename)
+	{
+		hs->saveCheckpoint(string(filename));
+	}
+
+	void HybridSim_C_loadCheckpoint(HybridSystem *hs, char *filename)
+	{
+		hs->loadCheckpoint(string(filename));
+	}
+
 }
 
 } // Namespace HybridSim
@@ -40,6 +40,12 @@
 #include "CallbackHybrid.h"
 #include "Logger.h"
 #include "IniReader.h"
+#include "MemoryBackend.h"
+#include "FlashThread.h"
+#include "Profiler.h"
+#include "LiveStats.h"
+#include "TransactionTrace.h"
+#include "LruTable.h"
 
 using std::string;
 typedef unsigned int uint;
@@ -53,6 +59,7 @@ namespace HybridSim
 		~HybridSystem();
 		void update();
 		bool addTransaction(bool isWrite, uint64_t addr);
+		bool addTransaction(bool isWrite, uint64_t addr, uint64_t &id);
 		bool addTransaction(Transaction &trans);
 		void addPrefetch(uint64_t prefetch_addr);
 		void addFlush(uint64_t flush_addr);
@@ -60,18 +67,24 @@ namespace HybridSim
 		void RegisterCallbacks(
 				TransactionCompleteCB *readDone,
 				TransactionCompleteCB *writeDone);
+		// Optional callbacks with the transaction id that addTransaction() assigned (made along with the callbacks above).
+		void RegisterIdCallbacks(
+				TransactionIdCompleteCB *readDone,
+				TransactionIdCompleteCB *writeDone);
 		void mmio(uint64_t operation, uint64_t address);
 		void syncAll();
-		void DRAMReadCallback(uint id, uint64_t addr, uint64_t cycle);
-		void DRAMWriteCallback(uint id, uint64_t addr, uint64_t cycle);
+		// Backend callbacks. cycle is the backend's own clock and is not used (completions are
+		// timed with currentClockCycle, and the flash thread passes its controller cycle stamp).
+		void DRAMReadCallback(uint64_t id, uint64_t addr, uint64_t cycle);
+		void DRAMWriteCallback(uint64_t id, uint64_t addr, uint64_t cycle);
 		void DRAMPowerCallback(double a, double b, double c, double d);
-		void FlashReadCallback(uint64_t id, uint64_t addr, uint64_t cycle, bool unmapped);
-		void FlashCriticalLineCallback(uint64_t id, uint64_t addr, uint64_t cycle, bool unmapped);
-		void FlashWriteCallback(uint64_t id, uint64_t addr, uint64_t cycle, bool unmapped);
+		void FlashReadCallback(uint64_t id, uint64_t addr, uint64_t cycle);
+		void FlashCriticalLineCallback(uint64_t id, uint64_t addr, uint64_t cycle);
+		void FlashWriteCallback(uint64_t id, uint64_t addr, uint64_t cycle);
 
 		// Functions to run the callbacks to the module using HybridSim.
-		void ReadDoneCallback(uint systemID, uint64_t orig_addr, uint64_t cycle);
-		void WriteDoneCallback(uint sysID, uint64_t orig_addr, uint64_t cycle);
+		void ReadDoneCallback(uint systemID, uint64_t id, uint64_t orig_addr, uint64_t cycle);
+		void WriteDoneCallback(uint sysID, uint64_t id, uint64_t orig_addr, uint64_t cycle);
 
 		void reportPower();
 		string SetOutputFileName(string tracefilename);
@@ -83,9 +96,32 @@ namespace HybridSim
 		void restoreCacheTable();
 		void saveCacheTable();
 
+		// Checkpoint/resume of the full simulation state. Unlike saveCacheTable(), this includes all in flight work
+		// (queues, pending tables, contention locks, the active transaction), the TLB and stream buffers, the logger
+		// and the backends, so a resumed run gives exactly the same results as a run that was never stopped.
+		// loadCheckpoint() must be called on a new HybridSystem built from the same ini file.
+		void saveCheckpoint(string filename);
+		void loadCheckpoint(string filename);
+		void saveCheckpoint(ostream &out);
+		void loadCheckpoint(istream &in);
+
+		// Functional (timing free) mode. The next accesses transactions added are applied to the cache tags,
+		// dirty bits, LRU state, TLB and stream buffers immediately and complete on the same cycle.
+		// Passing 0 returns to detailed simulation.
+		void setFunctional(uint64_t accesses);
+		bool isFunctional();
+
+		// isQuiescent() is true when there is no work left anywhere in the system: nothing queued or being
+		// looked up in the controller, no pending DRAM/flash reads and no posted DRAM/flash writes that
+		// have not called back yet. drain() calls update() until then and returns the number of cycles it took.
+		bool isQuiescent();
+		uint64_t drain();
+
 
 		// Helper functions
 		void ProcessTransaction(Transaction &trans);
+		void FunctionalAccess(Transaction &trans);
+		uint64_t lru_cycle();
 
 		void VictimRead(Pending p);
 		void VictimReadFinish(uint64_t addr, Pending p);
@@ -97,10 +133,10 @@ namespace HybridSim
 
 		void LineWrite(Pending p);
 
-		void CacheRead(uint64_t orig_addr, uint64_t flash_addr, uint64_t cache_addr);
+		void CacheRead(uint64_t id, uint64_t orig_addr, uint64_t flash_addr, uint64_t cache_addr);
 		void CacheReadFinish(uint64_t addr, Pending p);
 
-		void CacheWrite(uint64_t orig_addr, uint64_t flash_addr, uint64_t cache_addr);
+		void CacheWrite(uint64_t id, uint64_t orig_addr, uint64_t flash_addr, uint64_t cache_addr);
 		void CacheWriteFinish(Pending p);
 
 		void Flush(uint64_t cache_addr);
@@ -130,11 +166,12 @@ namespace HybridSim
 		void addSyncCounter(uint64_t addr, bool initial);
 
 		// TLB functions
-		void check_tlb(uint64_t page_addr);
+		bool check_tlb(uint64_t page_addr);
 
 		// Stream Buffer Functions
 		void stream_buffer_miss_handler(uint64_t miss_page);
 		void stream_buffer_hit_handler(uint64_t hit_page);
+		void stream_buffer_prefetch(uint64_t page, int64_t stride, uint64_t first, uint64_t last);
 		
 
 		// State
@@ -143,18 +180,48 @@ namespace HybridSim
 
 		TransactionCompleteCB *ReadDone;
 		TransactionCompleteCB *WriteDone;
+		TransactionIdCompleteCB *ReadDoneId;
+		TransactionIdCompleteCB *WriteDoneId;
 		uint systemID;
 
-		DRAMSim::MultiChannelMemorySystem *dram;
+		// The id the next addTransaction() will assign (ids start at 1). The callback can happen inside addTransaction()
+		// (functional mode and dropped MMIO accesses), so callers that track ids should read this before adding.
+		uint64_t next_transaction_id;
+		uint64_t next_internal_id; // Next id for a prefetch, flush or sync (starts at INTERNAL_ID_BASE).
+
+		// DRAM and NVRAM backends (DRAMSim/NVDIMMSim or the analytic models).
+		MemoryBackend *dram;
+
+		MemoryBackend *flash;
 
-		NVDSim::NVDIMM *flash;
+		// Backend completion callbacks (owned here, so they are freed with the backends).
+		BackendCompleteCB *read_cb;
+		BackendCompleteCB *write_cb;
+		BackendCompleteCB *nv_read_cb;
+		BackendCompleteCB *nv_write_cb;
+		BackendCompleteCB *nv_crit_cb;
+
+		// Clock crossing from the controller clock to each backend clock.
+		ClockDomain dram_clock;
+		ClockDomain flash_clock;
+
+		// Steps the flash on its own thread when FLASH_THREAD is set (NULL otherwise).
+		FlashThread *flash_thread;
 
 		unordered_map<uint64_t, cache_line> cache;
 
+		// Pending operations are keyed by transaction id when the backend returns the ids in its callbacks.
+		// DRAMSim and NVDIMMSim only return the address, so with them the tables are keyed by address
+		// (the burst address for CACHE_READ and the page address otherwise).
+		bool dram_ids;
+		bool flash_ids;
+		uint64_t dram_key(uint64_t id, uint64_t addr) { return dram_ids ? id : addr; }
+		uint64_t flash_key(uint64_t id, uint64_t addr) { return flash_ids ? id : addr; }
+
 		unordered_map<uint64_t, Pending> dram_pending;
 		unordered_map<uint64_t, Pending> flash_pending;
 
-		// Per page wait sets for the VICTIM_READ and LINE_READ operations.
+		// Per operation wait sets (same keys as above) for the bursts of the VICTIM_READ and LINE_READ operations.
 		unordered_map<uint64_t, unordered_set<uint64_t>> dram_pending_wait;
 		unordered_map<uint64_t, unordered_set<uint64_t>> flash_pending_wait;
 
@@ -170,6 +237,8 @@ namespace HybridSim
 		bool active_transaction_flag; // Indicates that a transaction is waiting for SRAM.
 
 		int64_t pending_count;
+		uint64_t dram_writes_outstanding; // Writes accepted by the DRAM that have not called back yet.
+		uint64_t flash_writes_outstanding; // Writes sent to the flash that have not called back yet.
 		set<uint64_t> dram_pending_set;
 		list<uint64_t> dram_bad_address;
 		uint64_t max_dram_pending;
@@ -194,8 +263,8 @@ namespace HybridSim
 		unordered_map<uint64_t, uint64_t> prefetch_counter;
 
 		ofstream debug_victim;
-		ofstream debug_nvdimm_trace;
-		ofstream debug_full_trace;
+		TraceWriter full_trace; // FULL_TRACE
+		TraceWriter nvdimm_trace; // NVDIMM_TRACE (written by the flash thread when there is one)
 
 		// TLB state
 		unordered_map<uint64_t, uint64_t> tlb_base_set; 
@@ -210,8 +279,8 @@ namespace HybridSim
 		uint64_t prefetch_cheat_count; // Count the number of cheat prefetches.
 
 		// Stream buffer state.
-		list<pair<uint64_t, uint64_t> > one_miss_table; // pair is (address, cycle)
-		unordered_map<uint64_t, uint64_t> stream_buffers; // address -> cycle
+		LruTable<uint64_t> one_miss_table; // missed page -> cycle
+		LruTable<StreamBuffer> stream_buffers; // next page expected in the stream -> stream
 
 		// Stream buffer tracking.
 		uint64_t unique_one_misses;
@@ -221,6 +290,37 @@ namespace HybridSim
 
 		unordered_map<uint64_t, uint64_t> prefetch_cheat_map;
 
+		// Functional mode state.
+		uint64_t functional_accesses_left; // Accesses left to process functionally.
+		uint64_t functional_ticks; // Added to currentClockCycle for LRU timestamps (one tick per functional access).
+		uint64_t functional_accesses;
+		uint64_t functional_misses;
+		uint64_t functional_skipped; // Functional accesses to pages locked by in flight detailed work.
+
+		// Lifecycle trace of a sample of the accesses (TRANSACTION_TRACE_SAMPLE).
+		TransactionTrace transaction_trace;
+		void trace(uint64_t id, TransactionTrace::EventType type, uint64_t data = 0)
+		{
+			if (transaction_trace.sampled(id))
+				transaction_trace.record(currentClockCycle, id, type, data);
+		}
+
+		// Live statistics in shared memory (LIVE_STATS).
+		LiveStats live_stats;
+		uint64_t next_live_stats_cycle;
+		uint64_t live_stats_last_cycle; // Cycle and host time of the last snapshot (for the simulation rate).
+		uint64_t live_stats_last_ns;
+		void open_live_stats(string name);
+		vector<pair<string, uint64_t> > live_stats_record(bool finished, uint64_t now_ns);
+		void publish_live_stats(bool finished);
+		void close_live_stats();
+		void close_streams();
+
+#ifdef HYBRIDSIM_PROFILE
+		// Host time spent in each stage of the simulator (make PROFILE=1).
+		Profiler profiler;
+#endif
+
 	};
 
 	HybridSystem *getMemorySystemInstance(uint id, string ini);
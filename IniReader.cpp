@@ -43,6 +43,22 @@ uint64_t ENABLE_LOGGER = 1;
 uint64_t EPOCH_LENGTH = 200000;
 uint64_t HISTOGRAM_BIN = 100;
 uint64_t HISTOGRAM_MAX = 20000;
+uint64_t HISTOGRAM_PRECISION = 7;
+string WORKING_SET_MODE = "exact";
+uint64_t WORKING_SET_HLL_BITS = 14;
+uint64_t HOT_PAGES = 32;
+uint64_t HOT_PAGE_SKETCH_WIDTH = 16384;
+uint64_t HOT_PAGE_SKETCH_DEPTH = 4;
+string MISSED_PAGE_LOG = "epoch";
+uint64_t MISSED_PAGE_BUFFER = 65536;
+string EPOCH_STATS = "jsonl";
+string LIVE_STATS = "none";
+uint64_t LIVE_STATS_PERIOD = 100000;
+uint64_t TRANSACTION_TRACE_SAMPLE = 0;
+uint64_t TRANSACTION_TRACE_BUFFER = 262144;
+string FULL_TRACE = "none";
+string NVDIMM_TRACE = "none";
+uint64_t DEBUG_TRACE_BUFFER = 1048576;
 
 // these values are also specified in the ini file of the nvdimm but have a different name
 uint64_t PAGE_SIZE = 4096; // in bytes, so divide this by 64 to get the number of DDR3 transfers per page
@@ -63,6 +79,53 @@ uint64_t CACHE_PAGES = 1048576/4; // 1 GB
 // Need to confirm this and make it more flexible later.
 uint64_t CYCLES_PER_SECOND = 667000000;
 
+// Backend selection ("dramsim" or "analytic" for DRAM, "nvdimmsim" or "analytic" for flash)
+string DRAM_BACKEND = "dramsim";
+string FLASH_BACKEND = "nvdimmsim";
+
+// Analytic backend parameters (latencies and transfer times are in backend clock cycles)
+uint64_t ANALYTIC_DRAM_READ_LATENCY = 40;
+uint64_t ANALYTIC_DRAM_WRITE_LATENCY = 40;
+uint64_t ANALYTIC_DRAM_TRANSFER_CYCLES = 4;
+uint64_t ANALYTIC_DRAM_CHANNELS = 1;
+uint64_t ANALYTIC_DRAM_QUEUE_DEPTH = 32;
+uint64_t ANALYTIC_FLASH_READ_LATENCY = 16675;
+uint64_t ANALYTIC_FLASH_WRITE_LATENCY = 133400;
+uint64_t ANALYTIC_FLASH_TRANSFER_CYCLES = 1334;
+uint64_t ANALYTIC_FLASH_CHANNELS = 8;
+uint64_t ANALYTIC_FLASH_QUEUE_DEPTH = 64;
+
+// Backend clocks in Hz (0 means update once per controller cycle)
+uint64_t DRAM_CYCLES_PER_SECOND = 0;
+uint64_t FLASH_CYCLES_PER_SECOND = 0;
+
+// Flash thread (0 steps the NVDIMM on the controller thread)
+uint64_t FLASH_THREAD = 0;
+
+// Stream buffer prefetcher
+uint64_t ENABLE_STREAM_BUFFER = 1;
+uint64_t ONE_MISS_TABLE_SIZE = 10;
+uint64_t NUM_STREAM_BUFFERS = 10;
+uint64_t STREAM_BUFFER_LENGTH = 4;
+uint64_t STREAM_BUFFER_MAX_LENGTH = 4;
+uint64_t STREAM_BUFFER_MAX_STRIDE = 1;
+uint64_t STREAM_BUFFER_DESCENDING = 0;
+
+// Number of accesses at the start of the run to process in functional mode (cache warmup)
+uint64_t FUNCTIONAL_ACCESSES = 0;
+
+// Sampled simulation in the trace based simulator (SAMPLING_PERIOD of 0 disables sampling)
+uint64_t SAMPLING_PERIOD = 0;
+uint64_t SAMPLING_WARMUP = 2000;
+uint64_t SAMPLING_DETAILED = 1000;
+
+// Closed loop core model in the trace based simulator
+uint64_t CORES = 1;
+uint64_t CORE_MLP = 36;
+uint64_t CORE_DEPENDENT_READS = 0;
+uint64_t CORE_LOOKAHEAD = 16;
+string CORE_IPC_SCALE = "1";
+
 // INI files
 string dram_ini = "ini/DDR3_micron_8M_8B_x8_sg15.ini";
 string flash_ini = "ini/samsung_K9XXG08UXM(mod).ini";
@@ -127,55 +190,154 @@ string NVDIMM_SAVE_FILE = "none";
 			string key = split_line.front();
 			string value = split_line.back();
 
-			// Place the value into the appropriate global.
-			if (key.compare("CONTROLLER_DELAY") == 0)
-				convert_uint64_t(CONTROLLER_DELAY, value, key);
-			else if (key.compare("ENABLE_LOGGER") == 0)
-				convert_uint64_t(ENABLE_LOGGER, value, key);
-			else if (key.compare("EPOCH_LENGTH") == 0)
-				convert_uint64_t(EPOCH_LENGTH, value, key);
-			else if (key.compare("HISTOGRAM_BIN") == 0)
-				convert_uint64_t(HISTOGRAM_BIN, value, key);
-			else if (key.compare("HISTOGRAM_MAX") == 0)
-				convert_uint64_t(HISTOGRAM_MAX, value, key);
-			else if (key.compare("PAGE_SIZE") == 0)
-				convert_uint64_t(PAGE_SIZE, value, key);
-			else if (key.compare("SET_SIZE") == 0)
-				convert_uint64_t(SET_SIZE, value, key);
-			else if (key.compare("BURST_SIZE") == 0)
-				convert_uint64_t(BURST_SIZE, value, key);
-			else if (key.compare("FLASH_BURST_SIZE") == 0)
-				convert_uint64_t(FLASH_BURST_SIZE, value, key);
-			else if (key.compare("TOTAL_PAGES") == 0)
-				convert_uint64_t(TOTAL_PAGES, value, key);
-			else if (key.compare("CACHE_PAGES") == 0)
-				convert_uint64_t(CACHE_PAGES, value, key);
-			else if (key.compare("CYCLES_PER_SECOND") == 0)
-				convert_uint64_t(CYCLES_PER_SECOND, value, key);
-			else if (key.compare("dram_ini") == 0)
-				dram_ini = value;
-			else if (key.compare("flash_ini") == 0)
-				flash_ini = value;
-			else if (key.compare("sys_ini") == 0)
-				sys_ini = value;
-			else if (key.compare("ENABLE_RESTORE") == 0)
-				convert_uint64_t(ENABLE_RESTORE, value, key);
-			else if (key.compare("ENABLE_SAVE") == 0)
-				convert_uint64_t(ENABLE_SAVE, value, key);
-			else if (key.compare("HYBRIDSIM_RESTORE_FILE") == 0)
-				HYBRIDSIM_RESTORE_FILE = value;
-			else if (key.compare("HYBRIDSIM_SAVE_FILE") == 0)
-				HYBRIDSIM_SAVE_FILE = value;
-			else if (key.compare("NVDIMM_RESTORE_FILE") == 0)
-				NVDIMM_RESTORE_FILE = value;
-			else if (key.compare("NVDIMM_SAVE_FILE") == 0)
-				NVDIMM_SAVE_FILE = value;
-			else
-			{
-				cerr << "ERROR: Illegal key/value pair in HybridSim ini file: " << key << "=" << value << "\n";
-				cerr << "This could either be due to an illegal key or the incorrect value type for a key\n";
-				abort();
-			}
+			set(key, value);
+		}
+	}
+
+	void IniReader::set(string key, string value)
+	{
+		// Place the value into the appropriate global.
+		if (key.compare("CONTROLLER_DELAY") == 0)
+			convert_uint64_t(CONTROLLER_DELAY, value, key);
+		else if (key.compare("ENABLE_LOGGER") == 0)
+			convert_uint64_t(ENABLE_LOGGER, value, key);
+		else if (key.compare("EPOCH_LENGTH") == 0)
+			convert_uint64_t(EPOCH_LENGTH, value, key);
+		else if (key.compare("HISTOGRAM_BIN") == 0)
+			convert_uint64_t(HISTOGRAM_BIN, value, key);
+		else if (key.compare("HISTOGRAM_MAX") == 0)
+			convert_uint64_t(HISTOGRAM_MAX, value, key);
+		else if (key.compare("HISTOGRAM_PRECISION") == 0)
+			convert_uint64_t(HISTOGRAM_PRECISION, value, key);
+		else if (key.compare("WORKING_SET_MODE") == 0)
+			WORKING_SET_MODE = value;
+		else if (key.compare("WORKING_SET_HLL_BITS") == 0)
+			convert_uint64_t(WORKING_SET_HLL_BITS, value, key);
+		else if (key.compare("HOT_PAGES") == 0)
+			convert_uint64_t(HOT_PAGES, value, key);
+		else if (key.compare("HOT_PAGE_SKETCH_WIDTH") == 0)
+			convert_uint64_t(HOT_PAGE_SKETCH_WIDTH, value, key);
+		else if (key.compare("HOT_PAGE_SKETCH_DEPTH") == 0)
+			convert_uint64_t(HOT_PAGE_SKETCH_DEPTH, value, key);
+		else if (key.compare("MISSED_PAGE_LOG") == 0)
+			MISSED_PAGE_LOG = value;
+		else if (key.compare("MISSED_PAGE_BUFFER") == 0)
+			convert_uint64_t(MISSED_PAGE_BUFFER, value, key);
+		else if (key.compare("EPOCH_STATS") == 0)
+			EPOCH_STATS = value;
+		else if (key.compare("LIVE_STATS") == 0)
+			LIVE_STATS = value;
+		else if (key.compare("LIVE_STATS_PERIOD") == 0)
+			convert_uint64_t(LIVE_STATS_PERIOD, value, key);
+		else if (key.compare("TRANSACTION_TRACE_SAMPLE") == 0)
+			convert_uint64_t(TRANSACTION_TRACE_SAMPLE, value, key);
+		else if (key.compare("TRANSACTION_TRACE_BUFFER") == 0)
+			convert_uint64_t(TRANSACTION_TRACE_BUFFER, value, key);
+		else if (key.compare("FULL_TRACE") == 0)
+			FULL_TRACE = value;
+		else if (key.compare("NVDIMM_TRACE") == 0)
+			NVDIMM_TRACE = value;
+		else if (key.compare("DEBUG_TRACE_BUFFER") == 0)
+			convert_uint64_t(DEBUG_TRACE_BUFFER, value, key);
+		else if (key.compare("PAGE_SIZE") == 0)
+			convert_uint64_t(PAGE_SIZE, value, key);
+		else if (key.compare("SET_SIZE") == 0)
+			convert_uint64_t(SET_SIZE, value, key);
+		else if (key.compare("BURST_SIZE") == 0)
+			convert_uint64_t(BURST_SIZE, value, key);
+		else if (key.compare("FLASH_BURST_SIZE") == 0)
+			convert_uint64_t(FLASH_BURST_SIZE, value, key);
+		else if (key.compare("TOTAL_PAGES") == 0)
+			convert_uint64_t(TOTAL_PAGES, value, key);
+		else if (key.compare("CACHE_PAGES") == 0)
+			convert_uint64_t(CACHE_PAGES, value, key);
+		else if (key.compare("CYCLES_PER_SECOND") == 0)
+			convert_uint64_t(CYCLES_PER_SECOND, value, key);
+		else if (key.compare("DRAM_BACKEND") == 0)
+			DRAM_BACKEND = value;
+		else if (key.compare("FLASH_BACKEND") == 0)
+			FLASH_BACKEND = value;
+		else if (key.compare("ANALYTIC_DRAM_READ_LATENCY") == 0)
+			convert_uint64_t(ANALYTIC_DRAM_READ_LATENCY, value, key);
+		else if (key.compare("ANALYTIC_DRAM_WRITE_LATENCY") == 0)
+			convert_uint64_t(ANALYTIC_DRAM_WRITE_LATENCY, value, key);
+		else if (key.compare("ANALYTIC_DRAM_TRANSFER_CYCLES") == 0)
+			convert_uint64_t(ANALYTIC_DRAM_TRANSFER_CYCLES, value, key);
+		else if (key.compare("ANALYTIC_DRAM_CHANNELS") == 0)
+			convert_uint64_t(ANALYTIC_DRAM_CHANNELS, value, key);
+		else if (key.compare("ANALYTIC_DRAM_QUEUE_DEPTH") == 0)
+			convert_uint64_t(ANALYTIC_DRAM_QUEUE_DEPTH, value, key);
+		else if (key.compare("ANALYTIC_FLASH_READ_LATENCY") == 0)
+			convert_uint64_t(ANALYTIC_FLASH_READ_LATENCY, value, key);
+		else if (key.compare("ANALYTIC_FLASH_WRITE_LATENCY") == 0)
+			convert_uint64_t(ANALYTIC_FLASH_WRITE_LATENCY, value, key);
+		else if (key.compare("ANALYTIC_FLASH_TRANSFER_CYCLES") == 0)
+			convert_uint64_t(ANALYTIC_FLASH_TRANSFER_CYCLES, value, key);
+		else if (key.compare("ANALYTIC_FLASH_CHANNELS") == 0)
+			convert_uint64_t(ANALYTIC_FLASH_CHANNELS, value, key);
+		else if (key.compare("ANALYTIC_FLASH_QUEUE_DEPTH") == 0)
+			convert_uint64_t(ANALYTIC_FLASH_QUEUE_DEPTH, value, key);
+		else if (key.compare("DRAM_CYCLES_PER_SECOND") == 0)
+			convert_uint64_t(DRAM_CYCLES_PER_SECOND, value, key);
+		else if (key.compare("FLASH_CYCLES_PER_SECOND") == 0)
+			convert_uint64_t(FLASH_CYCLES_PER_SECOND, value, key);
+		else if (key.compare("FLASH_THREAD") == 0)
+			convert_uint64_t(FLASH_THREAD, value, key);
+		else if (key.compare("ENABLE_STREAM_BUFFER") == 0)
+			convert_uint64_t(ENABLE_STREAM_BUFFER, value, key);
+		else if (key.compare("ONE_MISS_TABLE_SIZE") == 0)
+			convert_uint64_t(ONE_MISS_TABLE_SIZE, value, key);
+		else if (key.compare("NUM_STREAM_BUFFERS") == 0)
+			convert_uint64_t(NUM_STREAM_BUFFERS, value, key);
+		else if (key.compare("STREAM_BUFFER_LENGTH") == 0)
+			convert_uint64_t(STREAM_BUFFER_LENGTH, value, key);
+		else if (key.compare("STREAM_BUFFER_MAX_LENGTH") == 0)
+			convert_uint64_t(STREAM_BUFFER_MAX_LENGTH, value, key);
+		else if (key.compare("STREAM_BUFFER_MAX_STRIDE") == 0)
+			convert_uint64_t(STREAM_BUFFER_MAX_STRIDE, value, key);
+		else if (key.compare("STREAM_BUFFER_DESCENDING") == 0)
+			convert_uint64_t(STREAM_BUFFER_DESCENDING, value, key);
+		else if (key.compare("FUNCTIONAL_ACCESSES") == 0)
+			convert_uint64_t(FUNCTIONAL_ACCESSES, value, key);
+		else if (key.compare("SAMPLING_PERIOD") == 0)
+			convert_uint64_t(SAMPLING_PERIOD, value, key);
+		else if (key.compare("SAMPLING_WARMUP") == 0)
+			convert_uint64_t(SAMPLING_WARMUP, value, key);
+		else if (key.compare("SAMPLING_DETAILED") == 0)
+			convert_uint64_t(SAMPLING_DETAILED, value, key);
+		else if (key.compare("CORES") == 0)
+			convert_uint64_t(CORES, value, key);
+		else if (key.compare("CORE_MLP") == 0)
+			convert_uint64_t(CORE_MLP, value, key);
+		else if (key.compare("CORE_DEPENDENT_READS") == 0)
+			convert_uint64_t(CORE_DEPENDENT_READS, value, key);
+		else if (key.compare("CORE_LOOKAHEAD") == 0)
+			convert_uint64_t(CORE_LOOKAHEAD, value, key);
+		else if (key.compare("CORE_IPC_SCALE") == 0)
+			CORE_IPC_SCALE = value;
+		else if (key.compare("dram_ini") == 0)
+			dram_ini = value;
+		else if (key.compare("flash_ini") == 0)
+			flash_ini = value;
+		else if (key.compare("sys_ini") == 0)
+			sys_ini = value;
+		else if (key.compare("ENABLE_RESTORE") == 0)
+			convert_uint64_t(ENABLE_RESTORE, value, key);
+		else if (key.compare("ENABLE_SAVE") == 0)
+			convert_uint64_t(ENABLE_SAVE, value, key);
+		else if (key.compare("HYBRIDSIM_RESTORE_FILE") == 0)
+			HYBRIDSIM_RESTORE_FILE = value;
+		else if (key.compare("HYBRIDSIM_SAVE_FILE") == 0)
+			HYBRIDSIM_SAVE_FILE = value;
+		else if (key.compare("NVDIMM_RESTORE_FILE") == 0)
+			NVDIMM_RESTORE_FILE = value;
+		else if (key.compare("NVDIMM_SAVE_FILE") == 0)
+			NVDIMM_SAVE_FILE = value;
+		else
+		{
+			cerr << "ERROR: Illegal key/value pair in HybridSim ini file: " << key << "=" << value << "\n";
+			cerr << "This could either be due to an illegal key or the incorrect value type for a key\n";
+			abort();
 		}
 	}
 }
@@ -47,6 +47,9 @@ namespace HybridSim
 	{
 		public:
 		void read(string inifile);
+
+		// Set a single key (also used to change settings at runtime).
+		void set(string key, string value);
 	};
 }
 
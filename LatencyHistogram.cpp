@@ -0,0 +1,264 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include <cmath>
+#include <iomanip>
+
+#include "LatencyHistogram.h"
+#include "Checkpoint.h"
+
+using namespace std;
+
+namespace HybridSim
+{
+	LatencyHistogram::LatencyHistogram(uint64_t precision)
+	{
+		if ((precision < 1) || (precision > 16))
+		{
+			cerr << "ERROR: Latency histogram precision must be between 1 and 16 bits (got " << precision << ")\n";
+			abort();
+		}
+
+		this->precision = precision;
+		sub_buckets = 1ULL << precision;
+		this->reset();
+	}
+
+	void LatencyHistogram::reset()
+	{
+		count = 0;
+		sum = 0;
+		min = 0;
+		max = 0;
+		counts.clear();
+	}
+
+	uint64_t LatencyHistogram::index(uint64_t value) const
+	{
+		if (value < sub_buckets)
+			return value;
+
+		// Keep the top precision+1 bits of the value (which are in [sub_buckets, 2*sub_buckets)). Every
+		// power of two above that adds another sub_buckets buckets.
+		uint64_t top_bit = 63 - __builtin_clzll(value);
+		uint64_t shift = top_bit - precision;
+		return (shift * sub_buckets) + (value >> shift);
+	}
+
+	uint64_t LatencyHistogram::lowest(uint64_t index) const
+	{
+		if (index < 2 * sub_buckets)
+			return index;
+
+		uint64_t shift = (index / sub_buckets) - 1;
+		return (index - (shift * sub_buckets)) << shift;
+	}
+
+	uint64_t LatencyHistogram::highest(uint64_t index) const
+	{
+		if (index < 2 * sub_buckets)
+			return index;
+
+		uint64_t shift = (index / sub_buckets) - 1;
+		return this->lowest(index) + (1ULL << shift) - 1;
+	}
+
+	void LatencyHistogram::record(uint64_t value)
+	{
+		uint64_t i = this->index(value);
+		if (i >= counts.size())
+			counts.resize(i + 1, 0);
+		counts[i]++;
+
+		if ((count == 0) || (value < min))
+			min = value;
+		if (value > max)
+			max = value;
+		count++;
+		sum += value;
+	}
+
+	void LatencyHistogram::merge(const LatencyHistogram &h)
+	{
+		if (h.precision != precision)
+		{
+			cerr << "ERROR: Cannot merge latency histograms with different precisions (" << precision << " and " << h.precision << ")\n";
+			abort();
+		}
+
+		if (h.count == 0)
+			return;
+
+		if (h.counts.size() > counts.size())
+			counts.resize(h.counts.size(), 0);
+		for (size_t i = 0; i < h.counts.size(); i++)
+			counts[i] += h.counts[i];
+
+		if ((count == 0) || (h.min < min))
+			min = h.min;
+		if (h.max > max)
+			max = h.max;
+		count += h.count;
+		sum += h.sum;
+	}
+
+	uint64_t LatencyHistogram::percentile(double p) const
+	{
+		if (count == 0)
+			return 0;
+
+		// Smallest bucket that covers at least p percent of the values.
+		uint64_t target = (uint64_t)ceil((p / 100.0) * count);
+		if (target == 0)
+			target = 1;
+		if (target >= count)
+			return max;
+
+		uint64_t seen = 0;
+		for (size_t i = 0; i < counts.size(); i++)
+		{
+			seen += counts[i];
+			if (seen >= target)
+				return (this->highest(i) < max) ? this->highest(i) : max;
+		}
+		return max;
+	}
+
+	double LatencyHistogram::mean() const
+	{
+		if (count == 0)
+			return 0.0;
+		return sum / (double)count;
+	}
+
+	void LatencyHistogram::print_percentile_header(ostream &out)
+	{
+		ios_base::fmtflags flags = out.flags();
+		out << left << setw(12) << "class" << right << setw(12) << "count" << setw(12) << "mean" << setw(10) << "min" 
+			<< setw(10) << "p50" << setw(10) << "p90" << setw(10) << "p99" << setw(10) << "p99.9" << setw(10) << "max" << "\n";
+		out.flags(flags);
+	}
+
+	void LatencyHistogram::print_percentiles(ostream &out, string name) const
+	{
+		ios_base::fmtflags flags = out.flags();
+		streamsize old_precision = out.precision();
+		out << left << setw(12) << name << right << setw(12) << count << setw(12) << fixed << setprecision(1) << this->mean() 
+			<< setw(10) << min << setw(10) << this->percentile(50) << setw(10) << this->percentile(90) 
+			<< setw(10) << this->percentile(99) << setw(10) << this->percentile(99.9) << setw(10) << max << "\n";
+		out.flags(flags);
+		out.precision(old_precision);
+	}
+
+	void LatencyHistogram::write(ostream &out, string name) const
+	{
+		// Only the non-empty buckets are written. The bucket bounds are there for people reading the file;
+		// read() only uses the index and count.
+		uint64_t used = 0;
+		for (size_t i = 0; i < counts.size(); i++)
+			if (counts[i])
+				used++;
+
+		out << "histogram " << name << "\n";
+		out << "precision " << precision << "\n";
+		out << "count " << count << "\n";
+		out << "sum " << sum << "\n";
+		out << "min " << min << "\n";
+		out << "max " << max << "\n";
+		out << "buckets " << used << "\n";
+		for (size_t i = 0; i < counts.size(); i++)
+			if (counts[i])
+				out << i << " " << this->lowest(i) << " " << this->highest(i) << " " << counts[i] << "\n";
+	}
+
+	bool LatencyHistogram::read(istream &in, string &name)
+	{
+		string word;
+		if (!(in >> word))
+			return false;
+
+		uint64_t file_precision, file_count, file_sum, file_min, file_max, buckets;
+		string k1, k2, k3, k4, k5, k6;
+		if ((word != "histogram") || !(in >> name >> k1 >> file_precision >> k2 >> file_count >> k3 >> file_sum >> k4 >> file_min 
+				>> k5 >> file_max >> k6 >> buckets) 
+				|| (k1 != "precision") || (k2 != "count") || (k3 != "sum") || (k4 != "min") || (k5 != "max") || (k6 != "buckets"))
+		{
+			cerr << "ERROR: Malformed latency histogram (expected \"histogram NAME\" followed by its fields)\n";
+			abort();
+		}
+
+		*this = LatencyHistogram(file_precision);
+		sum = file_sum;
+		min = file_min;
+		max = file_max;
+		for (uint64_t b = 0; b < buckets; b++)
+		{
+			uint64_t i, low, high, n;
+			if (!(in >> i >> low >> high >> n))
+			{
+				cerr << "ERROR: Latency histogram " << name << " is missing buckets\n";
+				abort();
+			}
+			if (i >= counts.size())
+				counts.resize(i + 1, 0);
+			counts[i] += n;
+			count += n;
+		}
+
+		if (count != file_count)
+		{
+			cerr << "ERROR: Latency histogram " << name << " bucket counts do not add up to its count\n";
+			abort();
+		}
+		return true;
+	}
+
+	void LatencyHistogram::saveCheckpoint(ostream &out)
+	{
+		checkpoint_write(out, precision);
+		checkpoint_write(out, count);
+		checkpoint_write(out, sum);
+		checkpoint_write(out, min);
+		checkpoint_write(out, max);
+		checkpoint_write(out, counts);
+	}
+
+	void LatencyHistogram::loadCheckpoint(istream &in)
+	{
+		uint64_t p;
+		checkpoint_read(in, p);
+		*this = LatencyHistogram(p);
+		checkpoint_read(in, count);
+		checkpoint_read(in, sum);
+		checkpoint_read(in, min);
+		checkpoint_read(in, max);
+		checkpoint_read(in, counts);
+	}
+}
@@ -0,0 +1,87 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_LATENCYHISTOGRAM_H
+#define HYBRIDSIM_LATENCYHISTOGRAM_H
+
+#include <iostream>
+#include <vector>
+
+#include "config.h"
+
+namespace HybridSim
+{
+	// LatencyHistogram is a log-linear (HdrHistogram style) histogram of latencies in cycles.
+	//
+	// Values below 2^(precision+1) get their own bucket. Above that, every power of two range is split
+	// into 2^precision equal buckets, so a recorded value is known to within 1/2^precision of itself no
+	// matter how large it is (precision 7 is within 0.8%). The buckets are a flat array indexed by the
+	// position of the value's top bit plus the precision bits below it, so recording is constant time
+	// and the array only grows as far as the largest value seen.
+	//
+	// Histograms with the same precision can be merged, either in memory or by reading back the files
+	// written by write() (see --merge-histograms in TraceBasedSim).
+	class LatencyHistogram
+	{
+		public:
+		LatencyHistogram(uint64_t precision = 7);
+
+		void record(uint64_t value);
+		void merge(const LatencyHistogram &h);
+		void reset();
+
+		uint64_t percentile(double p) const; // p in [0, 100], returns the top of the bucket (capped at max).
+		double mean() const;
+
+		// Bucket math.
+		uint64_t index(uint64_t value) const;
+		uint64_t lowest(uint64_t index) const;
+		uint64_t highest(uint64_t index) const;
+
+		// Output.
+		static void print_percentile_header(ostream &out);
+		void print_percentiles(ostream &out, string name) const;
+		void write(ostream &out, string name) const;
+		bool read(istream &in, string &name);
+
+		void saveCheckpoint(ostream &out);
+		void loadCheckpoint(istream &in);
+
+		uint64_t precision;
+		uint64_t sub_buckets; // 2^precision
+		uint64_t count;
+		uint64_t sum;
+		uint64_t min;
+		uint64_t max;
+		vector<uint64_t> counts;
+	};
+}
+
+#endif
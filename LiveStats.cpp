@@ -0,0 +1,145 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include "LiveStats.h"
+
+using namespace std;
+
+namespace HybridSim
+{
+	// The values are read from other processes as plain uint64s.
+	static_assert(sizeof(std::atomic<uint64_t>) == 8, "std::atomic<uint64_t> must be a plain 64 bit word");
+
+	LiveStats::LiveStats()
+	{
+		num_values = 0;
+		size = 0;
+		segment = NULL;
+		sequence = NULL;
+		values = NULL;
+	}
+
+	LiveStats::~LiveStats()
+	{
+		this->close(true);
+	}
+
+	void LiveStats::open(string name, const vector<string> &names)
+	{
+		if (segment != NULL)
+		{
+			cerr << "ERROR: LiveStats::open() called while " << this->name << " is still open.\n";
+			abort();
+		}
+
+		// shm_open() names start with a slash.
+		if (name.empty() || (name[0] != '/'))
+			name = "/" + name;
+		this->name = name;
+
+		string name_list;
+		for (size_t i = 0; i < names.size(); i++)
+			name_list += names[i] + "\n";
+		num_values = names.size();
+		uint64_t names_offset = HEADER_SIZE + num_values * 8;
+		size = names_offset + name_list.size();
+
+		int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+		if (fd < 0)
+		{
+			cerr << "ERROR: HybridSim live statistics segment " << name << " failed to open (" << strerror(errno) << ").\n";
+			abort();
+		}
+		if (ftruncate(fd, size) != 0)
+		{
+			cerr << "ERROR: HybridSim live statistics segment " << name << " could not be resized (" << strerror(errno) << ").\n";
+			abort();
+		}
+		void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (p == MAP_FAILED)
+		{
+			cerr << "ERROR: HybridSim live statistics segment " << name << " could not be mapped (" << strerror(errno) << ").\n";
+			abort();
+		}
+		segment = (char *)p;
+
+		// The segment starts out zeroed, so the sequence number is already 0 (even) with all values 0.
+		uint64_t *header = (uint64_t *)segment;
+		header[1] = VERSION;
+		header[3] = num_values;
+		header[4] = names_offset;
+		header[5] = name_list.size();
+		memcpy(segment + names_offset, name_list.data(), name_list.size());
+		sequence = (std::atomic<uint64_t> *)(segment + 16);
+		values = (std::atomic<uint64_t> *)(segment + HEADER_SIZE);
+
+		// The magic goes in last so a reader never sees a segment with a partial header.
+		std::atomic_thread_fence(std::memory_order_release);
+		memcpy(segment, "HSLIVE\0\0", 8);
+	}
+
+	void LiveStats::publish(const vector<uint64_t> &v)
+	{
+		if (v.size() != num_values)
+		{
+			cerr << "ERROR: LiveStats::publish() called with " << v.size() << " values for " << num_values << " names.\n";
+			abort();
+		}
+
+		// There is only one writer, so the sequence number does not need an atomic increment.
+		uint64_t s = sequence->load(std::memory_order_relaxed);
+		sequence->store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (uint64_t i = 0; i < num_values; i++)
+			values[i].store(v[i], std::memory_order_relaxed);
+		sequence->store(s + 2, std::memory_order_release);
+	}
+
+	void LiveStats::close(bool unlink_segment)
+	{
+		if (segment == NULL)
+			return;
+
+		munmap(segment, size);
+		if (unlink_segment)
+			shm_unlink(name.c_str());
+		segment = NULL;
+		sequence = NULL;
+		values = NULL;
+	}
+}
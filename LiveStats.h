@@ -0,0 +1,81 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_LIVESTATS_H
+#define HYBRIDSIM_LIVESTATS_H
+
+#include <atomic>
+
+#include "config.h"
+
+namespace HybridSim
+{
+	// LiveStats publishes a snapshot of the simulator's counters in a POSIX shared memory segment
+	// (/dev/shm/NAME on Linux) so a long run can be watched while it is going (tools/live_stats.py).
+	// The simulator only stores to memory. There is no file I/O and no system call on the update path.
+	//
+	// The snapshot is protected by a sequence lock. The writer makes the sequence number odd, writes the
+	// values and then makes it even again. A reader copies the values and only keeps the copy if the
+	// sequence number was the same even number before and after, so it never sees a half written snapshot
+	// and never blocks the writer.
+	//
+	// Segment layout (all integers are uint64 in host byte order):
+	//   header: "HSLIVE\0\0", version, sequence number, number of values, offset and size of the names
+	//   values: one per counter, starting at HEADER_SIZE
+	//   names:  the counter names, one per line, in the same order as the values
+	// The names make the segment self describing, so counters can be added without changing the version.
+	class LiveStats
+	{
+		public:
+		static const uint64_t VERSION = 1;
+		static const uint64_t HEADER_SIZE = 48;
+
+		LiveStats();
+		~LiveStats();
+
+		// Create (or replace) the segment NAME with one value per entry of names.
+		void open(string name, const vector<string> &names);
+		// Publish a new snapshot (values must be in the same order as the names given to open()).
+		void publish(const vector<uint64_t> &values);
+		// Unmap the segment. With unlink_segment, its name is also removed (readers that already have it
+		// mapped keep the last snapshot).
+		void close(bool unlink_segment);
+		bool is_open() { return segment != NULL; }
+
+		string name;
+		uint64_t num_values;
+		size_t size;
+		char *segment;
+		std::atomic<uint64_t> *sequence;
+		std::atomic<uint64_t> *values;
+	};
+}
+
+#endif
@@ -28,7 +28,11 @@
 * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 *********************************************************************************/
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "Logger.h"
+#include "Checkpoint.h"
 
 using namespace std;
 
@@ -40,6 +44,8 @@ namespace HybridSim
 
 	Logger::~Logger()
 	{
+		miss_record.close();
+
 		if (DEBUG_LOGGER && debug.is_open()) 
 			debug.close();
 	}
@@ -89,14 +95,81 @@ namespace HybridSim
 			latency_histogram[i] = 0;
 		}
 
+		// Init the latency distributions (the epoch ones are cleared again by epoch_reset()).
+		vector<LatencyHistogram *> total_histograms = this->histograms(false);
+		vector<LatencyHistogram *> epoch_histograms = this->histograms(true);
+		for (size_t i = 0; i < total_histograms.size(); i++)
+		{
+			*total_histograms[i] = LatencyHistogram(HISTOGRAM_PRECISION);
+			*epoch_histograms[i] = LatencyHistogram(HISTOGRAM_PRECISION);
+		}
+
+		// Init the page statistics.
+		if (WORKING_SET_MODE == "exact")
+			sketch_pages = false;
+		else if (WORKING_SET_MODE == "sketch")
+			sketch_pages = true;
+		else
+		{
+			cerr << "ERROR: Invalid WORKING_SET_MODE " << WORKING_SET_MODE << " (must be exact or sketch)\n";
+			abort();
+		}
+		if (sketch_pages)
+		{
+			distinct_pages = HyperLogLog(WORKING_SET_HLL_BITS);
+			cur_distinct_pages = HyperLogLog(WORKING_SET_HLL_BITS);
+			hot_pages = HotPageSketch(HOT_PAGES, HOT_PAGE_SKETCH_WIDTH, HOT_PAGE_SKETCH_DEPTH);
+		}
+
+		// Init the missed page record.
+		if ((MISSED_PAGE_LOG != "epoch") && (MISSED_PAGE_LOG != "binary") && (MISSED_PAGE_LOG != "none"))
+		{
+			cerr << "ERROR: Invalid MISSED_PAGE_LOG " << MISSED_PAGE_LOG << " (must be epoch, binary or none)\n";
+			abort();
+		}
+		keep_misses = (MISSED_PAGE_LOG != "none");
+		binary_misses = (MISSED_PAGE_LOG == "binary");
+		miss_record.close();
+		miss_record.records = 0;
+		miss_record_file = "hybridsim_misses.bin";
+		miss_record_append = false;
+
+		// Init the epoch statistics stream.
+		if ((EPOCH_STATS != "jsonl") && (EPOCH_STATS != "csv") && (EPOCH_STATS != "none"))
+		{
+			cerr << "ERROR: Invalid EPOCH_STATS " << EPOCH_STATS << " (must be jsonl, csv or none)\n";
+			abort();
+		}
+		if (epoch_stats.is_open())
+			epoch_stats.close();
+		epoch_stats_enabled = (EPOCH_STATS != "none");
+		epoch_stats_csv = (EPOCH_STATS == "csv");
+		epoch_stats_file = epoch_stats_csv ? "hybridsim_epoch.csv" : "hybridsim_epoch.jsonl";
+		epoch_stats_append = false;
+		epoch_stats_bytes = 0;
+
+		// The text epoch log is opened by the first epoch_reset() after this.
+		epoch_log_file = "hybridsim_epoch.log";
+		epoch_log_append = false;
+		for (size_t i = 0; i < extra_counters.size(); i++)
+			extra_counters_last[i] = *extra_counters[i].second;
+
 		// Init the set conflicts.
 		for (uint64_t i = 0; i < NUM_SETS; i++)
 		{
 			set_conflicts[i] = 0;
 		}
 
+		// Nothing is counted until the first access_update() reports a different state.
+		state_queue_length = 0;
+		state_idle = false;
+		state_flash_idle = false;
+		state_dram_idle = false;
+		state_cycle = this->currentClockCycle;
+
 		// Resetting the epoch state will initialize it.
 		epoch_count = 0;
+		next_epoch_cycle = ((this->currentClockCycle + EPOCH_LENGTH - 1) / EPOCH_LENGTH) * EPOCH_LENGTH;
 		this->epoch_reset(true);
 
 		if (DEBUG_LOGGER) 
@@ -111,76 +184,43 @@ namespace HybridSim
 	}
 
 
-	void Logger::update()
+	void Logger::access_start(uint64_t id, uint64_t addr)
 	{
-		// Every EPOCH_LENGTH cycles, reset the epoch state.
-		if (this->currentClockCycle % EPOCH_LENGTH == 0)
-			epoch_reset(false);
-
-		// Increment to the next clock cycle.
-		this->step();
-	}
-
-	void Logger::access_start(uint64_t addr)
-	{
-		access_queue.push_back(pair <uint64_t, uint64_t>(addr, currentClockCycle));
-
-		if (DEBUG_LOGGER)
+		if (!access_queue.insert(make_pair(id, currentClockCycle)).second)
 		{
-			list<pair <uint64_t, uint64_t>>::iterator it = access_queue.begin();
-			debug << "access_start( " << addr << " , " << currentClockCycle << " ) / aq: ( " << (*it).first << " , " << (*it).second << " )\n\n";
+			cerr << "ERROR: Logger.access_start() called with id already in the access_queue. id=" << id << " address=0x" << hex << addr << "\n" << dec;
+			abort();
 		}
+
+		if (DEBUG_LOGGER)
+			debug << "access_start( " << id << " , " << addr << " , " << currentClockCycle << " ) / aq size: " << access_queue.size() << "\n\n";
 	}
 
-	void Logger::access_process(uint64_t addr, bool read_op, bool hit)
+	void Logger::access_process(uint64_t id, uint64_t addr, bool read_op, bool hit)
 	{
 		if (DEBUG_LOGGER)
-			debug << "access_process( " << addr << " , " << read_op << " )\n";
+			debug << "access_process( " << id << " , " << addr << " , " << read_op << " )\n";
 
 		// Get entry off of the access_queue.
-		uint64_t start_cycle = 0;
-		bool found = false;
-		list<pair <uint64_t, uint64_t>>::iterator it;
-		uint64_t counter = 0;
-		for (it = access_queue.begin(); it != access_queue.end(); it++, counter++)
+		unordered_map<uint64_t, uint64_t>::iterator it = access_queue.find(id);
+		if (it == access_queue.end())
 		{
-			uint64_t cur_addr = (*it).first;
-			uint64_t cur_cycle = (*it).second;
-
-			if (DEBUG_LOGGER)
-				debug << counter << " cur_addr = " << cur_addr << ", cur_cycle = " << cur_cycle << "\n";
-
-			if (cur_addr == addr)
-			{
-				start_cycle = cur_cycle;
-				found = true;
-				access_queue.erase(it);
-
-				if (DEBUG_LOGGER)
-					debug << "found match!\n";
-
-				break;
-			}
-		}
-
-		if (!found)
-		{
-			cerr << "ERROR: Logger.access_process() called with address not in the access_queue. address=0x" << hex << addr << "\n" << dec;
-			abort();
-		}
-
-		if (access_map.count(addr) != 0)
-		{
-			cerr << "ERROR: Logger.access_process() called with address already in access_map. address=0x" << hex << addr << "\n" << dec;
+			cerr << "ERROR: Logger.access_process() called with id not in the access_queue. id=" << id << " address=0x" << hex << addr << "\n" << dec;
 			abort();
 		}
+		uint64_t start_cycle = (*it).second;
+		access_queue.erase(it);
 
 		AccessMapEntry a;
 		a.start = start_cycle;
 		a.read_op = read_op;
 		a.hit = hit;
 		a.process = this->currentClockCycle;
-		access_map[addr] = a;
+		if (!access_map.insert(make_pair(id, a)).second)
+		{
+			cerr << "ERROR: Logger.access_process() called with id already in access_map. id=" << id << " address=0x" << hex << addr << "\n" << dec;
+			abort();
+		}
 
 
 		uint64_t time_in_queue = a.process - a.start;
@@ -190,20 +230,20 @@ namespace HybridSim
 			debug << "finished access_process. time_in_queue = " << time_in_queue << "\n\n";
 	}
 
-	void Logger::access_stop(uint64_t addr)
+	void Logger::access_stop(uint64_t id)
 	{
 		if (DEBUG_LOGGER)
-			debug << "access_stop( " << addr << " )\n";
+			debug << "access_stop( " << id << " )\n";
 
-		if (access_map.count(addr) == 0)
+		unordered_map<uint64_t, AccessMapEntry>::iterator it = access_map.find(id);
+		if (it == access_map.end())
 		{
-			cerr << "ERROR: Logger.access_stop() called with address not in access_map. address=" << hex << addr << "\n" << dec;
+			cerr << "ERROR: Logger.access_stop() called with id not in access_map. id=" << id << "\n";
 			abort();
 		}
 
-		AccessMapEntry a = access_map[addr];
+		AccessMapEntry a = (*it).second;
 		a.stop = this->currentClockCycle;
-		access_map[addr] = a;
 
 		uint64_t latency = a.stop - a.start;
 
@@ -230,50 +270,74 @@ namespace HybridSim
 		}
 
 		
-		access_map.erase(addr);
+		access_map.erase(it);
 
 		if (DEBUG_LOGGER)
 			debug << "finished access_stop. latency = " << latency << "\n\n";
 	}
 
 
-	void Logger::access_update(uint64_t queue_length, bool idle, bool flash_idle, bool dram_idle)
+	void Logger::state_change(uint64_t queue_length, bool idle, bool flash_idle, bool dram_idle)
 	{
+		// Count the cycles before this one with the old state.
+		this->settle(this->currentClockCycle);
+
+		state_queue_length = queue_length;
+		state_idle = idle;
+		state_flash_idle = flash_idle;
+		state_dram_idle = dram_idle;
+	}
+
+	void Logger::settle(uint64_t end)
+	{
+		// Add the cycles from state_cycle up to (but not including) end, which all had the current state.
+		// This gives exactly the same counts as adding the state up every cycle.
+		if (end <= state_cycle)
+			return;
+		uint64_t cycles = end - state_cycle;
+		state_cycle = end;
+
 		// Log the queue length.
-		if (queue_length > max_queue_length)
-			max_queue_length = queue_length;
-		sum_queue_length += queue_length;
+		if (state_queue_length > max_queue_length)
+			max_queue_length = state_queue_length;
+		sum_queue_length += state_queue_length * cycles;
 
 		// Log the queue length for the current epoch.
-		if (queue_length > cur_max_queue_length)
-			cur_max_queue_length = queue_length;
-		cur_sum_queue_length += queue_length;
-
-		//cerr << "access_queue length = " << access_queue.size() << "; queue_length = " << queue_length << ";\n";
+		if (state_queue_length > cur_max_queue_length)
+			cur_max_queue_length = state_queue_length;
+		cur_sum_queue_length += state_queue_length * cycles;
 
 		// Update idle counters.
-		if (idle)
+		if (state_idle)
 		{
-			idle_counter++;
-			cur_idle_counter++;
+			idle_counter += cycles;
+			cur_idle_counter += cycles;
 		}
 
-		if (flash_idle)
+		if (state_flash_idle)
 		{
-			flash_idle_counter++;
-			cur_flash_idle_counter++;
+			flash_idle_counter += cycles;
+			cur_flash_idle_counter += cycles;
 		}
 
-		if (dram_idle)
+		if (state_dram_idle)
 		{
-			dram_idle_counter++;
-			cur_dram_idle_counter++;
+			dram_idle_counter += cycles;
+			cur_dram_idle_counter += cycles;
 		}
 	}
 
 
 	void Logger::access_page(uint64_t page_addr)
 	{
+		if (sketch_pages)
+		{
+			distinct_pages.add(page_addr);
+			cur_distinct_pages.add(page_addr);
+			hot_pages.add(page_addr);
+			return;
+		}
+
 		if (pages_used.count(page_addr) == 0)
 		{
 			// Create an entry for a page that has not been previously accessed.
@@ -314,11 +378,36 @@ namespace HybridSim
 
 	void Logger::access_miss(uint64_t missed_page, uint64_t victim_page, uint64_t cache_set, uint64_t cache_page, bool dirty, bool valid)
 	{
+		if (binary_misses)
+		{
+			if (!miss_record.is_open())
+				this->miss_record_open();
+			miss_record.write(currentClockCycle, missed_page, victim_page, cache_set, cache_page, dirty, valid);
+			return;
+		}
+		if (!keep_misses)
+			return;
+
 		MissedPageEntry m(currentClockCycle, missed_page, victim_page, cache_set, cache_page, dirty, valid);
 		
 		missed_page_list.push_back(m);
 	}
 
+	void Logger::miss_record_open()
+	{
+		// The file is opened on the first miss (not in init()) so that loading a checkpoint can decide
+		// whether to keep the records that are already there.
+		miss_record.open(miss_record_file, MISSED_PAGE_BUFFER, miss_record_append);
+		miss_record_append = true;
+	}
+
+	void Logger::close_streams()
+	{
+		miss_record.close();
+		if (epoch_stats.is_open())
+			epoch_stats.close();
+	}
+
 	void Logger::mmio_dropped()
 	{
 		num_mmio_dropped++;
@@ -414,6 +503,9 @@ namespace HybridSim
 
 		cur_sum_latency += cycles;
 
+		if (!STATS_FULL)
+			return;
+
 		// Update the latency histogram.
 		uint64_t bin = (cycles / HISTOGRAM_BIN) * HISTOGRAM_BIN;
 		if (cycles >= HISTOGRAM_MAX)
@@ -443,6 +535,12 @@ namespace HybridSim
 		sum_queue_latency += cycles;
 
 		cur_sum_queue_latency += cycles;
+
+		if (STATS_FULL)
+		{
+			queue_histogram.record(cycles);
+			cur_queue_histogram.record(cycles);
+		}
 	}
 
 	void Logger::hit_latency(uint64_t cycles)
@@ -466,6 +564,12 @@ namespace HybridSim
 		sum_read_hit_latency += cycles;
 
 		cur_sum_read_hit_latency += cycles;
+
+		if (STATS_FULL)
+		{
+			read_hit_histogram.record(cycles);
+			cur_read_hit_histogram.record(cycles);
+		}
 	}
 
 	void Logger::read_miss_latency(uint64_t cycles)
@@ -475,6 +579,12 @@ namespace HybridSim
 		sum_read_miss_latency += cycles;
 
 		cur_sum_read_miss_latency += cycles;
+
+		if (STATS_FULL)
+		{
+			read_miss_histogram.record(cycles);
+			cur_read_miss_histogram.record(cycles);
+		}
 	}
 
 	void Logger::write_hit_latency(uint64_t cycles)
@@ -484,6 +594,12 @@ namespace HybridSim
 		sum_write_hit_latency += cycles;
 
 		cur_sum_write_hit_latency += cycles;
+
+		if (STATS_FULL)
+		{
+			write_hit_histogram.record(cycles);
+			cur_write_hit_histogram.record(cycles);
+		}
 	}
 
 	void Logger::write_miss_latency(uint64_t cycles)
@@ -493,6 +609,12 @@ namespace HybridSim
 		sum_write_miss_latency += cycles;
 
 		cur_sum_write_miss_latency += cycles;
+
+		if (STATS_FULL)
+		{
+			write_miss_histogram.record(cycles);
+			cur_write_miss_histogram.record(cycles);
+		}
 	}
 
 	double Logger::divide(uint64_t a, uint64_t b)
@@ -536,37 +658,208 @@ namespace HybridSim
 		return (this->divide(sum, accesses) / CYCLES_PER_SECOND) * 1000000;
 	}
 
+	void Logger::add_epoch_counter(string name, uint64_t *counter)
+	{
+		extra_counters.push_back(make_pair(name, counter));
+		extra_counters_last.push_back(*counter);
+	}
+
+	vector<pair<string, uint64_t> > Logger::epoch_record()
+	{
+		// Everything is for the epoch that just finished. The order is the column order of the CSV file.
+		vector<pair<string, uint64_t> > r;
+		r.push_back(make_pair("epoch", epoch_count));
+		r.push_back(make_pair("cycle", this->currentClockCycle));
+		r.push_back(make_pair("cycles", EPOCH_LENGTH));
+		r.push_back(make_pair("accesses", cur_num_accesses));
+		r.push_back(make_pair("reads", cur_num_reads));
+		r.push_back(make_pair("writes", cur_num_writes));
+		r.push_back(make_pair("misses", cur_num_misses));
+		r.push_back(make_pair("hits", cur_num_hits));
+		r.push_back(make_pair("read_misses", cur_num_read_misses));
+		r.push_back(make_pair("read_hits", cur_num_read_hits));
+		r.push_back(make_pair("write_misses", cur_num_write_misses));
+		r.push_back(make_pair("write_hits", cur_num_write_hits));
+		r.push_back(make_pair("sum_latency", cur_sum_latency));
+		r.push_back(make_pair("sum_read_latency", cur_sum_read_latency));
+		r.push_back(make_pair("sum_write_latency", cur_sum_write_latency));
+		r.push_back(make_pair("sum_queue_latency", cur_sum_queue_latency));
+		r.push_back(make_pair("sum_hit_latency", cur_sum_hit_latency));
+		r.push_back(make_pair("sum_miss_latency", cur_sum_miss_latency));
+		r.push_back(make_pair("sum_read_hit_latency", cur_sum_read_hit_latency));
+		r.push_back(make_pair("sum_read_miss_latency", cur_sum_read_miss_latency));
+		r.push_back(make_pair("sum_write_hit_latency", cur_sum_write_hit_latency));
+		r.push_back(make_pair("sum_write_miss_latency", cur_sum_write_miss_latency));
+		r.push_back(make_pair("max_queue_length", cur_max_queue_length));
+		r.push_back(make_pair("sum_queue_length", cur_sum_queue_length));
+		r.push_back(make_pair("queue_length", (uint64_t)access_queue.size()));
+		r.push_back(make_pair("idle_cycles", cur_idle_counter));
+		r.push_back(make_pair("flash_idle_cycles", cur_flash_idle_counter));
+		r.push_back(make_pair("dram_idle_cycles", cur_dram_idle_counter));
+		r.push_back(make_pair("mmio_dropped", cur_num_mmio_dropped));
+		r.push_back(make_pair("mmio_remapped", cur_num_mmio_remapped));
+		if (STATS_FULL)
+			r.push_back(make_pair("working_set_pages", this->working_set_pages(true)));
+		for (size_t i = 0; i < extra_counters.size(); i++)
+			r.push_back(make_pair(extra_counters[i].first, *extra_counters[i].second - extra_counters_last[i]));
+		return r;
+	}
 
-	void Logger::epoch_reset(bool init)
+	void Logger::write_epoch_stats()
 	{
-		// If this is not initialization, then save the epoch state to the lists.
-		if (init)
+		vector<pair<string, uint64_t> > r = this->epoch_record();
+		for (size_t i = 0; i < extra_counters.size(); i++)
+			extra_counters_last[i] = *extra_counters[i].second;
+
+		if (!epoch_stats.is_open())
 		{
-			// Open up the hybridsim_epoch.log
-			ofstream savefile;
-			savefile.open("hybridsim_epoch.log", ios_base::out | ios_base::trunc);
-			if (!savefile.is_open())
+			epoch_stats.open(epoch_stats_file.c_str(), ios_base::out | (epoch_stats_append ? ios_base::app : ios_base::trunc));
+			if (!epoch_stats.is_open())
 			{
-				cerr << "ERROR: HybridSim Logger epoch output file failed to open.\n";
+				cerr << "ERROR: HybridSim Logger epoch statistics file " << epoch_stats_file << " failed to open.\n";
 				abort();
 			}
+			epoch_stats_append = true;
+		}
+
+		// The size is tracked here instead of with tellp(), which would flush the stream every epoch.
+		stringstream line;
+		if (epoch_stats_csv && (epoch_stats_bytes == 0))
+		{
+			for (size_t i = 0; i < r.size(); i++)
+				line << (i ? "," : "") << r[i].first;
+			line << "\n";
+		}
+
+		if (epoch_stats_csv)
+		{
+			for (size_t i = 0; i < r.size(); i++)
+				line << (i ? "," : "") << r[i].second;
+		}
+		else
+		{
+			line << "{";
+			for (size_t i = 0; i < r.size(); i++)
+				line << (i ? ", \"" : "\"") << r[i].first << "\": " << r[i].second;
+			line << "}";
+		}
+		line << "\n";
+
+		epoch_stats << line.str();
+		epoch_stats_bytes += line.str().size();
+	}
+
+	uint64_t Logger::working_set_pages(bool epoch)
+	{
+		if (sketch_pages)
+			return epoch ? cur_distinct_pages.estimate() : distinct_pages.estimate();
+		else
+			return epoch ? cur_pages_used.size() : pages_used.size();
+	}
+
+	void Logger::print_working_set(ostream &out, bool epoch)
+	{
+		uint64_t pages = this->working_set_pages(epoch);
+		out << "working set size in pages: " << pages << "\n";
+		out << "working set size in bytes: " << pages * PAGE_SIZE << " bytes\n";
+		if (sketch_pages)
+			out << "working set standard error: " << distinct_pages.relative_error() * 100 << "% (HyperLogLog estimate)\n";
+	}
+
+	static const char *histogram_names[] = {"read_hit", "read_miss", "write_hit", "write_miss", "queue"};
+
+	vector<LatencyHistogram *> Logger::histograms(bool epoch)
+	{
+		// Same order as histogram_names.
+		if (epoch)
+		{
+			LatencyHistogram *h[] = {&cur_read_hit_histogram, &cur_read_miss_histogram, &cur_write_hit_histogram, 
+				&cur_write_miss_histogram, &cur_queue_histogram};
+			return vector<LatencyHistogram *>(h, h + 5);
+		}
+		else
+		{
+			LatencyHistogram *h[] = {&read_hit_histogram, &read_miss_histogram, &write_hit_histogram, 
+				&write_miss_histogram, &queue_histogram};
+			return vector<LatencyHistogram *>(h, h + 5);
+		}
+	}
 
+	void Logger::print_percentiles(ostream &out, bool epoch)
+	{
+		vector<LatencyHistogram *> h = this->histograms(epoch);
+
+		// The access latency of all four classes together goes before the queue latency.
+		LatencyHistogram all(HISTOGRAM_PRECISION);
+		for (size_t i = 0; i < 4; i++)
+			all.merge(*h[i]);
+
+		LatencyHistogram::print_percentile_header(out);
+		for (size_t i = 0; i < 4; i++)
+			h[i]->print_percentiles(out, histogram_names[i]);
+		all.print_percentiles(out, "all");
+		h[4]->print_percentiles(out, histogram_names[4]);
+	}
+
+	void Logger::write_histograms()
+	{
+		ofstream savefile;
+		savefile.open("hybridsim_latency.hist", ios_base::out | ios_base::trunc);
+		if (!savefile.is_open())
+		{
+			cerr << "ERROR: HybridSim Logger latency histogram file failed to open.\n";
+			abort();
+		}
+
+		vector<LatencyHistogram *> h = this->histograms(false);
+		for (size_t i = 0; i < h.size(); i++)
+			h[i]->write(savefile, histogram_names[i]);
+
+		savefile.close();
+	}
+
+
+	const char *Logger::stats_level()
+	{
+		switch (HYBRIDSIM_STATS)
+		{
+			case HYBRIDSIM_STATS_NONE: return "none";
+			case HYBRIDSIM_STATS_COUNTERS: return "counters";
+			default: return "full";
+		}
+	}
+
+	void Logger::epoch_log_open(ofstream &savefile)
+	{
+		// The file is started (with its header) the first time it is written to, not in init(), so that
+		// loading a checkpoint can keep the epochs that are already there.
+		savefile.open(epoch_log_file.c_str(), ios_base::out | (epoch_log_append ? ios_base::app : ios_base::trunc));
+		if (!savefile.is_open())
+		{
+			cerr << "ERROR: HybridSim Logger epoch output file failed to open.\n";
+			abort();
+		}
+
+		if (!epoch_log_append)
+		{
 			savefile << "================================================================================\n\n";
 			savefile << "Epoch data:\n\n";
-
-			savefile.close();
+			epoch_log_append = true;
 		}
+	}
 
+	void Logger::epoch_reset(bool init)
+	{
+		// If this is not initialization, then save the epoch state to the lists.
 		if (!init)
 		{
+			// Count this cycle (the last one of the epoch) and schedule the next reset.
+			this->settle(this->currentClockCycle + 1);
+			next_epoch_cycle = this->currentClockCycle + EPOCH_LENGTH;
+
 			// Open up the hybridsim_epoch.log
 			ofstream savefile;
-			savefile.open("hybridsim_epoch.log", ios_base::out | ios_base::app);
-			if (!savefile.is_open())
-			{
-				cerr << "ERROR: HybridSim Logger epoch output file failed to open.\n";
-				abort();
-			}
+			this->epoch_log_open(savefile);
 
 			// Output the current epoch data.
 			savefile << "---------------------------------------------------\n";
@@ -588,8 +881,8 @@ namespace HybridSim
 			savefile << "average hit latency: " << this->latency_cycles(cur_sum_hit_latency, cur_num_hits) << " cycles";
 			savefile << " (" << this->latency_us(cur_sum_hit_latency, cur_num_hits) << " us)\n";
 			savefile << "throughput: " << this->compute_throughput(EPOCH_LENGTH, cur_num_accesses) << " KB/s\n";
-			savefile << "working set size in pages: " << cur_pages_used.size() << "\n";
-			savefile << "working set size in bytes: " << cur_pages_used.size() * PAGE_SIZE << " bytes\n";
+			if (STATS_FULL)
+				this->print_working_set(savefile, true);
 			savefile << "current queue length: " << access_queue.size() << "\n";
 			savefile << "max queue length: " << cur_max_queue_length << "\n";
 			savefile << "average queue length: " << this->divide(cur_sum_queue_length, EPOCH_LENGTH) << "\n";
@@ -627,10 +920,23 @@ namespace HybridSim
 			savefile << "average hit latency: " << this->latency_cycles(cur_sum_write_hit_latency, cur_num_write_hits) << " cycles";
 			savefile << " (" << this->latency_us(cur_sum_write_hit_latency, cur_num_write_hits) << " us)\n";
 			savefile << "throughput: " << this->compute_throughput(EPOCH_LENGTH, cur_num_writes) << " KB/s\n";
-			savefile << "\n\n";
+			savefile << "\n";
+
+			if (STATS_FULL)
+			{
+				savefile << "latency percentiles (cycles):\n";
+				this->print_percentiles(savefile, true);
+				savefile << "\n\n";
+			}
 
 			// Output the missed page data.
 			savefile << "Missed Page Data:\n";
+			if (!STATS_FULL)
+				savefile << "(not collected with STATS=" << stats_level() << ")\n";
+			else if (binary_misses)
+				savefile << "(MISSED_PAGE_LOG=binary: " << miss_record.records << " records so far in " << miss_record_file << ")\n";
+			else if (!keep_misses)
+				savefile << "(MISSED_PAGE_LOG=none)\n";
 
 			list<MissedPageEntry>::iterator mit;
 			for (mit = missed_page_list.begin(); mit != missed_page_list.end(); mit++)
@@ -659,6 +965,9 @@ namespace HybridSim
 			// Close the output file.
 			savefile.close();
 
+			if (epoch_stats_enabled)
+				this->write_epoch_stats();
+
 			epoch_count++;
 		}
 
@@ -700,11 +1009,24 @@ namespace HybridSim
 
 		// Clear cur_pages_used
 		cur_pages_used.clear();
+		if (sketch_pages)
+			cur_distinct_pages.reset();
+
+		vector<LatencyHistogram *> epoch_histograms = this->histograms(true);
+		for (size_t i = 0; i < epoch_histograms.size(); i++)
+			epoch_histograms[i]->reset();
 	}
 
 	void Logger::print()
 	{
+		this->settle(this->currentClockCycle);
+
 		ofstream savefile;
+
+		// Make sure the epoch log is there (with its header) even if no epoch has finished.
+		this->epoch_log_open(savefile);
+		savefile.close();
+
 		savefile.open("hybridsim.log", ios_base::out | ios_base::trunc);
 		if (!savefile.is_open())
 		{
@@ -728,8 +1050,8 @@ namespace HybridSim
 		savefile << "average hit latency: " << this->latency_cycles(sum_hit_latency, num_hits) << " cycles";
 		savefile << " (" << this->latency_us(sum_hit_latency, num_hits) << " us)\n";
 		savefile << "throughput: " << this->compute_throughput(this->currentClockCycle, num_accesses) << " KB/s\n";
-		savefile << "working set size in pages: " << pages_used.size() << "\n";
-		savefile << "working set size in bytes: " << pages_used.size() * PAGE_SIZE << " bytes\n";
+		if (STATS_FULL)
+			this->print_working_set(savefile, false);
 		savefile << "page size: " << PAGE_SIZE << "\n";
 		savefile << "max queue length: " << max_queue_length << "\n";
 		savefile << "average queue length: " << this->divide(sum_queue_length, this->currentClockCycle) << "\n";
@@ -775,12 +1097,26 @@ namespace HybridSim
 
 		savefile << flush;
 
-		unordered_map<uint64_t, uint64_t>::iterator it; 
-		for (it = pages_used.begin(); it != pages_used.end(); it++)
+		if (!STATS_FULL)
+			savefile << "(not collected with STATS=" << stats_level() << ")\n";
+		else if (sketch_pages)
+		{
+			// Only the hot pages are known in sketch mode.
+			savefile << "(WORKING_SET_MODE=sketch: the " << HOT_PAGES << " most accessed pages, counts are high by at most " 
+				<< hot_pages.error_bound() << " with probability " << hot_pages.confidence() << ")\n";
+			vector<pair<uint64_t, uint64_t> > top = hot_pages.top();
+			for (size_t i = 0; i < top.size(); i++)
+				savefile << hex << "0x" << top[i].first << " : " << dec << top[i].second << "\n";
+		}
+		else
 		{
-			uint64_t page_addr = (*it).first;
-			uint64_t num_accesses = (*it).second;
-			savefile << hex << "0x" << page_addr << " : " << dec << num_accesses << "\n";
+			unordered_map<uint64_t, uint64_t>::iterator it; 
+			for (it = pages_used.begin(); it != pages_used.end(); it++)
+			{
+				uint64_t page_addr = (*it).first;
+				uint64_t num_accesses = (*it).second;
+				savefile << hex << "0x" << page_addr << " : " << dec << num_accesses << "\n";
+			}
 		}
 
 		savefile << "\n\n";
@@ -788,18 +1124,39 @@ namespace HybridSim
 		savefile << "================================================================================\n\n";
 		savefile << "Latency Histogram:\n\n";
 
-		savefile << "HISTOGRAM_BIN: " << HISTOGRAM_BIN << "\n";
-		savefile << "HISTOGRAM_MAX: " << HISTOGRAM_MAX << "\n\n";
-		for (uint64_t bin = 0; bin <= HISTOGRAM_MAX; bin += HISTOGRAM_BIN)
+		if (STATS_FULL)
+		{
+			savefile << "HISTOGRAM_BIN: " << HISTOGRAM_BIN << "\n";
+			savefile << "HISTOGRAM_MAX: " << HISTOGRAM_MAX << "\n\n";
+			for (uint64_t bin = 0; bin <= HISTOGRAM_MAX; bin += HISTOGRAM_BIN)
+			{
+				savefile << bin << ": " << latency_histogram[bin] << "\n";
+			}
+		}
+		else
+			savefile << "(not collected with STATS=" << stats_level() << ")\n";
+
+		savefile << "\n\n";
+
+		savefile << "================================================================================\n\n";
+		savefile << "Latency Percentiles (cycles):\n\n";
+
+		if (STATS_FULL)
 		{
-			savefile << bin << ": " << latency_histogram[bin] << "\n";
+			savefile << "HISTOGRAM_PRECISION: " << HISTOGRAM_PRECISION << "\n\n";
+			this->print_percentiles(savefile, false);
 		}
+		else
+			savefile << "(not collected with STATS=" << stats_level() << ")\n";
 
 		savefile << "\n\n";
 
 		savefile << "================================================================================\n\n";
 		savefile << "Set Conflicts:\n\n";
 
+		if (!STATS_FULL)
+			savefile << "(not collected with STATS=" << stats_level() << ")\n";
+
 		for (uint64_t set = 0; set < NUM_SETS; set++)
 		{
 			// Only print the sets that have greater than 0 conflicts.
@@ -808,6 +1165,215 @@ namespace HybridSim
 		}
 
 		savefile.close();
+
+		if (STATS_FULL)
+			this->write_histograms();
+
+		// Make sure the whole missed page record is on disk once the results are out.
+		if (binary_misses && !miss_record.is_open())
+			this->miss_record_open();
+		miss_record.flush();
+		if (epoch_stats.is_open())
+			epoch_stats.flush();
+	}
+
+	// Checkpoint element helpers for the logger's own types.
+	void checkpoint_write(ostream &out, const Logger::MissedPageEntry &v)
+	{
+		out << v.cycle << " " << v.missed_page << " " << v.victim_page << " " << v.cache_set << " " << v.cache_page << " " 
+			<< v.dirty << " " << v.valid << "\n";
+	}
+
+	void checkpoint_read(istream &in, Logger::MissedPageEntry &v)
+	{
+		uint64_t dirty, valid;
+		checkpoint_read(in, v.cycle);
+		checkpoint_read(in, v.missed_page);
+		checkpoint_read(in, v.victim_page);
+		checkpoint_read(in, v.cache_set);
+		checkpoint_read(in, v.cache_page);
+		checkpoint_read(in, dirty);
+		checkpoint_read(in, valid);
+		v.dirty = dirty;
+		v.valid = valid;
+	}
+
+	void checkpoint_write(ostream &out, const Logger::AccessMapEntry &v)
+	{
+		out << v.start << " " << v.process << " " << v.stop << " " << v.read_op << " " << v.hit << "\n";
+	}
+
+	void checkpoint_read(istream &in, Logger::AccessMapEntry &v)
+	{
+		uint64_t read_op, hit;
+		checkpoint_read(in, v.start);
+		checkpoint_read(in, v.process);
+		checkpoint_read(in, v.stop);
+		checkpoint_read(in, read_op);
+		checkpoint_read(in, hit);
+		v.read_op = read_op;
+		v.hit = hit;
+	}
+
+	vector<uint64_t *> Logger::checkpoint_counters()
+	{
+		// All of the scalar state, in the order it is saved.
+		uint64_t *counters[] = {&currentClockCycle, 
+			&num_accesses, &num_reads, &num_writes, &num_misses, &num_hits, 
+			&num_read_misses, &num_read_hits, &num_write_misses, &num_write_hits, 
+			&sum_latency, &sum_read_latency, &sum_write_latency, &sum_queue_latency, &sum_hit_latency, &sum_miss_latency, 
+			&sum_read_hit_latency, &sum_read_miss_latency, &sum_write_hit_latency, &sum_write_miss_latency, 
+			&max_queue_length, &sum_queue_length, &idle_counter, &flash_idle_counter, &dram_idle_counter, 
+			&num_mmio_dropped, &num_mmio_remapped, 
+			&epoch_count, 
+			&cur_num_accesses, &cur_num_reads, &cur_num_writes, &cur_num_misses, &cur_num_hits, 
+			&cur_num_read_misses, &cur_num_read_hits, &cur_num_write_misses, &cur_num_write_hits, 
+			&cur_sum_latency, &cur_sum_read_latency, &cur_sum_write_latency, &cur_sum_queue_latency, 
+			&cur_sum_hit_latency, &cur_sum_miss_latency, &cur_sum_read_hit_latency, &cur_sum_read_miss_latency, 
+			&cur_sum_write_hit_latency, &cur_sum_write_miss_latency, 
+			&cur_max_queue_length, &cur_sum_queue_length, &cur_idle_counter, &cur_flash_idle_counter, &cur_dram_idle_counter, 
+			&cur_num_mmio_dropped, &cur_num_mmio_remapped};
+		return vector<uint64_t *>(counters, counters + sizeof(counters) / sizeof(counters[0]));
+	}
+
+	// Cut an output file that is written while the simulation runs back to the size it had when a checkpoint
+	// was saved. Returns false (after a warning) if the file is not there or is too short, for example when
+	// resuming in a different directory. The file is then started over.
+	static bool truncate_output(string filename, uint64_t size)
+	{
+		struct stat st;
+		if ((stat(filename.c_str(), &st) == 0) && ((uint64_t)st.st_size >= size) && (truncate(filename.c_str(), size) == 0))
+			return true;
+
+		cerr << "WARNING: " << filename << " does not have the output from before the checkpoint. "
+			<< "It will only have the output after it.\n";
+		return false;
+	}
+
+	void Logger::saveCheckpoint(ostream &out)
+	{
+		checkpoint_section(out, "logger");
+		vector<uint64_t *> counters = checkpoint_counters();
+		for (size_t i = 0; i < counters.size(); i++)
+			checkpoint_write(out, *counters[i]);
+
+		checkpoint_write(out, pages_used);
+		checkpoint_write(out, cur_pages_used);
+		checkpoint_write(out, missed_page_list);
+		checkpoint_write(out, latency_histogram);
+		checkpoint_write(out, set_conflicts);
+		checkpoint_write(out, access_map);
+		checkpoint_write(out, access_queue);
+
+		uint64_t state[] = {state_queue_length, state_idle, state_flash_idle, state_dram_idle, state_cycle};
+		for (size_t i = 0; i < 5; i++)
+			checkpoint_write(out, state[i]);
+
+		if (binary_misses)
+		{
+			// The records before the checkpoint are in the file after this.
+			miss_record.flush();
+			checkpoint_write(out, miss_record.records);
+		}
+
+		// The text epoch log is closed between epochs, so its size on disk is everything before the checkpoint.
+		struct stat st;
+		uint64_t epoch_log_bytes = 0;
+		if (epoch_log_append && (stat(epoch_log_file.c_str(), &st) == 0))
+			epoch_log_bytes = st.st_size;
+		checkpoint_write(out, epoch_log_bytes);
+
+		if (epoch_stats_enabled)
+		{
+			if (epoch_stats.is_open())
+				epoch_stats.flush();
+			checkpoint_write(out, epoch_stats_bytes);
+			checkpoint_write(out, extra_counters_last);
+		}
+
+		if (sketch_pages)
+		{
+			distinct_pages.saveCheckpoint(out);
+			cur_distinct_pages.saveCheckpoint(out);
+			hot_pages.saveCheckpoint(out);
+		}
+
+		vector<LatencyHistogram *> total_histograms = this->histograms(false);
+		vector<LatencyHistogram *> epoch_histograms = this->histograms(true);
+		for (size_t i = 0; i < total_histograms.size(); i++)
+		{
+			total_histograms[i]->saveCheckpoint(out);
+			epoch_histograms[i]->saveCheckpoint(out);
+		}
+	}
+
+	void Logger::loadCheckpoint(istream &in)
+	{
+		checkpoint_expect(in, "logger");
+		vector<uint64_t *> counters = checkpoint_counters();
+		for (size_t i = 0; i < counters.size(); i++)
+			checkpoint_read(in, *counters[i]);
+
+		checkpoint_read(in, pages_used);
+		checkpoint_read(in, cur_pages_used);
+		checkpoint_read(in, missed_page_list);
+		checkpoint_read(in, latency_histogram);
+		checkpoint_read(in, set_conflicts);
+		checkpoint_read(in, access_map);
+		checkpoint_read(in, access_queue);
+
+		uint64_t state[5];
+		for (size_t i = 0; i < 5; i++)
+			checkpoint_read(in, state[i]);
+		state_queue_length = state[0];
+		state_idle = state[1];
+		state_flash_idle = state[2];
+		state_dram_idle = state[3];
+		state_cycle = state[4];
+		next_epoch_cycle = ((this->currentClockCycle + EPOCH_LENGTH - 1) / EPOCH_LENGTH) * EPOCH_LENGTH;
+
+		if (binary_misses)
+		{
+			// Keep the records from before the checkpoint (if this is the same directory as the original run)
+			// and drop anything written after it.
+			uint64_t records;
+			checkpoint_read(in, records);
+			miss_record.close();
+			miss_record_append = truncate_output(miss_record_file, MissRecordWriter::HEADER_SIZE + records * MissRecordWriter::RECORD_SIZE);
+			miss_record.records = records;
+		}
+
+		// Keep the text epochs from before the checkpoint and drop anything written after it. If the
+		// checkpoint was saved before the first epoch, the file is started over.
+		uint64_t epoch_log_bytes;
+		checkpoint_read(in, epoch_log_bytes);
+		epoch_log_append = (epoch_log_bytes > 0) && truncate_output(epoch_log_file, epoch_log_bytes);
+
+		if (epoch_stats_enabled)
+		{
+			checkpoint_read(in, epoch_stats_bytes);
+			checkpoint_read(in, extra_counters_last);
+			if (epoch_stats.is_open())
+				epoch_stats.close();
+			epoch_stats_append = truncate_output(epoch_stats_file, epoch_stats_bytes);
+			if (!epoch_stats_append)
+				epoch_stats_bytes = 0;
+		}
+
+		if (sketch_pages)
+		{
+			distinct_pages.loadCheckpoint(in);
+			cur_distinct_pages.loadCheckpoint(in);
+			hot_pages.loadCheckpoint(in);
+		}
+
+		vector<LatencyHistogram *> total_histograms = this->histograms(false);
+		vector<LatencyHistogram *> epoch_histograms = this->histograms(true);
+		for (size_t i = 0; i < total_histograms.size(); i++)
+		{
+			total_histograms[i]->loadCheckpoint(in);
+			epoch_histograms[i]->loadCheckpoint(in);
+		}
 	}
 }
 
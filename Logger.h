@@ -35,6 +35,28 @@
 #include <fstream>
 
 #include "config.h"
+#include "LatencyHistogram.h"
+#include "WorkingSetSketch.h"
+#include "MissRecord.h"
+
+// Statistics level, picked at build time with "make STATS=none|counters|full" (full is the default).
+//   none: the Logger is never called, so a run pays nothing for statistics even with ENABLE_LOGGER=1.
+//   counters: access, hit/miss, latency, queue length and idle counters (hybridsim.log and the epoch stats).
+//   full: counters plus the per-page counts, working set, latency histograms, set conflicts and missed pages.
+// LOGGER_ON and LOGGER_FULL are the checks to use around Logger calls. They are constant false when the level
+// is too low, so the calls and the branches around them are compiled out. ENABLE_LOGGER still turns the
+// Logger off at run time in the other levels.
+#define HYBRIDSIM_STATS_NONE 0
+#define HYBRIDSIM_STATS_COUNTERS 1
+#define HYBRIDSIM_STATS_FULL 2
+
+#ifndef HYBRIDSIM_STATS
+#define HYBRIDSIM_STATS HYBRIDSIM_STATS_FULL
+#endif
+
+#define STATS_FULL (HYBRIDSIM_STATS >= HYBRIDSIM_STATS_FULL)
+#define LOGGER_ON ((HYBRIDSIM_STATS >= HYBRIDSIM_STATS_COUNTERS) && ENABLE_LOGGER)
+#define LOGGER_FULL (STATS_FULL && ENABLE_LOGGER)
 
 
 namespace HybridSim
@@ -85,7 +107,20 @@ namespace HybridSim
 		uint64_t num_mmio_dropped;
 		uint64_t num_mmio_remapped;
 
-		unordered_map<uint64_t, uint64_t> pages_used; // maps page_addr to num_accesses
+		unordered_map<uint64_t, uint64_t> pages_used; // maps page_addr to num_accesses (WORKING_SET_MODE=exact)
+
+		// Page statistics for WORKING_SET_MODE=sketch (these replace pages_used and cur_pages_used).
+		bool sketch_pages;
+		HyperLogLog distinct_pages;
+		HyperLogLog cur_distinct_pages;
+		HotPageSketch hot_pages;
+
+		// Latency distributions (written to hybridsim_latency.hist so runs can be merged).
+		LatencyHistogram read_hit_histogram;
+		LatencyHistogram read_miss_histogram;
+		LatencyHistogram write_hit_histogram;
+		LatencyHistogram write_miss_histogram;
+		LatencyHistogram queue_histogram;
 
 		// Epoch state (reset at the beginning of each epoch)
 		uint64_t epoch_count;
@@ -128,6 +163,12 @@ namespace HybridSim
 
 		unordered_map<uint64_t, uint64_t> cur_pages_used; // maps page_addr to num_accesses
 
+		LatencyHistogram cur_read_hit_histogram;
+		LatencyHistogram cur_read_miss_histogram;
+		LatencyHistogram cur_write_hit_histogram;
+		LatencyHistogram cur_write_miss_histogram;
+		LatencyHistogram cur_queue_histogram;
+
 
 		// -----------------------------------------------------------
 		// Missed Page Record
@@ -153,9 +194,41 @@ namespace HybridSim
 				dirty = d;
 				valid = v;
 			}
+
+			MissedPageEntry() : cycle(0), missed_page(0), victim_page(0), cache_set(0), cache_page(0), dirty(false), valid(false) {}
 		};
 
-		list<MissedPageEntry> missed_page_list;
+		list<MissedPageEntry> missed_page_list; // MISSED_PAGE_LOG=epoch
+
+		// MISSED_PAGE_LOG=binary
+		bool binary_misses;
+		bool keep_misses; // MISSED_PAGE_LOG is not none.
+		MissRecordWriter miss_record;
+		string miss_record_file;
+		bool miss_record_append; // Append to the file when it is (re)opened.
+		void miss_record_open();
+
+		// Machine readable epoch statistics (EPOCH_STATS). The file stays open for the whole run.
+		bool epoch_stats_enabled;
+		bool epoch_stats_csv;
+		ofstream epoch_stats;
+		string epoch_stats_file;
+		bool epoch_stats_append; // Append to the file when it is (re)opened.
+		uint64_t epoch_stats_bytes; // Bytes in the file so far.
+		vector<pair<string, uint64_t *> > extra_counters; // Counters kept outside the Logger (see add_epoch_counter).
+		vector<uint64_t> extra_counters_last; // Their values at the start of the epoch.
+		void add_epoch_counter(string name, uint64_t *counter);
+		vector<pair<string, uint64_t> > epoch_record();
+		void write_epoch_stats();
+
+		// Human readable epoch log (hybridsim_epoch.log). It is only open while an epoch is written.
+		string epoch_log_file;
+		bool epoch_log_append; // Append to the file when it is (re)opened (false until the header is written).
+		void epoch_log_open(ofstream &savefile);
+
+		// Close the background writer and the open output files (used before fork(), since threads do not
+		// survive it). They are reopened in append mode the next time they are written to.
+		void close_streams();
 
 
 		unordered_map<uint64_t, uint64_t> latency_histogram; 
@@ -184,25 +257,49 @@ namespace HybridSim
 		};
 
 
-		// Store access info while the access is being processed.
+		// Store access info while the access is being processed (keyed by transaction id).
 		unordered_map<uint64_t, AccessMapEntry> access_map;
 
-		// Store the address and arrival time while access is waiting to be processed.
-		// Must do this because duplicate addresses may arrive close together.
-		list<pair <uint64_t, uint64_t>> access_queue;
+		// Store the arrival time (keyed by transaction id) while the access is waiting to be processed.
+		unordered_map<uint64_t, uint64_t> access_queue;
 
 		ofstream debug;
 
+		// Queue length and idle state reported by the last access_update(). The queue length and idle
+		// counters are only brought up to date when this changes (or when they are read), so cycles where
+		// nothing changes cost one comparison. state_cycle is the first cycle that is not counted yet.
+		uint64_t state_queue_length;
+		bool state_idle;
+		bool state_flash_idle;
+		bool state_dram_idle;
+		uint64_t state_cycle;
+
+		uint64_t next_epoch_cycle;
+
 		// -----------------------------------------------------------
 		// API Methods
-		void update();
+		void update()
+		{
+			// At the start of each EPOCH_LENGTH cycles, output and reset the epoch state.
+			if (this->currentClockCycle >= next_epoch_cycle)
+				epoch_reset(false);
+
+			// Increment to the next clock cycle.
+			this->step();
+		}
 
 		// External logging methods.
-		void access_start(uint64_t addr);
-		void access_process(uint64_t addr, bool read_op, bool hit);
-		void access_stop(uint64_t addr);
+		void access_start(uint64_t id, uint64_t addr);
+		void access_process(uint64_t id, uint64_t addr, bool read_op, bool hit);
+		void access_stop(uint64_t id);
 
-		void access_update(uint64_t queue_length, bool idle, bool flash_idle, bool dram_idle);
+		// Called once per cycle with the current queue length and idle state.
+		void access_update(uint64_t queue_length, bool idle, bool flash_idle, bool dram_idle)
+		{
+			if ((queue_length != state_queue_length) || (idle != state_idle) || (flash_idle != state_flash_idle) || 
+					(dram_idle != state_dram_idle))
+				state_change(queue_length, idle, flash_idle, dram_idle);
+		}
 
 		//void access_cache(uint64_t addr, bool hit);
 
@@ -217,6 +314,11 @@ namespace HybridSim
 
 		void print();
 
+		// Checkpoint support (see HybridSystem::saveCheckpoint).
+		void saveCheckpoint(ostream &out);
+		void loadCheckpoint(istream &in);
+		vector<uint64_t *> checkpoint_counters();
+
 		// -----------------------------------------------------------
 		// Internal helper methods.
 
@@ -252,8 +354,18 @@ namespace HybridSim
 		double compute_throughput(uint64_t cycles, uint64_t accesses);
 		double latency_cycles(uint64_t sum, uint64_t accesses);
 		double latency_us(uint64_t sum, uint64_t accesses);
+		uint64_t working_set_pages(bool epoch);
+		void print_working_set(ostream &out, bool epoch);
+		vector<LatencyHistogram *> histograms(bool epoch);
+		void print_percentiles(ostream &out, bool epoch);
+		void write_histograms();
+
+		// Name of the STATS level this was built with.
+		static const char *stats_level();
 
 		void epoch_reset(bool init);
+		void state_change(uint64_t queue_length, bool idle, bool flash_idle, bool dram_idle);
+		void settle(uint64_t end);
 	};
 
 }
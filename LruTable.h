@@ -0,0 +1,183 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_LRUTABLE_H
+#define HYBRIDSIM_LRUTABLE_H
+
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+
+#include "config.h"
+
+namespace HybridSim
+{
+	// LruTable is a fixed size table of entries keyed by address that evicts the least recently used entry
+	// when it is full. The entries live in a vector allocated once by init() and are chained in LRU order
+	// by index, so lookups, inserts, erases and evictions are all constant time.
+	template <class T>
+	class LruTable
+	{
+		public:
+		static const int64_t NONE = -1;
+
+		struct Entry
+		{
+			uint64_t key;
+			T value;
+			int64_t prev; // Toward the least recently used entry.
+			int64_t next; // Toward the most recently used entry.
+		};
+
+		LruTable()
+		{
+			lru = NONE;
+			mru = NONE;
+			free_head = NONE;
+		}
+
+		void init(uint64_t capacity)
+		{
+			entries.clear();
+			entries.resize(capacity);
+			index.clear();
+			index.reserve(capacity);
+			lru = NONE;
+			mru = NONE;
+			free_head = NONE;
+			for (int64_t i = (int64_t)capacity - 1; i >= 0; i--)
+			{
+				entries[i].next = free_head;
+				free_head = i;
+			}
+		}
+
+		void clear() { this->init(entries.size()); }
+
+		uint64_t capacity() const { return entries.size(); }
+		uint64_t size() const { return index.size(); }
+
+		// Returns NULL if key is not in the table. Does not change the LRU order.
+		T *find(uint64_t key)
+		{
+			unordered_map<uint64_t, int64_t>::iterator it = index.find(key);
+			if (it == index.end())
+				return NULL;
+			return &entries[(*it).second].value;
+		}
+
+		// Insert key (or replace its value) as the most recently used entry. If the table is full, the least
+		// recently used entry is evicted first. Returns true and sets evicted_key if that happened. A table with
+		// no capacity stays empty.
+		bool insert(uint64_t key, const T &value, uint64_t *evicted_key)
+		{
+			if (entries.empty())
+				return false;
+
+			bool evicted = false;
+			int64_t i;
+			unordered_map<uint64_t, int64_t>::iterator it = index.find(key);
+			if (it != index.end())
+			{
+				i = (*it).second;
+				this->unlink(i);
+			}
+			else
+			{
+				if (free_head == NONE)
+				{
+					if (evicted_key != NULL)
+						*evicted_key = entries[lru].key;
+					evicted = true;
+					this->erase(entries[lru].key);
+				}
+				i = free_head;
+				free_head = entries[i].next;
+				index[key] = i;
+			}
+
+			entries[i].key = key;
+			entries[i].value = value;
+			this->link_mru(i);
+			return evicted;
+		}
+
+		// Returns false if key is not in the table.
+		bool erase(uint64_t key)
+		{
+			unordered_map<uint64_t, int64_t>::iterator it = index.find(key);
+			if (it == index.end())
+				return false;
+			int64_t i = (*it).second;
+			index.erase(it);
+			this->unlink(i);
+			entries[i].next = free_head;
+			free_head = i;
+			return true;
+		}
+
+		// Walk the entries from the least to the most recently used (for checkpoints).
+		int64_t oldest() const { return lru; }
+		int64_t newer(int64_t i) const { return entries[i].next; }
+		const Entry &entry(int64_t i) const { return entries[i]; }
+
+		private:
+		vector<Entry> entries;
+		unordered_map<uint64_t, int64_t> index; // key -> entry
+		int64_t lru;
+		int64_t mru;
+		int64_t free_head; // Unused entries are chained through next.
+
+		void unlink(int64_t i)
+		{
+			if (entries[i].prev == NONE)
+				lru = entries[i].next;
+			else
+				entries[entries[i].prev].next = entries[i].next;
+			if (entries[i].next == NONE)
+				mru = entries[i].prev;
+			else
+				entries[entries[i].next].prev = entries[i].prev;
+		}
+
+		void link_mru(int64_t i)
+		{
+			entries[i].prev = mru;
+			entries[i].next = NONE;
+			if (mru == NONE)
+				lru = i;
+			else
+				entries[mru].next = i;
+			mru = i;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,200 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include "MemoryBackend.h"
+#include "AnalyticMemory.h"
+
+using namespace std;
+
+namespace HybridSim
+{
+#ifndef ANALYTIC_ONLY
+	DRAMSimBackend::DRAMSimBackend(string inipathPrefix)
+	{
+		uint64_t dram_size = (CACHE_PAGES * PAGE_SIZE) >> 20;
+		dram_size = (dram_size == 0) ? 1 : dram_size; // DRAMSim requires a minimum of 1 MB, even if HybridSim isn't going to use it.
+		dram_size = (OVERRIDE_DRAM_SIZE == 0) ? dram_size : OVERRIDE_DRAM_SIZE; // If OVERRIDE_DRAM_SIZE is non-zero, then use it.
+		dram = DRAMSim::getMemorySystemInstance(dram_ini, sys_ini, inipathPrefix, "resultsfilename", dram_size);
+
+		ReadDone = NULL;
+		WriteDone = NULL;
+
+		typedef DRAMSim::Callback <DRAMSimBackend, void, uint, uint64_t, uint64_t> dramsim_callback_t;
+		DRAMSim::TransactionCompleteCB *read_cb = new dramsim_callback_t(this, &DRAMSimBackend::read_complete);
+		DRAMSim::TransactionCompleteCB *write_cb = new dramsim_callback_t(this, &DRAMSimBackend::write_complete);
+		dram->RegisterCallbacks(read_cb, write_cb, NULL);
+	}
+
+	// DRAMSim2 only returns the address, so the id is dropped here.
+	bool DRAMSimBackend::addTransaction(bool isWrite, uint64_t addr, uint64_t id)
+	{
+		return dram->addTransaction(isWrite, addr);
+	}
+
+	void DRAMSimBackend::update()
+	{
+		dram->update();
+	}
+
+	void DRAMSimBackend::RegisterCallbacks(BackendCompleteCB *readDone, BackendCompleteCB *criticalLine, BackendCompleteCB *writeDone)
+	{
+		// DRAMSim does not do critical line first.
+		ReadDone = readDone;
+		WriteDone = writeDone;
+	}
+
+	void DRAMSimBackend::read_complete(uint id, uint64_t addr, uint64_t cycle)
+	{
+		if (ReadDone != NULL)
+			(*ReadDone)(id, addr, cycle);
+	}
+
+	void DRAMSimBackend::write_complete(uint id, uint64_t addr, uint64_t cycle)
+	{
+		if (WriteDone != NULL)
+			(*WriteDone)(id, addr, cycle);
+	}
+
+
+	NVDIMMBackend::NVDIMMBackend(string inipathPrefix)
+	{
+		flash = NVDSim::getNVDIMMInstance(1,flash_ini,"ini/def_system.ini",inipathPrefix,"");
+
+		ReadDone = NULL;
+		CriticalLine = NULL;
+		WriteDone = NULL;
+
+		typedef NVDSim::Callback <NVDIMMBackend, void, uint64_t, uint64_t, uint64_t, bool> nvdsim_callback_t;
+		NVDSim::Callback_t *nv_read_cb = new nvdsim_callback_t(this, &NVDIMMBackend::read_complete);
+		NVDSim::Callback_t *nv_write_cb = new nvdsim_callback_t(this, &NVDIMMBackend::write_complete);
+		NVDSim::Callback_t *nv_crit_cb = new nvdsim_callback_t(this, &NVDIMMBackend::critical_line_complete);
+		flash->RegisterCallbacks(nv_read_cb, nv_crit_cb, nv_write_cb, NULL);
+	}
+
+	// NVDIMMSim only returns the address, so the id is dropped here.
+	bool NVDIMMBackend::addTransaction(bool isWrite, uint64_t addr, uint64_t id)
+	{
+		return flash->addTransaction(isWrite, addr);
+	}
+
+	void NVDIMMBackend::update()
+	{
+		flash->update();
+	}
+
+	void NVDIMMBackend::RegisterCallbacks(BackendCompleteCB *readDone, BackendCompleteCB *criticalLine, BackendCompleteCB *writeDone)
+	{
+		ReadDone = readDone;
+		CriticalLine = criticalLine;
+		WriteDone = writeDone;
+	}
+
+	void NVDIMMBackend::saveStats()
+	{
+		flash->saveStats();
+	}
+
+	void NVDIMMBackend::loadState(string filename)
+	{
+		flash->loadNVState(filename);
+	}
+
+	void NVDIMMBackend::saveState(string filename)
+	{
+		flash->saveNVState(filename);
+	}
+
+	// The unmapped flag is not used by HybridSim, so it is dropped here.
+	void NVDIMMBackend::read_complete(uint64_t id, uint64_t addr, uint64_t cycle, bool unmapped)
+	{
+		if (ReadDone != NULL)
+			(*ReadDone)(id, addr, cycle);
+	}
+
+	void NVDIMMBackend::critical_line_complete(uint64_t id, uint64_t addr, uint64_t cycle, bool unmapped)
+	{
+		if (CriticalLine != NULL)
+			(*CriticalLine)(id, addr, cycle);
+	}
+
+	void NVDIMMBackend::write_complete(uint64_t id, uint64_t addr, uint64_t cycle, bool unmapped)
+	{
+		if (WriteDone != NULL)
+			(*WriteDone)(id, addr, cycle);
+	}
+#endif
+
+
+	MemoryBackend *getDRAMBackendInstance(string inipathPrefix)
+	{
+		if (DRAM_BACKEND == "analytic")
+		{
+			cerr << "Creating analytic DRAM model\n";
+			return new AnalyticMemory("DRAM", ANALYTIC_DRAM_READ_LATENCY, ANALYTIC_DRAM_WRITE_LATENCY,
+					ANALYTIC_DRAM_TRANSFER_CYCLES, ANALYTIC_DRAM_CHANNELS, ANALYTIC_DRAM_QUEUE_DEPTH, BURST_SIZE);
+		}
+		else if (DRAM_BACKEND == "dramsim")
+		{
+#ifndef ANALYTIC_ONLY
+			cerr << "Creating DRAM with " << dram_ini << "\n";
+			return new DRAMSimBackend(inipathPrefix);
+#else
+			cerr << "ERROR: DRAM_BACKEND=dramsim but HybridSim was built with ANALYTIC_ONLY.\n";
+			abort();
+#endif
+		}
+
+		cerr << "ERROR: Invalid DRAM_BACKEND in HybridSim ini file: " << DRAM_BACKEND << "\n";
+		abort();
+	}
+
+	MemoryBackend *getFlashBackendInstance(string inipathPrefix)
+	{
+		if (FLASH_BACKEND == "analytic")
+		{
+			cerr << "Creating analytic Flash model\n";
+			return new AnalyticMemory("Flash", ANALYTIC_FLASH_READ_LATENCY, ANALYTIC_FLASH_WRITE_LATENCY,
+					ANALYTIC_FLASH_TRANSFER_CYCLES, ANALYTIC_FLASH_CHANNELS, ANALYTIC_FLASH_QUEUE_DEPTH, FLASH_BURST_SIZE);
+		}
+		else if (FLASH_BACKEND == "nvdimmsim")
+		{
+#ifndef ANALYTIC_ONLY
+			cerr << "Creating Flash with " << flash_ini << "\n";
+			return new NVDIMMBackend(inipathPrefix);
+#else
+			cerr << "ERROR: FLASH_BACKEND=nvdimmsim but HybridSim was built with ANALYTIC_ONLY.\n";
+			abort();
+#endif
+		}
+
+		cerr << "ERROR: Invalid FLASH_BACKEND in HybridSim ini file: " << FLASH_BACKEND << "\n";
+		abort();
+	}
+}
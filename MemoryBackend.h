@@ -0,0 +1,141 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_MEMORYBACKEND_H
+#define HYBRIDSIM_MEMORYBACKEND_H
+
+#include <iostream>
+#include <string>
+
+#include "config.h"
+#include "CallbackHybrid.h"
+
+namespace HybridSim
+{
+	// Callback signature used by all backends: (id, address, cycle).
+	typedef CallbackBase <void, uint64_t, uint64_t, uint64_t> BackendCompleteCB;
+
+	// MemoryBackend is the interface HybridSystem uses to talk to the DRAM and the NVRAM.
+	// The backend is selected at runtime with DRAM_BACKEND and FLASH_BACKEND in the ini file.
+	class MemoryBackend
+	{
+		public:
+		virtual ~MemoryBackend() {}
+
+		// Returns false if the backend cannot accept the transaction on this cycle.
+		// id is the HybridSim transaction id the operation is for (see returnsIds()).
+		virtual bool addTransaction(bool isWrite, uint64_t addr, uint64_t id) = 0;
+
+		// True if the callbacks pass back the id given to addTransaction(). Otherwise the id in the
+		// callbacks is the backend's own and completions can only be matched by address.
+		virtual bool returnsIds() { return false; }
+
+		// Promises that let the flash thread run without waiting on every cycle (see FlashThread.h). 0 means no promise.
+		// quietUpdates() is how many of the next update() calls are certain to make no callbacks, even if more
+		// transactions are added in between. freeSlots() is how many addTransaction() calls are certain to be
+		// accepted. update() never lowers it and only raises it when it makes a callback, so a backend that
+		// makes the first promise has to make the second one too.
+		virtual uint64_t quietUpdates() { return 0; }
+		virtual uint64_t freeSlots() { return 0; }
+
+		// Advance the backend by one of its own clock cycles.
+		virtual void update() = 0;
+
+		// criticalLine may be NULL. Backends without critical line first support never call it.
+		virtual void RegisterCallbacks(BackendCompleteCB *readDone, BackendCompleteCB *criticalLine, BackendCompleteCB *writeDone) = 0;
+
+		// Optional hooks for logging and save/restore.
+		virtual void saveStats() {}
+		virtual void loadState(string filename) {}
+		virtual void saveState(string filename) {}
+
+		// Exact checkpoint of the backend, including its in flight transactions (see HybridSystem::saveCheckpoint).
+		// Backends that cannot do this refuse, since resuming without their in flight work would not be exact.
+		virtual void saveCheckpoint(ostream &out)
+		{
+			cerr << "ERROR: This memory backend does not support checkpoints (only the analytic backend does).\n";
+			abort();
+		}
+		virtual void loadCheckpoint(istream &in)
+		{
+			cerr << "ERROR: This memory backend does not support checkpoints (only the analytic backend does).\n";
+			abort();
+		}
+	};
+
+#ifndef ANALYTIC_ONLY
+	// Adapter for DRAMSim2.
+	class DRAMSimBackend: public MemoryBackend
+	{
+		public:
+		DRAMSimBackend(string inipathPrefix);
+
+		bool addTransaction(bool isWrite, uint64_t addr, uint64_t id);
+		void update();
+		void RegisterCallbacks(BackendCompleteCB *readDone, BackendCompleteCB *criticalLine, BackendCompleteCB *writeDone);
+
+		void read_complete(uint id, uint64_t addr, uint64_t cycle);
+		void write_complete(uint id, uint64_t addr, uint64_t cycle);
+
+		DRAMSim::MultiChannelMemorySystem *dram;
+		BackendCompleteCB *ReadDone;
+		BackendCompleteCB *WriteDone;
+	};
+
+	// Adapter for NVDIMMSim.
+	class NVDIMMBackend: public MemoryBackend
+	{
+		public:
+		NVDIMMBackend(string inipathPrefix);
+
+		bool addTransaction(bool isWrite, uint64_t addr, uint64_t id);
+		void update();
+		void RegisterCallbacks(BackendCompleteCB *readDone, BackendCompleteCB *criticalLine, BackendCompleteCB *writeDone);
+		void saveStats();
+		void loadState(string filename);
+		void saveState(string filename);
+
+		void read_complete(uint64_t id, uint64_t addr, uint64_t cycle, bool unmapped);
+		void critical_line_complete(uint64_t id, uint64_t addr, uint64_t cycle, bool unmapped);
+		void write_complete(uint64_t id, uint64_t addr, uint64_t cycle, bool unmapped);
+
+		NVDSim::NVDIMM *flash;
+		BackendCompleteCB *ReadDone;
+		BackendCompleteCB *CriticalLine;
+		BackendCompleteCB *WriteDone;
+	};
+#endif
+
+	// Build the backends selected in the ini file.
+	MemoryBackend *getDRAMBackendInstance(string inipathPrefix);
+	MemoryBackend *getFlashBackendInstance(string inipathPrefix);
+}
+
+#endif
@@ -0,0 +1,72 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include "MissRecord.h"
+
+using namespace std;
+
+namespace HybridSim
+{
+	MissRecordWriter::MissRecordWriter()
+	{
+		records = 0;
+	}
+
+	void MissRecordWriter::open(string filename, uint64_t buffer_records, bool append)
+	{
+		if (buffer_records == 0)
+		{
+			cerr << "ERROR: MISSED_PAGE_BUFFER must be greater than 0.\n";
+			abort();
+		}
+
+		if (out.open(filename, buffer_records * RECORD_SIZE, append) == 0)
+		{
+			out.write("HSMISSES", 8);
+			out.put_uint64(VERSION);
+			out.put_uint64(PAGE_SIZE);
+			out.put_uint64(NUM_SETS);
+			out.put_uint64(RECORD_SIZE);
+		}
+	}
+
+	void MissRecordWriter::write(uint64_t cycle, uint64_t missed_page, uint64_t victim_page, uint64_t cache_set, uint64_t cache_page, 
+			bool dirty, bool valid)
+	{
+		out.put_uint64(cycle);
+		out.put_uint64(missed_page);
+		out.put_uint64(victim_page);
+		out.put_uint64(cache_set);
+		out.put_uint64(cache_page);
+		char flags = (char)((dirty ? 1 : 0) | (valid ? 2 : 0));
+		out.write(&flags, 1);
+		records++;
+	}
+}
@@ -0,0 +1,70 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_MISSRECORD_H
+#define HYBRIDSIM_MISSRECORD_H
+
+#include "BufferedWriter.h"
+
+namespace HybridSim
+{
+	// MissRecordWriter streams the Logger's missed page records (MISSED_PAGE_LOG=binary) to a binary file
+	// through a BufferedWriter, so a miss heavy run neither holds its misses in memory until the end of the
+	// epoch nor spends its time formatting and writing them. tools/read_miss_record.py turns the file into
+	// text or CSV.
+	//
+	// File format (all integers little endian):
+	//   header: "HSMISSES" then version, PAGE_SIZE, NUM_SETS and the record size as uint64
+	//   record: cycle, missed page, victim page, cache set and cache page as uint64, then one flags byte
+	//           (bit 0 is dirty, bit 1 is valid)
+	class MissRecordWriter
+	{
+		public:
+		static const uint64_t VERSION = 1;
+		static const uint64_t HEADER_SIZE = 40;
+		static const uint64_t RECORD_SIZE = 41;
+
+		MissRecordWriter();
+
+		// Open filename with a buffer of buffer_records records. With append, the records are added to the end
+		// of an existing file (the header is only written if the file is empty).
+		void open(string filename, uint64_t buffer_records, bool append);
+		void write(uint64_t cycle, uint64_t missed_page, uint64_t victim_page, uint64_t cache_set, uint64_t cache_page, 
+				bool dirty, bool valid);
+		void flush() { out.flush(); } // Wait until every record so far is in the file.
+		void close() { out.close(); }
+		bool is_open() { return out.is_open(); }
+
+		uint64_t records; // Records written so far (including the ones still in the buffers).
+		BufferedWriter out;
+	};
+}
+
+#endif
@@ -0,0 +1,323 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include <algorithm>
+#include <iomanip>
+
+#include "OpenLoop.h"
+#include "TraceIndex.h"
+
+using namespace HybridSim;
+using namespace std;
+
+OpenLoopDriver::OpenLoopDriver()
+{
+	ini = "";
+	source = "random";
+	poisson = true;
+	start_rate = 0.1;
+	rate_factor = 1.5;
+	max_points = 20;
+	accesses = 20000;
+	warmup_fraction = 0.1;
+	write_fraction = 0.3;
+	footprint = 0;
+	max_outstanding = 100000;
+	saturation_threshold = 0.95;
+	seed = 1;
+
+	gen = NULL;
+	outstanding = 0;
+	completed = 0;
+	completed_in_window = 0;
+	injecting = false;
+}
+
+void OpenLoopDriver::read_complete(uint64_t id, uint64_t address, uint64_t cycle)
+{
+	complete(id, cycle);
+}
+
+void OpenLoopDriver::write_complete(uint64_t id, uint64_t address, uint64_t cycle)
+{
+	complete(id, cycle);
+}
+
+void OpenLoopDriver::complete(uint64_t id, uint64_t cycle)
+{
+	// Accesses that were not issued by run_rate() (e.g. FUNCTIONAL_ACCESSES warmup) are ignored.
+	unordered_map<uint64_t, pair<uint64_t, bool> >::iterator it = in_flight.find(id);
+	if (it == in_flight.end())
+		return;
+
+	pair<uint64_t, bool> issue = (*it).second;
+	in_flight.erase(it);
+
+	outstanding--;
+	completed++;
+	if (injecting)
+		completed_in_window++;
+	if (issue.second)
+		latencies.push_back(cycle - issue.first);
+}
+
+void OpenLoopDriver::next_access(bool &isWrite, uint64_t &addr)
+{
+	if (gen != NULL)
+	{
+		gen->next(isWrite, addr);
+		return;
+	}
+
+	// Replay the trace addresses in order (wrapping around at the end) and ignore the trace timestamps.
+	char char_line[256];
+	bool wrapped = false;
+	while (true)
+	{
+		if (!trace.good())
+		{
+			if (wrapped)
+			{
+				cout << "ERROR: No accesses in trace file " << tracefile << "\n";
+				abort();
+			}
+			trace.clear();
+			trace.seekg(0);
+			wrapped = true;
+		}
+
+		trace.getline(char_line, 256);
+		uint64_t cycle;
+		if (parse_trace_line((string)char_line, cycle, isWrite, addr))
+			return;
+	}
+}
+
+double OpenLoopDriver::next_interarrival(double mean)
+{
+	if (!poisson)
+		return mean;
+	exponential_distribution<double> exponential(1.0 / mean);
+	return exponential(rng);
+}
+
+bool OpenLoopDriver::run_rate(double rate, ofstream &log)
+{
+	HybridSystem *mem = new HybridSystem(1, ini);
+	typedef CallbackBase<void,uint64_t,uint64_t,uint64_t> Callback_t;
+	Callback_t *read_cb = new Callback<OpenLoopDriver, void, uint64_t, uint64_t, uint64_t>(this, &OpenLoopDriver::read_complete);
+	Callback_t *write_cb = new Callback<OpenLoopDriver, void, uint64_t, uint64_t, uint64_t>(this, &OpenLoopDriver::write_complete);
+	mem->RegisterIdCallbacks(read_cb, write_cb);
+
+	// Every rate sees the same address stream and the same arrival randomness.
+	if (source == "trace")
+	{
+		trace.close();
+		trace.clear();
+		trace.open(tracefile.c_str(), ifstream::in);
+		if (!trace.is_open())
+		{
+			cout << "ERROR: Failed to load tracefile: " << tracefile << "\n";
+			abort();
+		}
+	}
+	else
+	{
+		gen = new TrafficGenerator(source, footprint, write_fraction, seed);
+	}
+	rng.seed(seed);
+
+	in_flight.clear();
+	latencies.clear();
+	outstanding = 0;
+	completed = 0;
+	completed_in_window = 0;
+	injecting = false;
+
+	// FUNCTIONAL_ACCESSES warmup takes no time, so just do it up front.
+	while (mem->isFunctional())
+	{
+		bool isWrite;
+		uint64_t addr;
+		next_access(isWrite, addr);
+		mem->addTransaction(isWrite, addr);
+	}
+
+	double mean_interarrival = CYCLES_PER_SECOND / (rate * 1000000.0); // In cycles.
+	uint64_t warmup = (uint64_t)(accesses * warmup_fraction);
+	uint64_t issued = 0;
+	double next_arrival = (double) mem->currentClockCycle;
+	uint64_t window_start = mem->currentClockCycle;
+	bool overloaded = false;
+
+	while (issued < accesses)
+	{
+		while ((issued < accesses) && (next_arrival <= mem->currentClockCycle))
+		{
+			if (issued == warmup)
+			{
+				window_start = mem->currentClockCycle;
+				injecting = true;
+			}
+
+			bool isWrite;
+			uint64_t addr;
+			next_access(isWrite, addr);
+
+			// Record the access first, since the callback can happen inside addTransaction().
+			in_flight[mem->next_transaction_id] = make_pair(mem->currentClockCycle, issued >= warmup);
+			outstanding++;
+			mem->addTransaction(isWrite, addr);
+			issued++;
+
+			next_arrival += next_interarrival(mean_interarrival);
+		}
+
+		mem->update();
+
+		if (outstanding > max_outstanding)
+		{
+			overloaded = true;
+			break;
+		}
+	}
+
+	uint64_t window_cycles = mem->currentClockCycle - window_start;
+	uint64_t window_completions = completed_in_window;
+	injecting = false;
+
+	// Let the measured accesses finish (not worth it once the queues have blown up).
+	if (!overloaded)
+	{
+		while (outstanding > 0)
+			mem->update();
+	}
+
+	double achieved = (window_cycles > 0) ? window_completions / ((double) window_cycles / CYCLES_PER_SECOND) / 1000000.0 : 0.0;
+	bool saturated = overloaded || (achieved < saturation_threshold * rate);
+
+	sort(latencies.begin(), latencies.end());
+	double mean = 0;
+	for (size_t i = 0; i < latencies.size(); i++)
+		mean += latencies[i];
+	mean = latencies.empty() ? 0.0 : mean / latencies.size();
+
+	uint64_t percentiles[4] = {0, 0, 0, 0};
+	double fractions[4] = {0.5, 0.95, 0.99, 0.999};
+	for (int i = 0; i < 4; i++)
+	{
+		if (!latencies.empty())
+			percentiles[i] = latencies[min((size_t)(fractions[i] * latencies.size()), latencies.size() - 1)];
+	}
+	uint64_t max_latency = latencies.empty() ? 0 : latencies.back();
+
+	double ns_per_cycle = 1000000000.0 / CYCLES_PER_SECOND;
+	double bytes_per_access = BURST_SIZE;
+
+	cout << fixed << setprecision(3) << setw(14) << rate << setw(14) << rate * bytes_per_access / 1000.0 
+		<< setw(14) << achieved << setw(14) << achieved * bytes_per_access / 1000.0
+		<< setprecision(1) << setw(14) << mean * ns_per_cycle << setw(14) << percentiles[0] * ns_per_cycle 
+		<< setw(14) << percentiles[1] * ns_per_cycle << setw(14) << percentiles[2] * ns_per_cycle 
+		<< setw(14) << percentiles[3] * ns_per_cycle << "  " << (saturated ? (overloaded ? "OVERLOADED" : "SATURATED") : "") << "\n";
+	cout.unsetf(ios_base::floatfield);
+	cout << setprecision(6);
+
+	log << rate << " " << rate * bytes_per_access / 1000.0 << " " << achieved << " " << achieved * bytes_per_access / 1000.0 << " " 
+		<< mean << " " << percentiles[0] << " " << percentiles[1] << " " << percentiles[2] << " " << percentiles[3] << " " 
+		<< max_latency << " " << latencies.size() << " " << saturated << "\n";
+	log.flush();
+
+	delete mem;
+	delete read_cb;
+	delete write_cb;
+	if (gen != NULL)
+	{
+		delete gen;
+		gen = NULL;
+	}
+
+	return saturated;
+}
+
+void OpenLoopDriver::run(string tracefile)
+{
+	this->tracefile = tracefile;
+	if ((source != "trace") && (!TrafficGenerator::is_pattern(source)))
+	{
+		cout << "ERROR: Unknown open loop source " << source << " (use trace or one of " << TrafficGenerator::pattern_names() << ")\n";
+		abort();
+	}
+	if ((start_rate <= 0) || (rate_factor <= 1.0))
+	{
+		cout << "ERROR: The open loop sweep needs a positive start rate and a rate factor above 1.\n";
+		abort();
+	}
+
+	ofstream log;
+	log.open("open_loop.log", ios_base::out | ios_base::trunc);
+	if (!log.is_open())
+	{
+		cout << "ERROR: Failed to open open_loop.log\n";
+		abort();
+	}
+	log << "# source=" << source << " arrivals=" << (poisson ? "poisson" : "constant") << " accesses=" << accesses 
+		<< " warmup_fraction=" << warmup_fraction << " write_fraction=" << write_fraction << "\n";
+	log << "# offered_per_us offered_GBps achieved_per_us achieved_GBps mean_latency p50 p95 p99 p999 max_latency measured saturated"
+		<< " (latencies in cycles)\n";
+
+	cout << "Open loop sweep: source=" << source << " arrivals=" << (poisson ? "poisson" : "constant") << " accesses per rate=" 
+		<< accesses << "\n";
+	cout << setw(14) << "offered/us" << setw(14) << "offered GB/s" << setw(14) << "achieved/us" << setw(14) << "achieved GB/s" 
+		<< setw(14) << "mean ns" << setw(14) << "p50 ns" << setw(14) << "p95 ns" << setw(14) << "p99 ns" << setw(14) << "p99.9 ns" << "\n";
+
+	double last_good = 0;
+	double rate = rates.empty() ? start_rate : rates[0];
+	for (uint64_t point = 0; rates.empty() ? (point < max_points) : (point < rates.size()); point++)
+	{
+		if (!rates.empty())
+			rate = rates[point];
+
+		if (run_rate(rate, log))
+		{
+			// Past saturation the queues grow without bound, so there is nothing more to learn.
+			cout << "Saturated at " << rate << " accesses/us. Stopping the sweep.\n";
+			break;
+		}
+		last_good = rate;
+		rate *= rate_factor;
+	}
+
+	if (last_good > 0)
+		cout << "Highest unsaturated offered rate: " << last_good << " accesses/us (" << last_good * BURST_SIZE / 1000.0 << " GB/s)\n";
+	else
+		cout << "Saturated at the first offered rate. Try lower rates.\n";
+
+	log.close();
+}
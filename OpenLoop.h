@@ -0,0 +1,100 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_OPENLOOP_H
+#define HYBRIDSIM_OPENLOOP_H
+
+#include <random>
+
+#include "HybridSystem.h"
+#include "TrafficGenerator.h"
+
+// OpenLoopDriver measures latency against bandwidth for a HybridSim configuration.
+//
+// Unlike the trace based simulator (which replays trace timestamps and throttles at MAX_PENDING), accesses
+// arrive at a fixed offered rate no matter how many are outstanding, so queueing delay shows up in the
+// latency and the saturation point is visible. Each offered rate is run on a new HybridSystem:
+//   - accesses arrive with Poisson (exponential inter-arrival times) or constant spacing
+//   - addresses come from a TrafficGenerator pattern or from the trace file (trace timestamps are ignored)
+//   - the first warmup_fraction of the accesses are not measured
+//   - achieved bandwidth is the completions per second while accesses are still arriving
+//
+// The sweep either runs a list of rates or starts at start_rate and multiplies by rate_factor until the
+// configuration saturates (achieved bandwidth below saturation_threshold of the offered bandwidth, or
+// more than max_outstanding accesses in flight).
+//
+// Results go to stdout and to open_loop.log (one line per rate).
+
+class OpenLoopDriver
+{
+	public:
+	OpenLoopDriver();
+
+	void read_complete(uint64_t id, uint64_t address, uint64_t cycle);
+	void write_complete(uint64_t id, uint64_t address, uint64_t cycle);
+
+	void run(string tracefile);
+	bool run_rate(double rate, ofstream &log);
+
+	void next_access(bool &isWrite, uint64_t &addr);
+	double next_interarrival(double mean);
+
+	// Settings
+	string ini; // HybridSim ini file ("" for the default).
+	string source; // TrafficGenerator pattern or "trace"
+	bool poisson;
+	vector<double> rates; // Offered rates in accesses per microsecond (empty means sweep).
+	double start_rate;
+	double rate_factor;
+	uint64_t max_points;
+	uint64_t accesses; // Accesses per rate.
+	double warmup_fraction;
+	double write_fraction;
+	uint64_t footprint;
+	uint64_t max_outstanding;
+	double saturation_threshold;
+	uint64_t seed;
+
+	// State for the current rate.
+	string tracefile;
+	ifstream trace;
+	HybridSim::TrafficGenerator *gen;
+	std::mt19937_64 rng;
+	unordered_map<uint64_t, pair<uint64_t, bool> > in_flight; // transaction id -> (issue cycle, measured)
+	uint64_t outstanding;
+	uint64_t completed;
+	uint64_t completed_in_window;
+	bool injecting;
+	vector<uint64_t> latencies; // Cycles, for the measured accesses.
+
+	void complete(uint64_t id, uint64_t cycle);
+};
+
+#endif
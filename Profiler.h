@@ -0,0 +1,249 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_PROFILER_H
+#define HYBRIDSIM_PROFILER_H
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Host time profiling of HybridSystem. Build with "make PROFILE=1" to turn it on. Otherwise the PROFILE
+// macros expand to nothing and none of this is compiled into the simulator.
+//
+// PROFILE(stage) times the rest of the enclosing scope and adds it to the stage. PROFILE_START(timer, stage)
+// and PROFILE_STOP(timer) time part of a scope. Stages nest (e.g. the DRAM callbacks run inside the DRAM
+// update and ProcessTransaction runs inside update), so the time of a stage includes the time of the
+// stages inside it.
+//
+// Reading the clock costs about as much as a whole stage of update(), so only one cycle out of every
+// PROFILE_SAMPLE_PERIOD (on average) is timed. PROFILE_CYCLE() picks the cycles, and the time of each
+// stage is scaled up by how many of its calls were timed. The call counts are exact. The time stamps
+// come from rdtsc on x86 (converted to nanoseconds with steady_clock over the whole run) and from
+// steady_clock elsewhere. Most stages only take tens of nanoseconds, so the cost of the timers
+// themselves (measured when the Profiler is created) is taken back out of each timed call, including
+// the cost of any timers nested inside it.
+
+#ifndef PROFILE_SAMPLE_PERIOD
+#define PROFILE_SAMPLE_PERIOD 16
+#endif
+
+namespace HybridSim
+{
+	enum ProfileStage
+	{
+		PROFILE_UPDATE, // All of update()
+		PROFILE_LOGGER, // Logger bookkeeping in update()
+		PROFILE_TRANS_QUEUE, // Scanning the trans_queue for a transaction to start
+		PROFILE_PROCESS_TRANSACTION, // ProcessTransaction()
+		PROFILE_ISSUE, // Moving the dram_queue and flash_queue heads to the backends
+		PROFILE_DRAM_UPDATE, // dram->update()
+		PROFILE_FLASH_UPDATE, // flash->update() (or the flash thread handoff)
+		PROFILE_DRAM_CALLBACK, // DRAM read and write callbacks
+		PROFILE_FLASH_CALLBACK, // Flash read, critical line and write callbacks
+		PROFILE_ADD_TRANSACTION, // addTransaction()
+		NUM_PROFILE_STAGES
+	};
+
+	inline uint64_t profile_ticks()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	class Profiler
+	{
+		public:
+		uint64_t ticks[NUM_PROFILE_STAGES]; // Time spent in the timed calls of each stage.
+		uint64_t calls[NUM_PROFILE_STAGES];
+		uint64_t timed_calls[NUM_PROFILE_STAGES];
+		uint64_t cycles;
+		bool timing; // Time the current cycle.
+		uint64_t random;
+
+		uint64_t timers; // Timed calls started so far (used to find the timers nested inside a timer).
+		uint64_t timer_overhead; // Ticks an empty timer measures.
+		uint64_t nested_overhead; // Ticks an empty timer adds to the timer around it.
+
+		// Used to convert ticks to nanoseconds and for the wall clock throughput.
+		std::chrono::steady_clock::time_point start_time;
+		uint64_t start_ticks;
+
+		Profiler();
+		void reset();
+
+		// Called at the start of each update(). The timed cycles are picked at random so that work that happens
+		// on a regular period (e.g. a backend on a slower clock) is not always or never timed.
+		void next_cycle()
+		{
+			random = random * 6364136223846793005ULL + 1442695040888963407ULL;
+			timing = ((random >> 33) % PROFILE_SAMPLE_PERIOD == 0);
+			cycles++;
+		}
+
+		static const char *stage_name(int stage)
+		{
+			static const char *names[NUM_PROFILE_STAGES] = {"update", "logger", "trans_queue scan", "ProcessTransaction",
+				"queue issue", "dram update", "flash update", "dram callbacks", "flash callbacks", "addTransaction"};
+			return names[stage];
+		}
+
+		// Each call of update() is one simulated cycle and each call of addTransaction() is one transaction.
+		void print(std::ostream &out)
+		{
+			double wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+			double elapsed_ticks = profile_ticks() - start_ticks;
+			double ns_per_tick = (elapsed_ticks > 0) ? wall_ns / elapsed_ticks : 1.0;
+
+			// Estimated nanoseconds for all of the calls of each stage.
+			double ns[NUM_PROFILE_STAGES];
+			for (int i = 0; i < NUM_PROFILE_STAGES; i++)
+				ns[i] = timed_calls[i] ? ticks[i] * ns_per_tick * ((double)calls[i] / timed_calls[i]) : 0.0;
+
+			uint64_t transactions = calls[PROFILE_ADD_TRANSACTION];
+			out << "\nHost time profile (" << cycles << " cycles, " << transactions << " transactions, 1 in " 
+				<< PROFILE_SAMPLE_PERIOD << " cycles timed)\n";
+			out << std::left << std::setw(20) << "stage" << std::right << std::setw(14) << "calls" << std::setw(14) << "total ms" 
+				<< std::setw(12) << "ns/call" << std::setw(12) << "ns/cycle" << std::setw(12) << "ns/trans" << std::setw(10) << "% update" << "\n";
+			for (int i = 0; i < NUM_PROFILE_STAGES; i++)
+			{
+				out << std::left << std::setw(20) << stage_name(i) << std::right << std::fixed << std::setprecision(1)
+					<< std::setw(14) << calls[i] 
+					<< std::setw(14) << ns[i] / 1e6 
+					<< std::setw(12) << (calls[i] ? ns[i] / calls[i] : 0.0)
+					<< std::setw(12) << (cycles ? ns[i] / cycles : 0.0)
+					<< std::setw(12) << (transactions ? ns[i] / transactions : 0.0)
+					<< std::setw(10) << (ns[PROFILE_UPDATE] ? 100.0 * ns[i] / ns[PROFILE_UPDATE] : 0.0) << "\n";
+			}
+			out.unsetf(std::ios_base::floatfield);
+			out << std::setprecision(6);
+			out << "Simulated cycles per second (in update): " << (ns[PROFILE_UPDATE] ? cycles / (ns[PROFILE_UPDATE] / 1e9) : 0.0) << "\n";
+			out << "Simulated cycles per second (wall clock): " << (wall_ns ? cycles / (wall_ns / 1e9) : 0.0) << "\n\n";
+		}
+	};
+
+	// Adds the time from its construction to its destruction (or stop()) to one stage.
+	class ProfileTimer
+	{
+		public:
+		Profiler &profiler;
+		ProfileStage stage;
+		bool running;
+		uint64_t start_timers;
+		uint64_t start;
+
+		ProfileTimer(Profiler &p, ProfileStage s) : profiler(p), stage(s), running(p.timing), start_timers(0), start(0)
+		{
+			profiler.calls[stage]++;
+			if (running)
+			{
+				start_timers = ++profiler.timers;
+				start = profile_ticks();
+			}
+		}
+
+		~ProfileTimer()
+		{
+			stop();
+		}
+
+		void stop()
+		{
+			if (!running)
+				return;
+			uint64_t elapsed = profile_ticks() - start;
+			uint64_t overhead = profiler.timer_overhead + (profiler.timers - start_timers) * profiler.nested_overhead;
+			profiler.ticks[stage] += (elapsed > overhead) ? elapsed - overhead : 0;
+			profiler.timed_calls[stage]++;
+			running = false;
+		}
+	};
+
+	inline Profiler::Profiler()
+	{
+		timer_overhead = 0;
+		nested_overhead = 0;
+		reset();
+
+		// Measure the cost of the timers.
+		const uint64_t n = 10000;
+		uint64_t begin = profile_ticks();
+		for (uint64_t i = 0; i < n; i++)
+		{
+			ProfileTimer t(*this, PROFILE_UPDATE);
+		}
+		uint64_t nested = (profile_ticks() - begin) / n;
+		uint64_t timer = ticks[PROFILE_UPDATE] / n;
+
+		reset();
+		nested_overhead = nested;
+		timer_overhead = timer;
+	}
+
+	inline void Profiler::reset()
+	{
+		for (int i = 0; i < NUM_PROFILE_STAGES; i++)
+		{
+			ticks[i] = 0;
+			calls[i] = 0;
+			timed_calls[i] = 0;
+		}
+		cycles = 0;
+		timing = true;
+		random = 1;
+		timers = 0;
+		start_time = std::chrono::steady_clock::now();
+		start_ticks = profile_ticks();
+	}
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef HYBRIDSIM_PROFILE
+#define PROFILE_CYCLE() profiler.next_cycle()
+#define PROFILE(stage) HybridSim::ProfileTimer PROFILE_CONCAT(profile_timer_, __LINE__)(profiler, stage)
+#define PROFILE_START(timer, stage) HybridSim::ProfileTimer timer(profiler, stage)
+#define PROFILE_STOP(timer) timer.stop()
+#else
+#define PROFILE_CYCLE()
+#define PROFILE(stage)
+#define PROFILE_START(timer, stage)
+#define PROFILE_STOP(timer)
+#endif
+
+#endif
@@ -31,18 +31,27 @@
 
 
 
+#include <cmath>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
 #include "TraceBasedSim.h"
+#include "OpenLoop.h"
+#include "Checkpoint.h"
+#include "LatencyHistogram.h"
 
 using namespace HybridSim;
 using namespace std;
 
-const uint64_t MAX_PENDING = 36;
-const uint64_t MIN_PENDING = 35;
 uint64_t complete = 0;
 uint64_t pending = 0;
 uint64_t throttle_count = 0;
 uint64_t throttle_cycles = 0;
 uint64_t final_cycles = 0;
+uint64_t functional_cycles = 0; // Trace cycles skipped over (in functional mode or before the first chunk).
+uint64_t trace_accesses = 0; // Accesses read from the trace.
+uint64_t drain_cycles = 0; // Cycles spent finishing the detailed accesses at the end of each sample.
 
 // The cycle counter is used to keep track of what cycle we are on.
 uint64_t trace_cycles = 0;
@@ -51,10 +60,98 @@ uint64_t last_clock = 0;
 uint64_t CLOCK_DELAY = 1000000;
 
 
+void usage(char *name)
+{
+	cout << "Usage: " << name << " [tracefile] [options]\n";
+	cout << "       " << name << " --merge-histograms OUT FILE1 FILE2 ...\n";
+	cout << "                        Merge the hybridsim_latency.hist files of several runs (e.g. one per --chunks\n";
+	cout << "                        range) into OUT and print the merged percentiles.\n";
+	cout << "  --build-index N       Split the trace into chunks of N accesses, write tracefile.idx and exit.\n";
+	cout << "  --chunks FIRST LAST   Only simulate chunks FIRST to LAST (needs tracefile.idx).\n";
+	cout << "  --warmup W            Warm up with the W chunks before FIRST in functional mode (default 0).\n";
+	cout << "  --fork CYCLE          Run to CYCLE, then fork one child per --variant. Each child continues the trace\n";
+	cout << "                        in its own directory (fork_0, fork_1, ...).\n";
+	cout << "  --variant \"OVERRIDES\" Space separated KEY=VALUE ini overrides for one child (e.g. CONTROLLER_DELAY=4).\n";
+	cout << "                        MMIO=op,address calls mmio(op, address) in the child.\n";
+	cout << "  --checkpoint CYCLE F  Save a checkpoint of the whole simulation to F at CYCLE.\n";
+	cout << "  --checkpoint-exit     Stop after saving the checkpoint.\n";
+	cout << "  --resume F            Resume from checkpoint F (same trace and ini file). The results are the same as\n";
+	cout << "                        a run that was never stopped.\n";
+	cout << "  --open-loop SOURCE    Open loop latency/bandwidth sweep instead of a trace replay. SOURCE is trace (the\n";
+	cout << "                        trace addresses, no timestamps) or " << TrafficGenerator::pattern_names() << ".\n";
+	cout << "                        Results go to open_loop.log.\n";
+	cout << "  --rates R1,R2,...     Offered rates to run in accesses per microsecond (default: sweep).\n";
+	cout << "  --rate-start R        First rate of the sweep (default 0.1).\n";
+	cout << "  --rate-factor F       Multiply the rate by F until saturation (default 1.5).\n";
+	cout << "  --arrivals A          poisson or constant inter-arrival times (default poisson).\n";
+	cout << "  --accesses N          Accesses per rate (default 20000, the first 10% are not measured).\n";
+	cout << "  --write-fraction W    Fraction of generated accesses that are writes (default 0.3).\n";
+	cout << "  --footprint BYTES     Generated address range (default TOTAL_PAGES pages).\n";
+	exit(1);
+}
+
+int merge_histograms(string outfile, vector<string> files)
+{
+	// Histograms with the same name are added together, in the order they first appear.
+	vector<string> names;
+	map<string, LatencyHistogram> merged;
+	for (size_t f = 0; f < files.size(); f++)
+	{
+		ifstream in(files[f].c_str());
+		if (!in.is_open())
+		{
+			cerr << "ERROR: Could not open latency histogram file " << files[f] << "\n";
+			abort();
+		}
+
+		LatencyHistogram h;
+		string name;
+		while (h.read(in, name))
+		{
+			if (merged.count(name) == 0)
+			{
+				names.push_back(name);
+				merged[name] = LatencyHistogram(h.precision);
+			}
+			merged[name].merge(h);
+		}
+	}
+
+	ofstream out(outfile.c_str(), ios_base::out | ios_base::trunc);
+	if (!out.is_open())
+	{
+		cerr << "ERROR: Could not open " << outfile << "\n";
+		abort();
+	}
+	for (size_t i = 0; i < names.size(); i++)
+		merged[names[i]].write(out, names[i]);
+	out.close();
+
+	cout << "Merged " << files.size() << " files into " << outfile << " (latencies in cycles)\n\n";
+	LatencyHistogram::print_percentile_header(cout);
+	for (size_t i = 0; i < names.size(); i++)
+		merged[names[i]].print_percentiles(cout, names[i]);
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
+	if ((argc > 3) && (string(argv[1]) == "--merge-histograms"))
+		return merge_histograms(argv[2], vector<string>(argv + 3, argv + argc));
+
 	printf("hybridsim_test main()\n");
 	HybridSimTBS obj;
+	obj.use_chunks = false;
+	obj.first_chunk = 0;
+	obj.last_chunk = 0;
+	obj.warmup_chunks = 0;
+	obj.use_fork = false;
+	obj.fork_cycle = 0;
+	obj.use_checkpoint = false;
+	obj.checkpoint_cycle = 0;
+	obj.checkpoint_exit = false;
+	bool use_open_loop = false;
+	OpenLoopDriver open_loop;
 
 	string tracefile = "traces/test.txt";
 	if (argc > 1)
@@ -67,6 +164,121 @@ int main(int argc, char *argv[])
 		cout << "Using default trace file (traces/test.txt)\n";
 	}
 
+	for (int i = 2; i < argc; i++)
+	{
+		string arg = argv[i];
+		if ((arg == "--build-index") && (i + 1 < argc))
+		{
+			uint64_t accesses_per_chunk;
+			convert_uint64_t(accesses_per_chunk, argv[++i], "--build-index");
+
+			TraceIndex index;
+			index.build(tracefile, accesses_per_chunk);
+			index.write(tracefile);
+			cout << "Wrote " << index.chunks.size() << " chunks to " << TraceIndex::index_name(tracefile) << "\n";
+			return 0;
+		}
+		else if ((arg == "--chunks") && (i + 2 < argc))
+		{
+			obj.use_chunks = true;
+			convert_uint64_t(obj.first_chunk, argv[++i], "--chunks");
+			convert_uint64_t(obj.last_chunk, argv[++i], "--chunks");
+		}
+		else if ((arg == "--warmup") && (i + 1 < argc))
+		{
+			convert_uint64_t(obj.warmup_chunks, argv[++i], "--warmup");
+		}
+		else if ((arg == "--fork") && (i + 1 < argc))
+		{
+			obj.use_fork = true;
+			convert_uint64_t(obj.fork_cycle, argv[++i], "--fork");
+		}
+		else if ((arg == "--variant") && (i + 1 < argc))
+		{
+			obj.variants.push_back(argv[++i]);
+		}
+		else if ((arg == "--checkpoint") && (i + 2 < argc))
+		{
+			obj.use_checkpoint = true;
+			convert_uint64_t(obj.checkpoint_cycle, argv[++i], "--checkpoint");
+			obj.checkpoint_file = argv[++i];
+		}
+		else if (arg == "--checkpoint-exit")
+		{
+			obj.checkpoint_exit = true;
+		}
+		else if ((arg == "--resume") && (i + 1 < argc))
+		{
+			obj.resume_file = argv[++i];
+		}
+		else if ((arg == "--open-loop") && (i + 1 < argc))
+		{
+			use_open_loop = true;
+			open_loop.source = argv[++i];
+		}
+		else if ((arg == "--rates") && (i + 1 < argc))
+		{
+			stringstream rates(argv[++i]);
+			string rate;
+			while (getline(rates, rate, ','))
+				open_loop.rates.push_back(atof(rate.c_str()));
+		}
+		else if ((arg == "--rate-start") && (i + 1 < argc))
+		{
+			open_loop.start_rate = atof(argv[++i]);
+		}
+		else if ((arg == "--rate-factor") && (i + 1 < argc))
+		{
+			open_loop.rate_factor = atof(argv[++i]);
+		}
+		else if ((arg == "--arrivals") && (i + 1 < argc))
+		{
+			string arrivals = argv[++i];
+			if ((arrivals != "poisson") && (arrivals != "constant"))
+				usage(argv[0]);
+			open_loop.poisson = (arrivals == "poisson");
+		}
+		else if ((arg == "--accesses") && (i + 1 < argc))
+		{
+			convert_uint64_t(open_loop.accesses, argv[++i], "--accesses");
+		}
+		else if ((arg == "--write-fraction") && (i + 1 < argc))
+		{
+			open_loop.write_fraction = atof(argv[++i]);
+		}
+		else if ((arg == "--footprint") && (i + 1 < argc))
+		{
+			convert_uint64_t(open_loop.footprint, argv[++i], "--footprint");
+		}
+		else
+		{
+			usage(argv[0]);
+		}
+	}
+
+	if (use_open_loop)
+	{
+		if (obj.use_chunks || obj.use_fork || obj.use_checkpoint || !obj.resume_file.empty())
+		{
+			cout << "ERROR: --open-loop does not work with --chunks, --fork, --checkpoint or --resume.\n";
+			abort();
+		}
+		open_loop.run(tracefile);
+		return 0;
+	}
+
+	if (obj.use_fork && obj.variants.empty())
+	{
+		cout << "ERROR: --fork needs at least one --variant.\n";
+		abort();
+	}
+
+	if ((obj.use_checkpoint || !obj.resume_file.empty()) && (obj.use_chunks || obj.use_fork))
+	{
+		cout << "ERROR: --checkpoint and --resume do not work with --chunks or --fork.\n";
+		abort();
+	}
+
 	obj.run_trace(tracefile);
 }
 
@@ -85,34 +297,622 @@ void transaction_complete(uint64_t clock_cycle)
 	//	abort();
 }
 
-void HybridSimTBS::read_complete(uint id, uint64_t address, uint64_t clock_cycle)
+void HybridSimTBS::read_complete(uint64_t id, uint64_t address, uint64_t clock_cycle)
 {
-	//printf("[Callback] read complete: %d 0x%lx cycle=%lu\n", id, address, clock_cycle);
+	//printf("[Callback] read complete: %lu 0x%lx cycle=%lu\n", id, address, clock_cycle);
 	//complete++;
 	//pending--;
 
+	core_complete(id);
 	transaction_complete(clock_cycle);
 }
 
-void HybridSimTBS::write_complete(uint id, uint64_t address, uint64_t clock_cycle)
+void HybridSimTBS::write_complete(uint64_t id, uint64_t address, uint64_t clock_cycle)
 {
-	//printf("[Callback] write complete: %d 0x%lx cycle=%lu\n", id, address, clock_cycle);
+	//printf("[Callback] write complete: %lu 0x%lx cycle=%lu\n", id, address, clock_cycle);
 	//complete++;
 	//pending--;
 
+	core_complete(id);
 	transaction_complete(clock_cycle);
 }
 
+uint64_t TraceCore::issue_cycle(uint64_t trace_cycle)
+{
+	if (trace_cycle <= start_trace_cycle)
+		return start_cycle + stall_cycles;
+	if (ipc_scale == 1.0)
+		return start_cycle + stall_cycles + (trace_cycle - start_trace_cycle);
+	return start_cycle + stall_cycles + (uint64_t)((trace_cycle - start_trace_cycle) / ipc_scale);
+}
+
+bool TraceCore::stalled()
+{
+	return (outstanding >= CORE_MLP) || waiting;
+}
+
+void HybridSimTBS::read_ahead(ifstream &inFile, bool use_limit, uint64_t limit)
+{
+	char char_line[256];
+	while (true)
+	{
+		if (!has_next_line)
+		{
+			if (trace_done)
+				return;
+			if ((use_limit) && (trace_accesses >= limit))
+			{
+				trace_done = true;
+				return;
+			}
+
+			// Read the next line.
+			string line;
+			if (!replay_lines.empty())
+			{
+				line = replay_lines.front();
+				replay_lines.pop_front();
+			}
+			else if (inFile.good())
+			{
+				inFile.getline(char_line, 256);
+				line = (string)char_line;
+			}
+			else
+			{
+				trace_done = true;
+				return;
+			}
+
+			// Parse the line (skips comments and blank lines).
+			if (!parse_trace_line(line, next_line.trans_cycle, next_line.write, next_line.addr, next_line.core))
+				continue;
+			trace_accesses++;
+
+			if (next_line.core >= cores.size())
+			{
+				cout << "ERROR: Trace access for core " << next_line.core << " but CORES=" << CORES << "\n";
+				abort();
+			}
+			next_line.seq = next_seq++;
+			next_line.text = line;
+			has_next_line = true;
+		}
+
+		// Stop reading when the line's core has a full lookahead.
+		TraceCore &c = cores[next_line.core];
+		if (c.lines.size() >= CORE_LOOKAHEAD)
+			return;
+		c.lines.push_back(next_line);
+		has_next_line = false;
+	}
+}
+
+int64_t HybridSimTBS::next_core(uint64_t cycle)
+{
+	// The oldest line that is due on a core that is not stalled.
+	int64_t next = -1;
+	for (uint64_t i = 0; i < cores.size(); i++)
+	{
+		if (cores[i].lines.empty() || cores[i].stalled())
+			continue;
+		TraceLine &t = cores[i].lines.front();
+		if (cores[i].issue_cycle(t.trans_cycle) > cycle)
+			continue;
+		if ((next < 0) || (t.seq < cores[next].lines.front().seq))
+			next = i;
+	}
+	return next;
+}
+
+uint64_t HybridSimTBS::next_issue_cycle()
+{
+	// The first cycle one of the cores that is not stalled can issue on ((uint64_t)-1 if there is none).
+	uint64_t next = (uint64_t)-1;
+	for (uint64_t i = 0; i < cores.size(); i++)
+	{
+		if (cores[i].lines.empty() || cores[i].stalled())
+			continue;
+		uint64_t c = cores[i].issue_cycle(cores[i].lines.front().trans_cycle);
+		if (c < next)
+			next = c;
+	}
+	return next;
+}
+
+bool HybridSimTBS::oldest_line_stalled()
+{
+	// The oldest line is always at the front of one of the cores' lines.
+	int64_t oldest = -1;
+	for (uint64_t i = 0; i < cores.size(); i++)
+	{
+		if ((!cores[i].lines.empty()) && ((oldest < 0) || (cores[i].lines.front().seq < cores[oldest].lines.front().seq)))
+			oldest = i;
+	}
+	return (oldest >= 0) && cores[oldest].stalled();
+}
+
+bool HybridSimTBS::lines_left()
+{
+	if (has_next_line || !trace_done)
+		return true;
+	for (uint64_t i = 0; i < cores.size(); i++)
+	{
+		if (!cores[i].lines.empty())
+			return true;
+	}
+	return false;
+}
+
+void HybridSimTBS::init_cores(uint64_t start_trace_cycle)
+{
+	if ((CORES == 0) || (CORE_MLP == 0) || (CORE_LOOKAHEAD == 0))
+	{
+		cout << "ERROR: CORES, CORE_MLP and CORE_LOOKAHEAD must be at least 1.\n";
+		abort();
+	}
+
+	// CORE_IPC_SCALE has one value per core. The last value is used for the rest of the cores.
+	list<string> scales = split(CORE_IPC_SCALE, ",");
+	double scale = 1.0;
+	cores.assign(CORES, TraceCore());
+	for (uint64_t i = 0; i < CORES; i++)
+	{
+		if (!scales.empty())
+		{
+			scale = atof(scales.front().c_str());
+			scales.pop_front();
+		}
+		if (scale <= 0)
+		{
+			cout << "ERROR: Bad CORE_IPC_SCALE (the values must be positive): " << CORE_IPC_SCALE << "\n";
+			abort();
+		}
+
+		cores[i].ipc_scale = scale;
+		cores[i].start_trace_cycle = start_trace_cycle;
+		cores[i].start_cycle = start_trace_cycle;
+	}
+}
+
+void HybridSimTBS::core_issue(uint64_t core, bool isWrite, uint64_t id)
+{
+	// Every CORE_DEPENDENT_READS-th read is dependent. The core waits for it before issuing anything else.
+	bool dependent = false;
+	if ((!isWrite) && (CORE_DEPENDENT_READS > 0))
+	{
+		cores[core].reads++;
+		dependent = (cores[core].reads % CORE_DEPENDENT_READS == 0);
+	}
+
+	cores[core].outstanding++;
+	cores[core].accesses++;
+	if (dependent)
+		cores[core].waiting = true;
+	core_in_flight[id] = make_pair(core, (uint64_t) dependent);
+}
+
+void HybridSimTBS::core_complete(uint64_t id)
+{
+	unordered_map<uint64_t, pair<uint64_t, uint64_t> >::iterator it = core_in_flight.find(id);
+	if (it == core_in_flight.end())
+	{
+		cout << "ERROR: Completion for a transaction that was not issued by a core: " << id << "\n";
+		abort();
+	}
+
+	pair<uint64_t, uint64_t> issue = (*it).second;
+	core_in_flight.erase(it);
+
+	cores[issue.first].outstanding--;
+	if (issue.second)
+		cores[issue.first].waiting = false;
+}
+
+void HybridSimTBS::print_cores()
+{
+	cout << "Core model: CORES=" << CORES << " CORE_MLP=" << CORE_MLP << " CORE_DEPENDENT_READS=" << CORE_DEPENDENT_READS 
+		<< " CORE_LOOKAHEAD=" << CORE_LOOKAHEAD << " CORE_IPC_SCALE=" << CORE_IPC_SCALE << "\n";
+	for (uint64_t i = 0; i < cores.size(); i++)
+	{
+		cout << "core " << i << ": ipc_scale=" << cores[i].ipc_scale << " accesses=" << cores[i].accesses 
+			<< " window_stalls=" << cores[i].window_stalls << " dependent_stalls=" << cores[i].dependent_stalls 
+			<< " stall_cycles=" << cores[i].stall_cycles << "\n";
+	}
+	cout << "\n";
+}
+
+void HybridSimTBS::sample_start(HybridSystem *mem)
+{
+	// Snapshot the logger counters. Accesses are counted by the logger when they complete, so a few
+	// of the detailed warmup accesses may complete (and be counted) after this point.
+	sample_accesses = mem->log.num_accesses;
+	sample_misses = mem->log.num_misses;
+	sample_latency = mem->log.sum_latency;
+	sample_reads = mem->log.num_reads;
+	sample_read_latency = mem->log.sum_read_latency;
+	sample_cycle = mem->currentClockCycle;
+}
+
+void HybridSimTBS::sample_finish(HybridSystem *mem)
+{
+	uint64_t accesses = mem->log.num_accesses - sample_accesses;
+	uint64_t misses = mem->log.num_misses - sample_misses;
+	uint64_t latency = mem->log.sum_latency - sample_latency;
+	uint64_t reads = mem->log.num_reads - sample_reads;
+	uint64_t read_latency = mem->log.sum_read_latency - sample_read_latency;
+
+	if (accesses == 0)
+		return;
+
+	double miss_rate = (double) misses / accesses;
+	double avg_latency = (double) latency / accesses;
+	double avg_read_latency = (reads == 0) ? 0.0 : (double) read_latency / reads;
+
+	sample_miss_rate.push_back(miss_rate);
+	sample_avg_latency.push_back(avg_latency);
+	if (reads > 0)
+		sample_avg_read_latency.push_back(avg_read_latency);
+
+	sampling_log << sample_miss_rate.size() - 1 << " " << sample_cycle << " " << accesses << " " << misses << " " 
+		<< miss_rate << " " << avg_latency << " " << avg_read_latency << "\n";
+}
+
+// Two sided 95% quantile of Student's t distribution with df degrees of freedom.
+double t_quantile_95(uint64_t df)
+{
+	static const double table[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+		2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+	if (df == 0)
+		return 0.0;
+	if (df <= 30)
+		return table[df - 1];
+
+	// Cornish-Fisher expansion around the normal quantile (within 0.001 of the exact value past 30).
+	double z = 1.96;
+	double d = df;
+	return z + (z*z*z + z) / (4 * d) + (5*z*z*z*z*z + 16*z*z*z + 3*z) / (96 * d * d);
+}
+
+void HybridSimTBS::print_sample_estimate(ostream &out, string name, vector<double> &values)
+{
+	// Mean of the per sample values with a 95% confidence interval. The interval uses Student's t
+	// distribution, so it is also right for the small number of samples of a short run. Also report
+	// how many samples would be needed to get the interval within +/-3% of the mean, like SMARTS
+	// does (this uses the normal quantile, since that many samples is normally well past 30).
+	double n = values.size();
+	if (n == 0)
+	{
+		out << name << ": no samples\n";
+		return;
+	}
+
+	double sum = 0;
+	for (size_t i=0; i < values.size(); i++)
+		sum += values[i];
+	double mean = sum / n;
+
+	double sum_sq = 0;
+	for (size_t i=0; i < values.size(); i++)
+		sum_sq += (values[i] - mean) * (values[i] - mean);
+	double stddev = (n > 1) ? sqrt(sum_sq / (n - 1)) : 0.0;
+
+	double half_width = t_quantile_95(values.size() - 1) * stddev / sqrt(n);
+	double cv = (mean == 0) ? 0.0 : stddev / mean;
+	double needed = ceil((1.96 * cv / 0.03) * (1.96 * cv / 0.03));
+
+	out << name << ": " << mean << " +/- " << half_width << " (95% confidence, " 
+		<< ((mean == 0) ? 0.0 : 100.0 * half_width / mean) << "%), stddev=" << stddev 
+		<< " samples=" << values.size() << " samples_needed_for_3%=" << needed << "\n";
+}
+
+void HybridSimTBS::print_samples()
+{
+	cout << "Sampled simulation (SAMPLING_PERIOD=" << SAMPLING_PERIOD << " SAMPLING_WARMUP=" << SAMPLING_WARMUP
+		<< " SAMPLING_DETAILED=" << SAMPLING_DETAILED << ")\n";
+	print_sample_estimate(cout, "miss rate", sample_miss_rate);
+	print_sample_estimate(cout, "average latency (cycles)", sample_avg_latency);
+	print_sample_estimate(cout, "average read latency (cycles)", sample_avg_read_latency);
+	cout << "\n";
+
+	sampling_log << "\n";
+	print_sample_estimate(sampling_log, "miss rate", sample_miss_rate);
+	print_sample_estimate(sampling_log, "average latency (cycles)", sample_avg_latency);
+	print_sample_estimate(sampling_log, "average read latency (cycles)", sample_avg_read_latency);
+}
+
+void copy_file(string from, string to)
+{
+	ifstream in(from.c_str(), ifstream::in | ifstream::binary);
+	if (!in.is_open())
+		return;
+	ofstream out(to.c_str(), ios_base::out | ios_base::trunc | ios_base::binary);
+	out << in.rdbuf();
+}
+
+void HybridSimTBS::apply_variant(HybridSystem *mem, string overrides)
+{
+	list<string> items = split(overrides);
+	for (list<string>::iterator it = items.begin(); it != items.end(); it++)
+	{
+		// split() returns an empty token for an empty variant (--variant "" for a control run) or trailing spaces.
+		if ((*it).empty())
+			continue;
+
+		list<string> key_value = split((*it), "=", 2);
+		if (key_value.size() != 2)
+		{
+			cerr << "ERROR: Bad variant override (should be KEY=VALUE): " << (*it) << "\n";
+			abort();
+		}
+
+		string key = key_value.front();
+		string value = key_value.back();
+		if (key == "MMIO")
+		{
+			list<string> args = split(value, ",");
+			if (args.size() != 2)
+			{
+				cerr << "ERROR: MMIO override should be MMIO=operation,address: " << (*it) << "\n";
+				abort();
+			}
+			uint64_t operation, address;
+			convert_uint64_t(operation, args.front(), "MMIO operation");
+			convert_uint64_t(address, args.back(), "MMIO address");
+			mem->mmio(operation, address);
+		}
+		else
+		{
+			// Only settings that are read while the simulation runs (e.g. CONTROLLER_DELAY) have any effect here.
+			mem->iniReader.set(key, value);
+		}
+	}
+}
+
+void HybridSimTBS::fork_variants(HybridSystem *mem, ifstream &inFile, string tracefile)
+{
+	// Everything up to this point (the warmup) is shared. Each child gets a copy on write copy of the
+	// simulator, moves to its own directory, applies its overrides and continues the trace.
+	// The parent waits for all of the children and then exits.
+	if (mem->flash_thread != NULL)
+	{
+		cerr << "ERROR: --fork does not work with FLASH_THREAD (threads do not survive fork()).\n";
+		abort();
+	}
+
+	// The trace file descriptor is shared after fork(), so each child reopens the trace at this position.
+	streampos trace_position = inFile.tellg();
+
+	// Flush everything so the children do not write the parent's buffered output again.
+	cout.flush();
+	cerr.flush();
+	if (sampling_log.is_open())
+		sampling_log.flush();
+	mem->close_streams();
+
+	cout << "Forking " << variants.size() << " variants at cycle " << mem->currentClockCycle << "\n";
+	cout.flush();
+
+	vector<pid_t> children;
+	for (size_t i = 0; i < variants.size(); i++)
+	{
+		pid_t pid = fork();
+		if (pid < 0)
+		{
+			cerr << "ERROR: fork() failed\n";
+			abort();
+		}
+
+		if (pid == 0)
+		{
+			// Child: switch to fork_i and redirect the outputs there.
+			stringstream dir;
+			dir << "fork_" << i;
+			mkdir(dir.str().c_str(), 0755);
+			copy_file("hybridsim_epoch.log", dir.str() + "/hybridsim_epoch.log");
+			if (mem->log.binary_misses)
+				copy_file("hybridsim_misses.bin", dir.str() + "/hybridsim_misses.bin");
+			if (mem->log.epoch_stats_enabled)
+				copy_file(mem->log.epoch_stats_file, dir.str() + "/" + mem->log.epoch_stats_file);
+			if (mem->full_trace.enabled())
+				copy_file(mem->full_trace.filename, dir.str() + "/" + mem->full_trace.filename);
+			if (mem->nvdimm_trace.enabled())
+				copy_file(mem->nvdimm_trace.filename, dir.str() + "/" + mem->nvdimm_trace.filename);
+			bool sampling = sampling_log.is_open();
+			if (sampling)
+			{
+				sampling_log.close();
+				copy_file("sampling.log", dir.str() + "/sampling.log");
+			}
+			if (mem->live_stats.is_open())
+			{
+				// Leave the parent's segment alone and publish to NAME_fork_i.
+				string live_stats_name = mem->live_stats.name;
+				mem->live_stats.close(false);
+				mem->open_live_stats(live_stats_name + "_" + dir.str());
+			}
+			if (chdir(dir.str().c_str()) != 0)
+			{
+				cerr << "ERROR: Could not change to directory " << dir.str() << "\n";
+				abort();
+			}
+			if (sampling)
+				sampling_log.open("sampling.log", ios_base::out | ios_base::app);
+
+			if ((freopen("out.txt", "w", stdout) == NULL) || (freopen("err.txt", "w", stderr) == NULL))
+				abort();
+
+			inFile.close();
+			inFile.open(tracefile, ifstream::in);
+			inFile.seekg(trace_position);
+
+			cout << "Variant " << i << " forked at cycle " << mem->currentClockCycle << ": " << variants[i] << "\n";
+			apply_variant(mem, variants[i]);
+			return;
+		}
+
+		children.push_back(pid);
+	}
+
+	// Parent: wait for the children (which publish their own live statistics).
+	mem->close_live_stats();
+	int failed = 0;
+	for (size_t i = 0; i < children.size(); i++)
+	{
+		int status;
+		waitpid(children[i], &status, 0);
+		bool ok = WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+		cout << "Variant " << i << " (" << variants[i] << ") " << (ok ? "finished" : "FAILED") << " (see fork_" << i << ")\n";
+		if (!ok)
+			failed++;
+	}
+
+	exit(failed ? 1 : 0);
+}
+
+void HybridSimTBS::save_checkpoint(HybridSystem *mem, ifstream &inFile)
+{
+	// The trace driver state goes first, then the memory system. The lines that were read ahead have not been
+	// added yet, so they are saved too (in trace order) and are read first after resuming.
+	ofstream out;
+	out.open(checkpoint_file.c_str(), ios_base::out | ios_base::trunc);
+	if (!out.is_open())
+	{
+		cout << "ERROR: Failed to open checkpoint file: " << checkpoint_file << "\n";
+		abort();
+	}
+
+	map<uint64_t, string> lines;
+	for (uint64_t i = 0; i < cores.size(); i++)
+	{
+		for (list<TraceLine>::iterator it = cores[i].lines.begin(); it != cores[i].lines.end(); it++)
+			lines[(*it).seq] = (*it).text;
+	}
+	if (has_next_line)
+		lines[next_line.seq] = next_line.text;
+
+	out << "tbs\n";
+	out << inFile.tellg() << " " << trace_accesses - lines.size() << " " << trace_cycles << " " << functional_cycles << " " 
+		<< complete << " " << pending << " " << throttle_count << " " << throttle_cycles << " " << last_clock << "\n";
+	out << lines.size() << "\n";
+	for (map<uint64_t, string>::iterator it = lines.begin(); it != lines.end(); it++)
+		out << (*it).second << "\n";
+
+	checkpoint_section(out, "cores");
+	checkpoint_write(out, (uint64_t) cores.size());
+	for (uint64_t i = 0; i < cores.size(); i++)
+	{
+		out << cores[i].outstanding << " " << cores[i].waiting << " " << cores[i].reads << " " << cores[i].start_trace_cycle << " " 
+			<< cores[i].start_cycle << " " << cores[i].accesses << " " << cores[i].window_stalls << " " 
+			<< cores[i].dependent_stalls << " " << cores[i].stall_cycles << "\n";
+	}
+	checkpoint_write(out, core_in_flight);
+
+	mem->saveCheckpoint(out);
+	out.close();
+
+	cout << "Saved checkpoint at cycle " << mem->currentClockCycle << " to " << checkpoint_file << "\n";
+}
+
+void HybridSimTBS::load_checkpoint(HybridSystem *mem, ifstream &inFile)
+{
+	ifstream in;
+	in.open(resume_file.c_str(), ifstream::in);
+	if (!in.is_open())
+	{
+		cout << "ERROR: Failed to open checkpoint file: " << resume_file << "\n";
+		abort();
+	}
+
+	string section, line;
+	uint64_t trace_position, num_lines;
+	in >> section;
+	if (section != "tbs")
+	{
+		cout << "ERROR: " << resume_file << " is not a trace based simulator checkpoint.\n";
+		abort();
+	}
+	in >> trace_position >> trace_accesses >> trace_cycles >> functional_cycles >> complete >> pending 
+		>> throttle_count >> throttle_cycles >> last_clock;
+	in >> num_lines >> ws;
+	replay_lines.clear();
+	for (uint64_t i = 0; i < num_lines; i++)
+	{
+		getline(in, line);
+		replay_lines.push_back(line);
+	}
+
+	// The ipc scales come from the ini file, which must be the same one the checkpoint was made with.
+	uint64_t num_cores;
+	checkpoint_expect(in, "cores");
+	checkpoint_read(in, num_cores);
+	if (num_cores != cores.size())
+	{
+		cout << "ERROR: " << resume_file << " was saved with " << num_cores << " cores, but CORES=" << CORES << "\n";
+		abort();
+	}
+	for (uint64_t i = 0; i < cores.size(); i++)
+	{
+		in >> cores[i].outstanding >> cores[i].waiting >> cores[i].reads >> cores[i].start_trace_cycle >> cores[i].start_cycle 
+			>> cores[i].accesses >> cores[i].window_stalls >> cores[i].dependent_stalls >> cores[i].stall_cycles;
+	}
+	checkpoint_read(in, core_in_flight);
+
+	mem->loadCheckpoint(in);
+	in.close();
+
+	inFile.seekg(trace_position);
+	cout << "Resumed from " << resume_file << " at cycle " << mem->currentClockCycle << "\n";
+}
+
 int HybridSimTBS::run_trace(string tracefile)
 {
 	HybridSystem *mem = new HybridSystem(1, "");
 
+	// Set up sampled simulation.
+	// Each period is functional warming, then SAMPLING_WARMUP detailed accesses, then SAMPLING_DETAILED measured accesses.
+	uint64_t sampling_functional = 0;
+	uint64_t sampling_position = 0;
+	bool sampling_started = false;
+	if (SAMPLING_PERIOD > 0)
+	{
+		if ((SAMPLING_DETAILED == 0) || (SAMPLING_PERIOD < SAMPLING_WARMUP + SAMPLING_DETAILED))
+		{
+			cout << "ERROR: SAMPLING_PERIOD must be at least SAMPLING_WARMUP + SAMPLING_DETAILED and SAMPLING_DETAILED must be non-zero.\n";
+			abort();
+		}
+		if (!LOGGER_ON)
+		{
+			cout << "ERROR: Sampled simulation needs ENABLE_LOGGER=1 (and a build with STATS=counters or full).\n";
+			abort();
+		}
+		sampling_functional = SAMPLING_PERIOD - SAMPLING_WARMUP - SAMPLING_DETAILED;
+
+		sampling_log.open("sampling.log", ios_base::out | ios_base::trunc);
+		if (!sampling_log.is_open())
+		{
+			cout << "ERROR: Failed to open sampling.log\n";
+			abort();
+		}
+		sampling_log << "# sample cycle accesses misses miss_rate avg_latency avg_read_latency\n";
+	}
+
+	if ((SAMPLING_PERIOD > 0) && (use_checkpoint || !resume_file.empty()))
+	{
+		cout << "ERROR: --checkpoint and --resume do not work with sampled simulation (SAMPLING_PERIOD).\n";
+		abort();
+	}
+
 
 	/* create and register our callback functions */
-	typedef CallbackBase<void,uint,uint64_t,uint64_t> Callback_t;
-	Callback_t *read_cb = new Callback<HybridSimTBS, void, uint, uint64_t, uint64_t>(this, &HybridSimTBS::read_complete);
-	Callback_t *write_cb = new Callback<HybridSimTBS, void, uint, uint64_t, uint64_t>(this, &HybridSimTBS::write_complete);
-	mem->RegisterCallbacks(read_cb, write_cb);
+	// The id callbacks let the core model match completions to the core that issued them.
+	typedef CallbackBase<void,uint64_t,uint64_t,uint64_t> Callback_t;
+	Callback_t *read_cb = new Callback<HybridSimTBS, void, uint64_t, uint64_t, uint64_t>(this, &HybridSimTBS::read_complete);
+	Callback_t *write_cb = new Callback<HybridSimTBS, void, uint64_t, uint64_t, uint64_t>(this, &HybridSimTBS::write_complete);
+	mem->RegisterIdCallbacks(read_cb, write_cb);
+
+	init_cores(0);
 
 	// Open input file
 	ifstream inFile;
@@ -122,81 +922,172 @@ int HybridSimTBS::run_trace(string tracefile)
 		cout << "ERROR: Failed to load tracefile: " << tracefile << "\n";
 		abort();
 	}
-	
 
-	char char_line[256];
-	string line;
-
-	while (inFile.good())
+	// Only run chunks first_chunk to last_chunk (plus warmup_chunks before them in functional mode).
+	uint64_t chunk_access_limit = 0;
+	if (use_chunks)
 	{
-		// Read the next line.
-		inFile.getline(char_line, 256);
-		line = (string)char_line;
+		TraceIndex index;
+		index.read(tracefile);
 
-		// Filter comments out.
-		size_t pos = line.find("#");
-		line = line.substr(0, pos);
+		if ((first_chunk > last_chunk) || (last_chunk >= index.chunks.size()))
+		{
+			cout << "ERROR: Invalid chunk range " << first_chunk << " to " << last_chunk << " (the trace has " 
+				<< index.chunks.size() << " chunks)\n";
+			abort();
+		}
 
-		// Strip whitespace from the ends.
-		line = strip(line);
+		uint64_t start_chunk = (warmup_chunks > first_chunk) ? 0 : first_chunk - warmup_chunks;
+		uint64_t warmup_accesses = 0;
+		for (uint64_t i = start_chunk; i <= last_chunk; i++)
+		{
+			if (i < first_chunk)
+				warmup_accesses += index.chunks[i].accesses;
+			chunk_access_limit += index.chunks[i].accesses;
+		}
 
-		// Filter newlines out.
-		if (line.empty())
-			continue;
+		cout << "Running chunks " << first_chunk << " to " << last_chunk << " (cycles " << index.chunks[first_chunk].start_cycle 
+			<< " to " << index.chunks[last_chunk].end_cycle << ") with " << first_chunk - start_chunk << " warmup chunks (" 
+			<< warmup_accesses << " accesses)\n";
+
+		// Seek to the first chunk and skip the cycles before it.
+		inFile.seekg(index.chunks[start_chunk].offset);
+		functional_cycles = index.chunks[start_chunk].start_cycle;
+		init_cores(functional_cycles);
 
-		// Split and parse.
-		list<string> split_line = split(line);
+		// The warmup chunks are run in functional mode so they only warm up the cache and prefetchers.
+		if (warmup_accesses > 0)
+			mem->setFunctional(warmup_accesses);
+	}
+	
 
-		if (split_line.size() != 3)
+	// A resumed run first reads the lines that were read ahead (but not added) when the checkpoint was saved.
+	trace_done = false;
+	next_seq = 0;
+	has_next_line = false;
+	if (!resume_file.empty())
+		load_checkpoint(mem, inFile);
+
+	// The sampling period is moved through once per access.
+	bool sampling_checked = false;
+
+	while (true)
+	{
+		read_ahead(inFile, use_chunks, chunk_access_limit);
+		if (!lines_left())
+			break;
+
+		// The driver clock. It does not include the cycles spent draining the samples.
+		uint64_t cycle = trace_cycles + throttle_cycles + functional_cycles;
+
+		// Warm up to fork_cycle, then fork the variants. Only the children return from fork_variants().
+		if ((use_fork) && (cycle >= fork_cycle))
 		{
-			cout << "ERROR: Parsing trace failed on line:\n" << line << "\n";
-			cout << "There should be exactly three numbers per line\n";
-			cout << "There are " << split_line.size() << endl;
-			abort();
+			use_fork = false;
+			fork_variants(mem, inFile, tracefile);
 		}
 
-		uint64_t line_vals[3];
-
-		int i = 0;
-		for (list<string>::iterator it = split_line.begin(); it != split_line.end(); it++, i++)
+		// Run to checkpoint_cycle and save the checkpoint.
+		if ((use_checkpoint) && (cycle >= checkpoint_cycle))
 		{
-			// convert string to integer
-			uint64_t tmp;
-			convert_uint64_t(tmp, (*it));
-			line_vals[i] = tmp;
+			use_checkpoint = false;
+			save_checkpoint(mem, inFile);
+			if (checkpoint_exit)
+				exit(0);
 		}
 
-		// Finish parsing.
-		uint64_t trans_cycle = line_vals[0];
-		bool write = line_vals[1] % 2;
-		uint64_t addr = line_vals[2];
+		// Move through the sampling period. Sampling starts after any FUNCTIONAL_ACCESSES warmup is done.
+		// This is done once the oldest line is not held up by a stalled core (or right before another core
+		// issues ahead of it).
+		int64_t core = next_core(cycle);
+		if ((SAMPLING_PERIOD > 0) && (!sampling_checked) && ((core >= 0) || (!oldest_line_stalled())))
+		{
+			sampling_checked = true;
+			if (sampling_started || !mem->isFunctional())
+			{
+				sampling_started = true;
 
-		// increment the counter until >= the clock cycle of cur transaction
-		// for each cycle, call the update() function.
-		while (trace_cycles < trans_cycle)
+				uint64_t offset = sampling_position % SAMPLING_PERIOD;
+				if ((offset == 0) && (sampling_functional > 0))
+					mem->setFunctional(sampling_functional);
+				if (offset == sampling_functional + SAMPLING_WARMUP)
+					sample_start(mem);
+			}
+		}
+
+		if (core < 0)
 		{
+			if (mem->isFunctional())
+			{
+				// Functional mode has no timing, so skip ahead to the cycle of the next transaction
+				// without calling update(). The access completes inside addTransaction().
+				uint64_t next = next_issue_cycle();
+				if ((use_fork) && (fork_cycle < next))
+					next = fork_cycle;
+				if ((use_checkpoint) && (checkpoint_cycle < next))
+					next = checkpoint_cycle;
+				if (next != (uint64_t)-1)
+				{
+					functional_cycles += next - cycle;
+					continue;
+				}
+			}
+
+			// Nothing can be issued on this cycle. Closed loop core model: a core stops issuing while it has
+			// CORE_MLP accesses outstanding or is waiting for a dependent read. Its clock stops too, so the rest
+			// of its accesses are pushed back by the stall. The other cores keep going unless every core is
+			// stalled (those are the throttle cycles). A stall includes the cycle its last access completes on.
+			bool all_stalled = true;
+			for (uint64_t i = 0; i < cores.size(); i++)
+			{
+				if (cores[i].stalled())
+					cores[i].stall_cycles++;
+				else
+					all_stalled = false;
+			}
 			mem->update();
-			trace_cycles++;
+			if (all_stalled)
+				throttle_cycles++;
+			else
+				trace_cycles++;
+			continue;
 		}
 
+		TraceLine t = cores[core].lines.front();
+		cores[core].lines.pop_front();
+
 		// add the transaction and continue
-		mem->addTransaction(write, addr);
+		// Note: pending is incremented first because the callback can happen inside addTransaction().
 		pending++;
+		core_issue(core, t.write, mem->next_transaction_id);
+		mem->addTransaction(t.write, t.addr);
+		sampling_checked = false;
 
-		// If the pending count goes above MAX_PENDING, wait until it goes back below MIN_PENDING before adding more 
-		// transactions. This throttling will prevent the memory system from getting overloaded.
-		if (pending >= MAX_PENDING)
+		if (sampling_started)
 		{
-			//cout << "MAX_PENDING REACHED! Throttling the trace until pending is back below MIN_PENDING.\t\tcycle= " << trace_cycles << "\n";
-			throttle_count++;
-			while (pending > MIN_PENDING)
+			// At the end of the period, finish the measured accesses before recording the sample
+			// (the next period starts with functional warming, which does not advance time).
+			if (sampling_position % SAMPLING_PERIOD == SAMPLING_PERIOD - 1)
 			{
-				mem->update();
-				throttle_cycles++;
+				while (pending > 0)
+				{
+					mem->update();
+					drain_cycles++;
+				}
+				sample_finish(mem);
 			}
-			//cout << "Back to MIN_PENDING. Allowing transactions to be added again.\t\tcycle= " << trace_cycles << "\n";
+			sampling_position++;
 		}
 
+		TraceCore &c = cores[core];
+		if (c.stalled())
+		{
+			throttle_count++;
+			if (c.waiting)
+				c.dependent_stalls++;
+			else
+				c.window_stalls++;
+		}
 	}
 
 	inFile.close();
@@ -212,11 +1103,8 @@ int HybridSimTBS::run_trace(string tracefile)
 		final_cycles++;
 	}
 
-	// This is a hack for the moment to ensure that a final write completes.
-	// In the future, we need two callbacks to fix this.
-	// This is not counted towards the cycle counts for the run though.
-	for (int i=0; i<1000000; i++)
-		mem->update();
+	// Let the posted DRAM and flash writes finish too. The write drain is part of the run time.
+	final_cycles += mem->drain();
 
 
 	cout << "\n\n" << mem->currentClockCycle << ": completed " << complete << "\n\n";
@@ -243,7 +1131,17 @@ int HybridSimTBS::run_trace(string tracefile)
 	cout << "throttle_count = " << throttle_count << "\n";
 	cout << "throttle_cycles = " << throttle_cycles << "\n";
 	cout << "final_cycles = " << final_cycles << "\n";
+	cout << "functional_cycles (not simulated) = " << functional_cycles << "\n";
+	cout << "drain_cycles = " << drain_cycles << "\n";
 	cout << "total_cycles = trace_cycles + throttle_cycles + final_cycles = " << trace_cycles + throttle_cycles + final_cycles << "\n\n";
+
+	print_cores();
+
+	if (SAMPLING_PERIOD > 0)
+	{
+		print_samples();
+		sampling_log.close();
+	}
 	
 	mem->printLogfile();
 
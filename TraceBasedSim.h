@@ -30,13 +30,118 @@
 
 
 #include "HybridSystem.h"
+#include "TraceIndex.h"
 
 
 
+// A trace line that has been read but not issued yet.
+class TraceLine
+{
+	public:
+	uint64_t seq; // Position in the trace (lines that are ready on the same cycle issue in trace order).
+	uint64_t trans_cycle;
+	bool write;
+	uint64_t addr;
+	uint64_t core;
+	string text; // Saved in checkpoints.
+};
+
+// One core of the closed loop core model (see the CORE_* settings in hybridsim.ini).
+class TraceCore
+{
+	public:
+	TraceCore() : outstanding(0), waiting(false), reads(0), ipc_scale(1.0), start_trace_cycle(0), start_cycle(0),
+		accesses(0), window_stalls(0), dependent_stalls(0), stall_cycles(0) {}
+
+	uint64_t outstanding; // Accesses issued and not complete yet.
+	bool waiting; // Waiting for a dependent read to complete.
+	uint64_t reads;
+	bool stalled(); // CORE_MLP accesses outstanding or waiting for a dependent read.
+
+	// Lines for this core that have been read ahead (at most CORE_LOOKAHEAD).
+	list<TraceLine> lines;
+
+	// Trace timestamps are scaled relative to the start of the run (or the first chunk). The core's clock
+	// stops while it is stalled, so its accesses are also pushed back by its stall cycles.
+	double ipc_scale;
+	uint64_t start_trace_cycle;
+	uint64_t start_cycle;
+	uint64_t issue_cycle(uint64_t trace_cycle);
+
+	// Stats
+	uint64_t accesses;
+	uint64_t window_stalls;
+	uint64_t dependent_stalls;
+	uint64_t stall_cycles;
+};
+
 class HybridSimTBS
 {
 	public: 
-		void read_complete(uint, uint64_t, uint64_t);
-		void write_complete(uint, uint64_t, uint64_t);
+		void read_complete(uint64_t, uint64_t, uint64_t);
+		void write_complete(uint64_t, uint64_t, uint64_t);
 		int run_trace(string tracefile);
+
+		// Closed loop core model.
+		vector<TraceCore> cores;
+		unordered_map<uint64_t, pair<uint64_t, uint64_t> > core_in_flight; // transaction id -> (core, dependent)
+		void init_cores(uint64_t start_trace_cycle);
+		void core_issue(uint64_t core, bool isWrite, uint64_t id);
+		void core_complete(uint64_t id);
+		void print_cores();
+
+		// Per core lookahead. The trace is read in order into each core's lines, so a stalled core only
+		// holds back the other cores once it has CORE_LOOKAHEAD lines waiting.
+		bool trace_done; // The end of the trace (or chunk range) was reached.
+		uint64_t next_seq;
+		TraceLine next_line; // Read but not queued yet because its core's lookahead is full.
+		bool has_next_line;
+		list<string> replay_lines; // Lines saved in a checkpoint. They are read before the rest of the trace.
+		void read_ahead(ifstream &inFile, bool use_limit, uint64_t limit);
+		int64_t next_core(uint64_t cycle);
+		uint64_t next_issue_cycle();
+		bool oldest_line_stalled();
+		bool lines_left();
+
+		// Chunk range to simulate (see TraceIndex).
+		bool use_chunks;
+		uint64_t first_chunk;
+		uint64_t last_chunk;
+		uint64_t warmup_chunks;
+
+		// Fork one child per variant at fork_cycle (see fork_variants).
+		bool use_fork;
+		uint64_t fork_cycle;
+		vector<string> variants;
+		void fork_variants(HybridSim::HybridSystem *mem, ifstream &inFile, string tracefile);
+		void apply_variant(HybridSim::HybridSystem *mem, string overrides);
+
+		// Save a checkpoint at checkpoint_cycle (and optionally stop) or resume from resume_file.
+		bool use_checkpoint;
+		uint64_t checkpoint_cycle;
+		string checkpoint_file;
+		bool checkpoint_exit;
+		string resume_file;
+		void save_checkpoint(HybridSim::HybridSystem *mem, ifstream &inFile);
+		void load_checkpoint(HybridSim::HybridSystem *mem, ifstream &inFile);
+
+		// Sampled simulation helpers.
+		void sample_start(HybridSim::HybridSystem *mem);
+		void sample_finish(HybridSim::HybridSystem *mem);
+		void print_sample_estimate(ostream &out, string name, vector<double> &values);
+		void print_samples();
+
+		// Logger counters at the start of the current sample.
+		uint64_t sample_accesses;
+		uint64_t sample_misses;
+		uint64_t sample_latency;
+		uint64_t sample_reads;
+		uint64_t sample_read_latency;
+		uint64_t sample_cycle;
+
+		// Per sample results.
+		vector<double> sample_miss_rate;
+		vector<double> sample_avg_latency;
+		vector<double> sample_avg_read_latency;
+		ofstream sampling_log;
 };
@@ -0,0 +1,237 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include "TraceIndex.h"
+
+bool parse_trace_line(string line, uint64_t &cycle, bool &write, uint64_t &addr)
+{
+	uint64_t core;
+	return parse_trace_line(line, cycle, write, addr, core);
+}
+
+bool parse_trace_line(string line, uint64_t &cycle, bool &write, uint64_t &addr, uint64_t &core)
+{
+	// Filter comments out.
+	size_t pos = line.find("#");
+	line = line.substr(0, pos);
+
+	// Strip whitespace from the ends.
+	line = strip(line);
+
+	// Filter newlines out.
+	if (line.empty())
+		return false;
+
+	// Split and parse.
+	list<string> split_line = split(line);
+
+	if ((split_line.size() != 3) && (split_line.size() != 4))
+	{
+		cout << "ERROR: Parsing trace failed on line:\n" << line << "\n";
+		cout << "There should be three numbers per line (or four with the core number)\n";
+		cout << "There are " << split_line.size() << endl;
+		abort();
+	}
+
+	uint64_t line_vals[4] = {0, 0, 0, 0};
+
+	int i = 0;
+	for (list<string>::iterator it = split_line.begin(); it != split_line.end(); it++, i++)
+	{
+		// convert string to integer
+		uint64_t tmp;
+		convert_uint64_t(tmp, (*it));
+		line_vals[i] = tmp;
+	}
+
+	// Finish parsing.
+	cycle = line_vals[0];
+	write = line_vals[1] % 2;
+	addr = line_vals[2];
+	core = line_vals[3];
+
+	return true;
+}
+
+string TraceIndex::index_name(string tracefile)
+{
+	return tracefile + ".idx";
+}
+
+uint64_t TraceIndex::file_size(string filename)
+{
+	ifstream f(filename.c_str(), ifstream::in | ifstream::binary);
+	if (!f.is_open())
+	{
+		cout << "ERROR: Failed to open " << filename << "\n";
+		abort();
+	}
+	f.seekg(0, ios_base::end);
+	return f.tellg();
+}
+
+void TraceIndex::build(string tracefile, uint64_t accesses_per_chunk)
+{
+	if (accesses_per_chunk == 0)
+	{
+		cout << "ERROR: The number of accesses per chunk must be non-zero.\n";
+		abort();
+	}
+
+	ifstream inFile;
+	inFile.open(tracefile.c_str(), ifstream::in | ifstream::binary);
+	if (!inFile.is_open())
+	{
+		cout << "ERROR: Failed to load tracefile: " << tracefile << "\n";
+		abort();
+	}
+
+	trace_size = file_size(tracefile);
+	chunk_accesses = accesses_per_chunk;
+	chunks.clear();
+
+	string line;
+	uint64_t chunk_offset = 0;
+	uint64_t chunk_start = 0;
+	uint64_t chunk_count = 0;
+	uint64_t last_cycle = 0;
+	uint64_t cycle, addr;
+	bool write;
+
+	while (getline(inFile, line))
+	{
+		if (!parse_trace_line(line, cycle, write, addr))
+			continue;
+
+		if (chunk_count == 0)
+			chunk_start = cycle;
+		chunk_count++;
+		last_cycle = cycle;
+
+		if (chunk_count == accesses_per_chunk)
+		{
+			chunks.push_back(TraceChunk(chunk_start, last_cycle, chunk_offset, chunk_count));
+			chunk_count = 0;
+
+			// The next chunk starts with the next line. Only ask for the position at chunk boundaries
+			// since tellg() is slow.
+			chunk_offset = inFile.tellg();
+		}
+	}
+
+	// Save the partial chunk at the end.
+	if (chunk_count > 0)
+		chunks.push_back(TraceChunk(chunk_start, last_cycle, chunk_offset, chunk_count));
+
+	inFile.close();
+}
+
+void TraceIndex::write(string tracefile)
+{
+	string filename = index_name(tracefile);
+	ofstream outFile;
+	outFile.open(filename.c_str(), ios_base::out | ios_base::trunc);
+	if (!outFile.is_open())
+	{
+		cout << "ERROR: Failed to open trace index file: " << filename << "\n";
+		abort();
+	}
+
+	outFile << "# HybridSim trace index\n";
+	outFile << "# chunk lines are: start_cycle end_cycle byte_offset accesses\n";
+	outFile << "trace_size " << trace_size << "\n";
+	outFile << "chunk_accesses " << chunk_accesses << "\n";
+	outFile << "chunks " << chunks.size() << "\n";
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		outFile << chunks[i].start_cycle << " " << chunks[i].end_cycle << " " << chunks[i].offset << " " << chunks[i].accesses << "\n";
+	}
+
+	outFile.close();
+}
+
+void TraceIndex::read(string tracefile)
+{
+	string filename = index_name(tracefile);
+	ifstream inFile;
+	inFile.open(filename.c_str(), ifstream::in);
+	if (!inFile.is_open())
+	{
+		cout << "ERROR: Failed to open trace index file: " << filename << "\n";
+		cout << "Build it first with --build-index.\n";
+		abort();
+	}
+
+	string line;
+	uint64_t num_chunks = 0;
+	chunks.clear();
+	while (getline(inFile, line))
+	{
+		size_t pos = line.find("#");
+		line = strip(line.substr(0, pos));
+		if (line.empty())
+			continue;
+
+		list<string> split_line = split(line);
+		if ((split_line.size() == 2) && (split_line.front() == "trace_size"))
+			convert_uint64_t(trace_size, split_line.back(), "trace_size");
+		else if ((split_line.size() == 2) && (split_line.front() == "chunk_accesses"))
+			convert_uint64_t(chunk_accesses, split_line.back(), "chunk_accesses");
+		else if ((split_line.size() == 2) && (split_line.front() == "chunks"))
+			convert_uint64_t(num_chunks, split_line.back(), "chunks");
+		else if (split_line.size() == 4)
+		{
+			uint64_t vals[4];
+			int i = 0;
+			for (list<string>::iterator it = split_line.begin(); it != split_line.end(); it++, i++)
+				convert_uint64_t(vals[i], (*it), "chunk");
+			chunks.push_back(TraceChunk(vals[0], vals[1], vals[2], vals[3]));
+		}
+		else
+		{
+			cout << "ERROR: Bad line in trace index file " << filename << ":\n" << line << "\n";
+			abort();
+		}
+	}
+	inFile.close();
+
+	if (chunks.size() != num_chunks)
+	{
+		cout << "ERROR: Trace index file " << filename << " is truncated.\n";
+		abort();
+	}
+
+	if (trace_size != file_size(tracefile))
+	{
+		cout << "ERROR: Trace index file " << filename << " does not match " << tracefile << " (the trace size changed).\n";
+		cout << "Rebuild it with --build-index.\n";
+		abort();
+	}
+}
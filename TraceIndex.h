@@ -0,0 +1,80 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_TRACEINDEX_H
+#define HYBRIDSIM_TRACEINDEX_H
+
+#include <vector>
+
+#include "util.h"
+
+// TraceIndex splits an ASCII trace ("cycle op addr" per line) into chunks with a fixed number of
+// accesses and records where each chunk starts. The index is stored next to the trace in
+// <tracefile>.idx, so the trace itself stays a normal trace file that every other tool can read.
+// With the index, the trace based simulator can seek straight to any chunk instead of scanning
+// the trace from the beginning.
+
+class TraceChunk
+{
+	public:
+	uint64_t start_cycle; // Cycle of the first access in the chunk.
+	uint64_t end_cycle; // Cycle of the last access in the chunk.
+	uint64_t offset; // Byte offset of the chunk in the trace file.
+	uint64_t accesses; // Number of accesses in the chunk.
+
+	TraceChunk(uint64_t start, uint64_t end, uint64_t off, uint64_t num) : start_cycle(start), end_cycle(end), offset(off), accesses(num) {}
+};
+
+class TraceIndex
+{
+	public:
+	uint64_t trace_size; // Size of the trace file in bytes (used to detect a stale index).
+	uint64_t chunk_accesses;
+	std::vector<TraceChunk> chunks;
+
+	TraceIndex() : trace_size(0), chunk_accesses(0) {}
+
+	// Scan tracefile and build the chunk list.
+	void build(string tracefile, uint64_t accesses_per_chunk);
+
+	// Save and load <tracefile>.idx.
+	void write(string tracefile);
+	void read(string tracefile);
+
+	static string index_name(string tracefile);
+	static uint64_t file_size(string filename);
+};
+
+// Parse one trace line. Returns false for blank lines and comments. Aborts on malformed lines.
+// The optional fourth field is the core number (0 if it is missing).
+bool parse_trace_line(string line, uint64_t &cycle, bool &write, uint64_t &addr);
+bool parse_trace_line(string line, uint64_t &cycle, bool &write, uint64_t &addr, uint64_t &core);
+
+#endif
@@ -0,0 +1,75 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include "TraceWriter.h"
+
+using namespace std;
+
+namespace HybridSim
+{
+	TraceWriter::TraceWriter()
+	{
+		text = false;
+		binary = false;
+		buffer_bytes = 0;
+		append = false;
+	}
+
+	void TraceWriter::init(string name, string setting, string format, uint64_t buffer_bytes)
+	{
+		if ((format != "none") && (format != "text") && (format != "binary"))
+		{
+			cerr << "ERROR: Invalid " << setting << " " << format << " (must be none, text or binary)\n";
+			abort();
+		}
+		if ((format != "none") && (buffer_bytes == 0))
+		{
+			cerr << "ERROR: DEBUG_TRACE_BUFFER must be greater than 0.\n";
+			abort();
+		}
+
+		text = (format == "text");
+		binary = (format == "binary");
+		filename = name + (binary ? ".bin" : ".log");
+		this->buffer_bytes = buffer_bytes;
+		append = false;
+	}
+
+	void TraceWriter::open()
+	{
+		if ((out.open(filename, buffer_bytes, append) == 0) && binary)
+		{
+			out.write("HSTRACE\0", 8);
+			out.put_uint64(VERSION);
+			out.put_uint64(RECORD_SIZE);
+		}
+		append = true;
+	}
+}
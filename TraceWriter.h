@@ -0,0 +1,95 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_TRACEWRITER_H
+#define HYBRIDSIM_TRACEWRITER_H
+
+#include <cstdio>
+
+#include "BufferedWriter.h"
+
+namespace HybridSim
+{
+	// TraceWriter records a stream of accesses (FULL_TRACE and NVDIMM_TRACE) through a BufferedWriter, so
+	// tracing costs a copy into memory per access instead of a formatted write and flush.
+	//
+	// text writes NAME.log with one "cycle write address" line per access, the same format the trace based
+	// simulator reads. binary writes NAME.bin (all integers little endian):
+	//   header: "HSTRACE\0" then version and the record size as uint64
+	//   record: cycle and address as uint64, then one flags byte (bit 0 is write)
+	// tools/read_trace.py turns a binary trace into the text format.
+	class TraceWriter
+	{
+		public:
+		static const uint64_t VERSION = 1;
+		static const uint64_t HEADER_SIZE = 24;
+		static const uint64_t RECORD_SIZE = 17;
+
+		TraceWriter();
+
+		// format is none, text or binary (setting is the ini option it came from, for the error message).
+		// The file is opened on the first access.
+		void init(string name, string setting, string format, uint64_t buffer_bytes);
+		bool enabled() { return (binary || text); }
+
+		void write(uint64_t cycle, bool isWrite, uint64_t address)
+		{
+			if (!out.is_open())
+				this->open();
+			if (binary)
+			{
+				out.put_uint64(cycle);
+				out.put_uint64(address);
+				char flags = isWrite ? 1 : 0;
+				out.write(&flags, 1);
+			}
+			else
+			{
+				char line[64];
+				int size = snprintf(line, sizeof(line), "%llu %d %llu\n", (unsigned long long)cycle, isWrite ? 1 : 0, 
+						(unsigned long long)address);
+				out.write(line, size);
+			}
+		}
+		void flush() { out.flush(); } // Wait until every access so far is in the file.
+		void close() { out.close(); } // Reopening (on the next access) appends to the file.
+
+		void open();
+
+		string filename;
+		bool text;
+		bool binary;
+		uint64_t buffer_bytes;
+		bool append; // Append to the file when it is (re)opened.
+		BufferedWriter out;
+	};
+}
+
+#endif
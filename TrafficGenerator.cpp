@@ -0,0 +1,185 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include <cmath>
+
+#include "TrafficGenerator.h"
+
+using namespace std;
+
+namespace HybridSim
+{
+	TrafficGenerator::TrafficGenerator(string pattern, uint64_t footprint, double write_fraction, uint64_t seed)
+	{
+		if (pattern == "sequential")
+			this->pattern = TRAFFIC_SEQUENTIAL;
+		else if (pattern == "strided")
+			this->pattern = TRAFFIC_STRIDED;
+		else if (pattern == "random")
+			this->pattern = TRAFFIC_RANDOM;
+		else if (pattern == "zipf")
+			this->pattern = TRAFFIC_ZIPF;
+		else if (pattern == "set_conflict")
+			this->pattern = TRAFFIC_SET_CONFLICT;
+		else
+		{
+			cerr << "ERROR: Unknown traffic pattern " << pattern << " (valid patterns are " << pattern_names() << ")\n";
+			abort();
+		}
+
+		// Keep the footprint inside the NVRAM address space and a whole number of pages.
+		if ((footprint == 0) || (footprint > TOTAL_PAGES * PAGE_SIZE))
+			footprint = TOTAL_PAGES * PAGE_SIZE;
+		pages = footprint / PAGE_SIZE;
+		if (pages == 0)
+			pages = 1;
+		this->footprint = pages * PAGE_SIZE;
+
+		if ((write_fraction < 0.0) || (write_fraction > 1.0))
+		{
+			cerr << "ERROR: Traffic write fraction must be between 0 and 1 (got " << write_fraction << ")\n";
+			abort();
+		}
+		this->write_fraction = write_fraction;
+
+		stride = PAGE_SIZE;
+		zipf_theta = 0.99;
+		conflict_set = 0;
+
+		rng.seed(seed);
+		position = 0;
+		zipf_ready = false;
+		zipf_alpha = 0;
+		zipf_zetan = 0;
+		zipf_eta = 0;
+		zipf_mask = 0;
+		zipf_shift = 1;
+	}
+
+	bool TrafficGenerator::is_pattern(string pattern)
+	{
+		return (pattern == "sequential") || (pattern == "strided") || (pattern == "random") || (pattern == "zipf") || 
+			(pattern == "set_conflict");
+	}
+
+	string TrafficGenerator::pattern_names()
+	{
+		return "sequential, strided, random, zipf, set_conflict";
+	}
+
+	double TrafficGenerator::uniform()
+	{
+		// 53 random bits in [0, 1).
+		return (rng() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	uint64_t TrafficGenerator::next_zipf_page()
+	{
+		if (!zipf_ready)
+		{
+			if ((zipf_theta <= 0.0) || (zipf_theta >= 1.0))
+			{
+				cerr << "ERROR: zipf_theta must be between 0 and 1 (got " << zipf_theta << ")\n";
+				abort();
+			}
+
+			double zeta2 = 1.0 + pow(0.5, zipf_theta);
+			zipf_zetan = 0;
+			for (uint64_t i = 1; i <= pages; i++)
+				zipf_zetan += 1.0 / pow((double)i, zipf_theta);
+			zipf_alpha = 1.0 / (1.0 - zipf_theta);
+			zipf_eta = (1.0 - pow(2.0 / pages, 1.0 - zipf_theta)) / (1.0 - zeta2 / zipf_zetan);
+			uint64_t bits = 0;
+			while ((1ULL << bits) < pages)
+				bits++;
+			zipf_mask = (1ULL << bits) - 1;
+			zipf_shift = bits / 2 + 1;
+			zipf_ready = true;
+		}
+
+		double u = uniform();
+		double uz = u * zipf_zetan;
+		uint64_t rank;
+		if (uz < 1.0)
+			rank = 0;
+		else if (uz < 1.0 + pow(0.5, zipf_theta))
+			rank = 1;
+		else
+			rank = (uint64_t)(pages * pow(zipf_eta * u - zipf_eta + 1.0, zipf_alpha));
+		if (rank >= pages)
+			rank = pages - 1;
+
+		// Scatter the popular pages over the address space so they do not all land in neighboring sets. The odd
+		// multiplies and the xorshift are each one-to-one modulo the next power of two, and a value past the
+		// last page is mapped again until it lands inside (cycle walking), so every rank gets its own page.
+		uint64_t page = rank;
+		do
+		{
+			page = (page * 0x9e3779b97f4a7c15ULL) & zipf_mask;
+			page ^= page >> zipf_shift;
+			page = (page * 0xbf58476d1ce4e5b9ULL) & zipf_mask;
+		} while (page >= pages);
+		return page;
+	}
+
+	void TrafficGenerator::next(bool &isWrite, uint64_t &addr)
+	{
+		uint64_t blocks_per_page = PAGE_SIZE / BURST_SIZE;
+
+		if (pattern == TRAFFIC_SEQUENTIAL)
+		{
+			addr = position;
+			position = (position + BURST_SIZE) % footprint;
+		}
+		else if (pattern == TRAFFIC_STRIDED)
+		{
+			addr = position;
+			position = (position + stride) % footprint;
+			addr = (addr / BURST_SIZE) * BURST_SIZE;
+		}
+		else if (pattern == TRAFFIC_RANDOM)
+		{
+			addr = (rng() % (footprint / BURST_SIZE)) * BURST_SIZE;
+		}
+		else if (pattern == TRAFFIC_ZIPF)
+		{
+			addr = next_zipf_page() * PAGE_SIZE + (rng() % blocks_per_page) * BURST_SIZE;
+		}
+		else
+		{
+			// Walk the tags of one set (FLASH_ADDRESS(tag, conflict_set)).
+			uint64_t tags = TOTAL_PAGES / NUM_SETS;
+			addr = (position * NUM_SETS + (conflict_set % NUM_SETS)) * PAGE_SIZE;
+			position = (position + 1) % tags;
+		}
+
+		isWrite = (write_fraction > 0.0) && (uniform() < write_fraction);
+	}
+}
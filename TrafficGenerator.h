@@ -0,0 +1,101 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_TRAFFICGENERATOR_H
+#define HYBRIDSIM_TRAFFICGENERATOR_H
+
+#include <iostream>
+#include <random>
+
+#include "config.h"
+
+namespace HybridSim
+{
+	// TrafficGenerator makes synthetic address streams for benchmarks and for driving HybridSim without a trace.
+	// The ini file must be read before one is created, since the addresses depend on the cache geometry.
+	//
+	// Patterns:
+	//   sequential   - every BURST_SIZE block of the footprint in order, then wrap around
+	//   strided      - like sequential, but step by stride bytes
+	//   random       - uniform random blocks in the footprint
+	//   zipf         - random pages with a Zipfian popularity (zipf_theta, hot pages scattered over the sets),
+	//                  random block within the page
+	//   set_conflict - every access maps to cache set conflict_set and walks through the tags (the pattern of
+	//                  tools/trace_generators/set_0_abuse.py), so every access past the first SET_SIZE misses
+	//
+	// Each access is a write with probability write_fraction. The stream only depends on the seed.
+	class TrafficGenerator
+	{
+		public:
+		TrafficGenerator(string pattern, uint64_t footprint, double write_fraction, uint64_t seed);
+
+		void next(bool &isWrite, uint64_t &addr);
+
+		static bool is_pattern(string pattern);
+		static string pattern_names();
+
+		enum Pattern
+		{
+			TRAFFIC_SEQUENTIAL,
+			TRAFFIC_STRIDED,
+			TRAFFIC_RANDOM,
+			TRAFFIC_ZIPF,
+			TRAFFIC_SET_CONFLICT
+		};
+
+		Pattern pattern;
+		uint64_t footprint; // Bytes, starting at address 0 (rounded down to a whole number of pages).
+		double write_fraction;
+
+		// Pattern parameters. Change them before the first call to next().
+		uint64_t stride; // Bytes (strided)
+		double zipf_theta; // Skew (zipf). Must be in (0, 1).
+		uint64_t conflict_set; // Set index (set_conflict)
+
+		// State
+		std::mt19937_64 rng;
+		uint64_t position; // Next offset for sequential and strided, next tag for set_conflict.
+		uint64_t pages;
+
+		// Zipf constants (computed on the first zipf access, following Gray et al., "Quickly Generating
+		// Billion-Record Synthetic Databases").
+		bool zipf_ready;
+		double zipf_alpha;
+		double zipf_zetan;
+		double zipf_eta;
+		uint64_t zipf_mask; // Next power of two above the last page, minus 1 (for the rank to page permutation).
+		uint64_t zipf_shift;
+
+		double uniform();
+		uint64_t next_zipf_page();
+	};
+}
+
+#endif
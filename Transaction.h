@@ -51,16 +51,20 @@ namespace HybridSim
 			TransactionType transactionType;
 			uint64_t address;
 			void *data;
+			// Assigned by HybridSystem::addTransaction(), or from INTERNAL_ID_BASE up for prefetches, flushes and syncs.
+			// DRAM/flash operations carry the id of the access they are for.
+			uint64_t id;
 
 			//functions
-			Transaction(TransactionType transType, uint64_t addr, void *data)
+			Transaction(TransactionType transType, uint64_t addr, void *data, uint64_t id = 0)
 			{
 				this->transactionType = transType;
 				this->address = addr;
 				this->data = data;
+				this->id = id;
 			}
 
-			Transaction() {}
+			Transaction() : id(0) {}
 
 			//void print();
 	};
@@ -0,0 +1,209 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <map>
+
+#include "TransactionTrace.h"
+
+using namespace std;
+
+namespace HybridSim
+{
+	static const uint64_t NO_CYCLE = (uint64_t)-1;
+
+	TransactionTrace::TransactionTrace()
+	{
+		sample_period = 0;
+		next = 0;
+		recorded = 0;
+	}
+
+	void TransactionTrace::init(uint64_t sample_period, uint64_t buffer_events)
+	{
+		this->sample_period = sample_period;
+		next = 0;
+		recorded = 0;
+		ring.clear();
+		if (sample_period == 0)
+			return;
+
+		if (buffer_events == 0)
+		{
+			cerr << "ERROR: TRANSACTION_TRACE_BUFFER must be greater than 0.\n";
+			abort();
+		}
+		ring.resize(buffer_events);
+	}
+
+	// The cycle of each event of one access (NO_CYCLE if it did not happen).
+	class TracedAccess
+	{
+		public:
+		uint64_t cycle[TransactionTrace::NUM_TRACE_EVENTS];
+		uint64_t address;
+		bool write;
+
+		TracedAccess() : address(0), write(false)
+		{
+			for (size_t i = 0; i < TransactionTrace::NUM_TRACE_EVENTS; i++)
+				cycle[i] = NO_CYCLE;
+		}
+
+		bool has(TransactionTrace::EventType type) { return cycle[type] != NO_CYCLE; }
+	};
+
+	// Chrome trace timestamps are in microseconds.
+	static double trace_us(uint64_t cycles)
+	{
+		return cycles * 1000000.0 / CYCLES_PER_SECOND;
+	}
+
+	static void trace_span(ostream &out, string name, uint64_t tid, uint64_t start, uint64_t end, uint64_t id)
+	{
+		out << ",\n{\"name\": \"" << name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << tid << ", \"ts\": " << trace_us(start) 
+			<< ", \"dur\": " << trace_us(end - start) << ", \"args\": {\"id\": " << id << ", \"cycles\": " << end - start << "}}";
+	}
+
+	static void trace_instant(ostream &out, string name, uint64_t tid, uint64_t cycle, uint64_t id)
+	{
+		out << ",\n{\"name\": \"" << name << "\", \"ph\": \"i\", \"s\": \"t\", \"pid\": 0, \"tid\": " << tid << ", \"ts\": " 
+			<< trace_us(cycle) << ", \"args\": {\"id\": " << id << "}}";
+	}
+
+	static void trace_thread_name(ostream &out, uint64_t tid, string name)
+	{
+		out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << tid << ", \"args\": {\"name\": \"" << name << "\"}}";
+		out << ",\n{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << tid << ", \"args\": {\"sort_index\": " << tid << "}}";
+	}
+
+	uint64_t TransactionTrace::write_chrome(string filename)
+	{
+		// Collect the events of each access, oldest first. Transaction ids are handed out in order, so the map
+		// is also in the order the accesses arrived.
+		map<uint64_t, TracedAccess> accesses;
+		uint64_t count = (recorded < ring.size()) ? recorded : ring.size();
+		uint64_t first = (recorded > ring.size()) ? next : 0;
+		for (uint64_t i = 0; i < count; i++)
+		{
+			Event &e = ring[(first + i) % ring.size()];
+			if (e.type == TRACE_ENQUEUE)
+			{
+				accesses[e.id] = TracedAccess();
+				accesses[e.id].address = e.data;
+			}
+			map<uint64_t, TracedAccess>::iterator it = accesses.find(e.id);
+			if (it == accesses.end())
+				continue; // The start of this access was overwritten.
+			it->second.cycle[e.type] = e.cycle;
+			if (e.type == TRACE_COMPLETE)
+				it->second.write = (e.data != 0);
+		}
+
+		ofstream out;
+		out.open(filename.c_str(), ios_base::out | ios_base::trunc);
+		if (!out.is_open())
+		{
+			cerr << "ERROR: HybridSim transaction trace file " << filename << " failed to open.\n";
+			abort();
+		}
+		out << fixed << setprecision(4);
+		out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+		out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": {\"name\": \"HybridSim\"}}";
+
+		// Each access goes on the first lane that is free by the time it arrives.
+		vector<uint64_t> lane_end;
+		uint64_t written = 0;
+		for (map<uint64_t, TracedAccess>::iterator it = accesses.begin(); it != accesses.end(); it++)
+		{
+			uint64_t id = it->first;
+			TracedAccess &a = it->second;
+			bool hit = a.has(TRACE_HIT);
+			if (!a.has(TRACE_LOOKUP) || !(hit || a.has(TRACE_MISS)) || !a.has(TRACE_COMPLETE))
+				continue; // Still in flight.
+
+			uint64_t enqueue = a.cycle[TRACE_ENQUEUE];
+			uint64_t lookup = a.cycle[TRACE_LOOKUP];
+			uint64_t decision = hit ? a.cycle[TRACE_HIT] : a.cycle[TRACE_MISS];
+			uint64_t complete = a.cycle[TRACE_COMPLETE];
+			uint64_t end = 0;
+			for (size_t i = 0; i < NUM_TRACE_EVENTS; i++)
+			{
+				if (a.has((EventType)i) && (a.cycle[i] > end))
+					end = a.cycle[i];
+			}
+
+			size_t lane = 0;
+			while ((lane < lane_end.size()) && (lane_end[lane] > enqueue))
+				lane++;
+			if (lane == lane_end.size())
+			{
+				lane_end.push_back(0);
+				stringstream name;
+				name << "lane " << lane;
+				trace_thread_name(out, 3 * lane, name.str());
+				trace_thread_name(out, 3 * lane + 1, name.str() + " line");
+				trace_thread_name(out, 3 * lane + 2, name.str() + " victim");
+			}
+			lane_end[lane] = end;
+			uint64_t tid = 3 * lane;
+
+			// The request: the whole access, then its queue time, tag lookup and the hit or miss.
+			stringstream name;
+			name << (a.write ? "write" : "read") << " 0x" << hex << a.address;
+			trace_span(out, name.str(), tid, enqueue, complete, id);
+			trace_span(out, "queue", tid, enqueue, lookup, id);
+			trace_span(out, "tag lookup", tid, lookup, decision, id);
+			trace_span(out, hit ? "hit" : "miss", tid, decision, complete, id);
+			if (a.has(TRACE_CRITICAL_LINE))
+				trace_instant(out, "critical line", tid, a.cycle[TRACE_CRITICAL_LINE], id);
+
+			// The miss handling, which can go on after the callback.
+			if (a.has(TRACE_LINE_READ) && a.has(TRACE_LINE_READ_DONE))
+				trace_span(out, "line read", tid + 1, a.cycle[TRACE_LINE_READ], a.cycle[TRACE_LINE_READ_DONE], id);
+			if (a.has(TRACE_LINE_WRITE))
+				trace_instant(out, "line write", tid + 1, a.cycle[TRACE_LINE_WRITE], id);
+			if (a.has(TRACE_VICTIM_READ) && a.has(TRACE_VICTIM_READ_DONE))
+			{
+				trace_span(out, "victim read", tid + 2, a.cycle[TRACE_VICTIM_READ], a.cycle[TRACE_VICTIM_READ_DONE], id);
+				trace_instant(out, "victim write", tid + 2, a.cycle[TRACE_VICTIM_READ_DONE], id);
+			}
+
+			written++;
+		}
+
+		out << "\n]}\n";
+		out.close();
+
+		return written;
+	}
+}
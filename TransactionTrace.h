@@ -0,0 +1,109 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_TRANSACTIONTRACE_H
+#define HYBRIDSIM_TRANSACTIONTRACE_H
+
+#include <iostream>
+
+#include "config.h"
+
+namespace HybridSim
+{
+	// TransactionTrace records when each stage of a sample of the accesses happens, so it is possible to see
+	// where the latency of a slow access goes and which controller stages overlap. One access out of every
+	// TRANSACTION_TRACE_SAMPLE (by transaction id) is traced.
+	//
+	// The events go into a fixed size ring buffer of TRANSACTION_TRACE_BUFFER entries, so tracing a long run
+	// takes constant memory and keeps the most recent events. write_chrome() turns the buffer into a Chrome
+	// trace event file (load it in chrome://tracing or ui.perfetto.dev). Each access is drawn on a lane with
+	// three rows: the request (queue, tag lookup, then the hit or miss until the callback), the line read and
+	// line write of a miss, and the victim read and victim write of a dirty eviction. Accesses whose first
+	// events were overwritten, or that are still in flight, are left out.
+	class TransactionTrace
+	{
+		public:
+		enum EventType
+		{
+			TRACE_ENQUEUE, // addTransaction() (data is the address)
+			TRACE_LOOKUP, // Taken off the trans_queue, tag lookup starts (data is the lookup delay)
+			TRACE_HIT, // Hit/miss decision (data is the cache set)
+			TRACE_MISS,
+			TRACE_VICTIM_READ, // VICTIM_READ issued to the DRAM
+			TRACE_VICTIM_READ_DONE, // Whole victim page read (VICTIM_WRITE is issued to the NVRAM)
+			TRACE_LINE_READ, // LINE_READ issued to the NVRAM
+			TRACE_CRITICAL_LINE, // Critical line callback from the NVRAM
+			TRACE_LINE_READ_DONE, // Whole page read from the NVRAM
+			TRACE_LINE_WRITE, // LINE_WRITE issued to the DRAM
+			TRACE_COMPLETE, // Callback to the user (data is 1 for a write)
+			NUM_TRACE_EVENTS
+		};
+
+		class Event
+		{
+			public:
+			uint64_t cycle;
+			uint64_t id;
+			uint64_t data;
+			uint64_t type;
+		};
+
+		TransactionTrace();
+
+		void init(uint64_t sample_period, uint64_t buffer_events);
+		bool enabled() { return sample_period != 0; }
+
+		// Internal work (prefetches, flushes, syncs and their victim writebacks) has an id from INTERNAL_ID_BASE up and is never traced.
+		bool sampled(uint64_t id) { return (sample_period != 0) && (id != 0) && (id < INTERNAL_ID_BASE) && (id % sample_period == 0); }
+
+		void record(uint64_t cycle, uint64_t id, EventType type, uint64_t data)
+		{
+			Event &e = ring[next];
+			e.cycle = cycle;
+			e.id = id;
+			e.data = data;
+			e.type = type;
+			next++;
+			if (next == ring.size())
+				next = 0;
+			recorded++;
+		}
+
+		// Write the traced accesses as Chrome trace events. Returns the number of accesses written.
+		uint64_t write_chrome(string filename);
+
+		uint64_t sample_period;
+		vector<Event> ring;
+		uint64_t next; // Next slot to write.
+		uint64_t recorded; // Events recorded so far (the ones past the ring size have been overwritten).
+	};
+}
+
+#endif
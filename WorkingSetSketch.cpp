@@ -0,0 +1,243 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#include <cmath>
+
+#include "WorkingSetSketch.h"
+#include "Checkpoint.h"
+
+using namespace std;
+
+namespace HybridSim
+{
+	// 64 bit finalizer from SplitMix64. Page addresses are very regular, so they have to be mixed
+	// before their bits can be used as hash values.
+	static uint64_t sketch_hash(uint64_t x)
+	{
+		x += 0x9E3779B97F4A7C15ULL;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+		return x ^ (x >> 31);
+	}
+
+	HyperLogLog::HyperLogLog(uint64_t bits)
+	{
+		if ((bits < 4) || (bits > 20))
+		{
+			cerr << "ERROR: WORKING_SET_HLL_BITS must be between 4 and 20 (got " << bits << ")\n";
+			abort();
+		}
+
+		this->bits = bits;
+		registers.assign(1ULL << bits, 0);
+	}
+
+	void HyperLogLog::add(uint64_t key)
+	{
+		uint64_t h = sketch_hash(key);
+		uint64_t index = h >> (64 - bits);
+
+		// Rank of the first set bit in the rest of the hash (the guard bit caps it at 64 - bits + 1).
+		uint64_t rest = (h << bits) | (1ULL << (bits - 1));
+		uint8_t rank = __builtin_clzll(rest) + 1;
+		if (rank > registers[index])
+			registers[index] = rank;
+	}
+
+	void HyperLogLog::reset()
+	{
+		registers.assign(registers.size(), 0);
+	}
+
+	uint64_t HyperLogLog::estimate() const
+	{
+		double m = registers.size();
+		double sum = 0.0;
+		uint64_t zeros = 0;
+		for (size_t i = 0; i < registers.size(); i++)
+		{
+			sum += ldexp(1.0, -registers[i]);
+			if (registers[i] == 0)
+				zeros++;
+		}
+
+		double alpha = 0.7213 / (1.0 + 1.079 / m);
+		double e = alpha * m * m / sum;
+
+		// Small range correction (linear counting). The hash is 64 bits, so no large range correction is needed.
+		if ((e <= 2.5 * m) && (zeros > 0))
+			e = m * log(m / zeros);
+
+		return (uint64_t)(e + 0.5);
+	}
+
+	double HyperLogLog::relative_error() const
+	{
+		return 1.04 / sqrt((double)registers.size());
+	}
+
+	void HyperLogLog::saveCheckpoint(ostream &out)
+	{
+		// Eight registers per word.
+		checkpoint_write(out, bits);
+		for (size_t i = 0; i < registers.size(); i += 8)
+		{
+			uint64_t word = 0;
+			for (size_t j = 0; (j < 8) && (i + j < registers.size()); j++)
+				word |= ((uint64_t)registers[i + j]) << (8 * j);
+			checkpoint_write(out, word);
+		}
+	}
+
+	void HyperLogLog::loadCheckpoint(istream &in)
+	{
+		uint64_t b;
+		checkpoint_read(in, b);
+		*this = HyperLogLog(b);
+		for (size_t i = 0; i < registers.size(); i += 8)
+		{
+			uint64_t word;
+			checkpoint_read(in, word);
+			for (size_t j = 0; (j < 8) && (i + j < registers.size()); j++)
+				registers[i + j] = (word >> (8 * j)) & 0xFF;
+		}
+	}
+
+	HotPageSketch::HotPageSketch(uint64_t top_k, uint64_t width, uint64_t depth)
+	{
+		if ((width == 0) || (depth == 0))
+		{
+			cerr << "ERROR: HOT_PAGE_SKETCH_WIDTH and HOT_PAGE_SKETCH_DEPTH must be greater than 0\n";
+			abort();
+		}
+
+		this->top_k = top_k;
+		this->width = width;
+		this->depth = depth;
+		total = 0;
+		counters.assign(width * depth, 0);
+	}
+
+	void HotPageSketch::add(uint64_t key)
+	{
+		total++;
+
+		uint64_t e = 0;
+		for (uint64_t row = 0; row < depth; row++)
+		{
+			uint64_t &c = counters[row * width + (sketch_hash(key + row * 0x9E3779B97F4A7C15ULL) % width)];
+			c++;
+			if ((row == 0) || (c < e))
+				e = c;
+		}
+
+		if (top_k == 0)
+			return;
+
+		// Keep the top_k pages with the largest estimates.
+		unordered_map<uint64_t, uint64_t>::iterator it = top_pages.find(key);
+		if (it != top_pages.end())
+		{
+			top_order.erase(make_pair((*it).second, key));
+			(*it).second = e;
+			top_order.insert(make_pair(e, key));
+		}
+		else if (top_pages.size() < top_k)
+		{
+			top_pages[key] = e;
+			top_order.insert(make_pair(e, key));
+		}
+		else if (e > (*top_order.begin()).first)
+		{
+			top_pages.erase((*top_order.begin()).second);
+			top_order.erase(top_order.begin());
+			top_pages[key] = e;
+			top_order.insert(make_pair(e, key));
+		}
+	}
+
+	uint64_t HotPageSketch::estimate(uint64_t key) const
+	{
+		uint64_t e = 0;
+		for (uint64_t row = 0; row < depth; row++)
+		{
+			uint64_t c = counters[row * width + (sketch_hash(key + row * 0x9E3779B97F4A7C15ULL) % width)];
+			if ((row == 0) || (c < e))
+				e = c;
+		}
+		return e;
+	}
+
+	uint64_t HotPageSketch::error_bound() const
+	{
+		return (uint64_t)ceil((M_E / width) * total);
+	}
+
+	double HotPageSketch::confidence() const
+	{
+		return 1.0 - exp(-(double)depth);
+	}
+
+	vector<pair<uint64_t, uint64_t> > HotPageSketch::top() const
+	{
+		vector<pair<uint64_t, uint64_t> > pages;
+		set<pair<uint64_t, uint64_t> >::const_reverse_iterator it;
+		for (it = top_order.rbegin(); it != top_order.rend(); it++)
+			pages.push_back(make_pair((*it).second, (*it).first));
+		return pages;
+	}
+
+	void HotPageSketch::saveCheckpoint(ostream &out)
+	{
+		checkpoint_write(out, top_k);
+		checkpoint_write(out, width);
+		checkpoint_write(out, depth);
+		checkpoint_write(out, total);
+		checkpoint_write(out, counters);
+		checkpoint_write(out, top_pages);
+	}
+
+	void HotPageSketch::loadCheckpoint(istream &in)
+	{
+		uint64_t k, w, d;
+		checkpoint_read(in, k);
+		checkpoint_read(in, w);
+		checkpoint_read(in, d);
+		*this = HotPageSketch(k, w, d);
+		checkpoint_read(in, total);
+		checkpoint_read(in, counters);
+		checkpoint_read(in, top_pages);
+
+		top_order.clear();
+		unordered_map<uint64_t, uint64_t>::iterator it;
+		for (it = top_pages.begin(); it != top_pages.end(); it++)
+			top_order.insert(make_pair((*it).second, (*it).first));
+	}
+}
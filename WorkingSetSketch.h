@@ -0,0 +1,94 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+#ifndef HYBRIDSIM_WORKINGSETSKETCH_H
+#define HYBRIDSIM_WORKINGSETSKETCH_H
+
+#include <iostream>
+#include <vector>
+#include <set>
+
+#include "config.h"
+
+namespace HybridSim
+{
+	// Fixed size summaries of the pages an address stream touches, used by the Logger when
+	// WORKING_SET_MODE=sketch so that the page statistics do not grow with the address space.
+
+	// HyperLogLog estimates the number of distinct pages with 2^bits one byte registers. The standard
+	// error of the estimate is 1.04/sqrt(2^bits) (0.8% for bits=14, which takes 16 KB).
+	class HyperLogLog
+	{
+		public:
+		HyperLogLog(uint64_t bits = 14);
+
+		void add(uint64_t key);
+		void reset();
+		uint64_t estimate() const;
+		double relative_error() const;
+
+		void saveCheckpoint(ostream &out);
+		void loadCheckpoint(istream &in);
+
+		uint64_t bits;
+		vector<uint8_t> registers;
+	};
+
+	// HotPageSketch keeps a Count-Min sketch of the access count of every page plus the top_k pages with
+	// the largest estimated counts. An estimate is never below the true count and is above it by at most
+	// e/width of all accesses with probability 1 - e^-depth.
+	class HotPageSketch
+	{
+		public:
+		HotPageSketch(uint64_t top_k = 32, uint64_t width = 16384, uint64_t depth = 4);
+
+		void add(uint64_t key);
+		uint64_t estimate(uint64_t key) const;
+		uint64_t error_bound() const; // Maximum overestimate (with probability confidence()).
+		double confidence() const;
+
+		// Top pages, largest estimate first.
+		vector<pair<uint64_t, uint64_t> > top() const;
+
+		void saveCheckpoint(ostream &out);
+		void loadCheckpoint(istream &in);
+
+		uint64_t top_k;
+		uint64_t width;
+		uint64_t depth;
+		uint64_t total; // Number of add() calls.
+		vector<uint64_t> counters; // depth rows of width counters.
+
+		unordered_map<uint64_t, uint64_t> top_pages; // page -> estimate
+		set<pair<uint64_t, uint64_t> > top_order; // (estimate, page), smallest first
+	};
+}
+
+#endif
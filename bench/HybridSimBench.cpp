@@ -0,0 +1,701 @@
+/*********************************************************************************
+* Copyright (c) 2010-2011, 
+* Jim Stevens, Paul Tschirhart, Ishwar Singh Bhati, Mu-Tien Chang, Peter Enns, 
+* Elliott Cooper-Balis, Paul Rosenfeld, Bruce Jacob
+* University of Maryland
+* Contact: jims [at] cs [dot] umd [dot] edu
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+*
+* * Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+* DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+* SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+* CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+* OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************************/
+
+// HybridSimBench runs the HybridSim benchmark suite (make bench).
+//
+// Microbenchmarks time one part of the simulator:
+//   trace_parse        - parse_trace_line() on generated trace lines
+//   generator_PATTERN  - TrafficGenerator::next() for each synthetic pattern
+//   tag_lookup         - cache hits in functional mode (tag lookup and LRU update)
+//   victim_selection   - cache misses in functional mode (set_conflict pattern, LRU victim search)
+//   queue_handling     - detailed mode with a deep trans_queue of accesses that all conflict in one set
+//   logger_queue_DEPTH - Logger access_start/process/stop with DEPTH accesses waiting in the Logger
+//   working_set_MODE   - Logger access_page() on random pages of the footprint (WORKING_SET_MODE exact or sketch)
+//   stream_buffer_SIZE - stream buffer misses on random pages and hits on SIZE/2 streams with SIZE entry tables
+//
+// sync_all dirties random cache lines and then times an MMIO SYNC_ALL that writes them all back.
+//
+// sweep_memory builds and deletes a HybridSystem for each point of a short sweep (like the benchmarks here and
+// the open loop sweep do) and aborts if the heap grows from one point to the next.
+//
+// End to end benchmarks (end_to_end_PATTERN) run each synthetic pattern through the detailed simulator with the
+// backends selected in the ini file, keeping MAX_IN_FLIGHT accesses outstanding.
+//
+// Every benchmark prints one JSON object per line (to stdout and to the --out file) so results can be
+// compared across versions.
+
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+
+#include "../HybridSystem.h"
+#include "../OpenLoop.h"
+#include "../TraceIndex.h"
+#include "../TrafficGenerator.h"
+
+using namespace HybridSim;
+using namespace std;
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "unknown"
+#endif
+
+const uint64_t MAX_IN_FLIGHT = 36;
+const uint64_t SWEEP_POINTS = 5;
+
+typedef CallbackBase<void,uint,uint64_t,uint64_t> Callback_t;
+
+// Discards the open loop latency table, so stdout only has the benchmark results.
+class NullBuffer: public streambuf
+{
+	protected:
+	int overflow(int c) { return c; }
+};
+
+class HybridSimBench
+{
+	public:
+	string ini;
+	uint64_t accesses;
+	uint64_t footprint;
+	double write_fraction;
+	string only;
+	ofstream out;
+
+	uint64_t completed;
+	Callback_t *read_cb;
+	Callback_t *write_cb;
+
+	void read_complete(uint id, uint64_t addr, uint64_t cycle) { completed++; }
+	void write_complete(uint id, uint64_t addr, uint64_t cycle) { completed++; }
+
+	HybridSystem *new_system();
+	void free_system(HybridSystem *mem);
+	bool selected(string name);
+	void report(string name, uint64_t ops, double seconds, string extra);
+
+	void bench_trace_parse();
+	void bench_generator(string pattern);
+	void bench_tag_lookup();
+	void bench_victim_selection();
+	void bench_queue_handling();
+	void bench_logger_queue(uint64_t depth);
+	void bench_working_set(string mode);
+	void bench_stream_buffer(uint64_t entries);
+	void bench_end_to_end(string pattern);
+	void bench_sync_all();
+	void bench_sweep_memory();
+};
+
+double elapsed_seconds(chrono::steady_clock::time_point start)
+{
+	return chrono::duration_cast<chrono::duration<double> >(chrono::steady_clock::now() - start).count();
+}
+
+uint64_t max_rss_kb()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024; // Bytes on macOS.
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+// Bytes allocated with operator new and not freed yet (the containers all allocate through it). Each block
+// starts with its size, padded to keep the block aligned.
+const size_t HEAP_HEADER = 16;
+atomic<uint64_t> heap_in_use(0);
+
+void *operator new(size_t size)
+{
+	size_t *block = (size_t *) malloc(size + HEAP_HEADER);
+	if (block == NULL)
+		throw bad_alloc();
+	*block = size;
+	heap_in_use += size;
+	return (char *) block + HEAP_HEADER;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	if (ptr == NULL)
+		return;
+	size_t *block = (size_t *) ((char *) ptr - HEAP_HEADER);
+	heap_in_use -= *block;
+	free(block);
+}
+
+HybridSystem *HybridSimBench::new_system()
+{
+	HybridSystem *mem = new HybridSystem(0, ini);
+	read_cb = new Callback<HybridSimBench, void, uint, uint64_t, uint64_t>(this, &HybridSimBench::read_complete);
+	write_cb = new Callback<HybridSimBench, void, uint, uint64_t, uint64_t>(this, &HybridSimBench::write_complete);
+	mem->RegisterCallbacks(read_cb, write_cb);
+	completed = 0;
+	return mem;
+}
+
+void HybridSimBench::free_system(HybridSystem *mem)
+{
+	delete mem;
+	delete read_cb;
+	delete write_cb;
+}
+
+bool HybridSimBench::selected(string name)
+{
+	return only.empty() || (name.find(only) != string::npos);
+}
+
+void HybridSimBench::report(string name, uint64_t ops, double seconds, string extra)
+{
+	stringstream line;
+	line << "{\"benchmark\": \"" << name << "\", \"version\": \"" << BENCH_VERSION << "\", \"ops\": " << ops 
+		<< ", \"seconds\": " << seconds << ", \"ns_per_op\": " << (ops ? seconds * 1e9 / ops : 0.0) 
+		<< ", \"ops_per_second\": " << (seconds > 0 ? ops / seconds : 0.0) << extra << "}";
+	cout << line.str() << endl;
+	out << line.str() << endl;
+}
+
+void HybridSimBench::bench_trace_parse()
+{
+	// Build the lines first so only the parsing is timed.
+	TrafficGenerator gen("random", footprint, write_fraction, 1);
+	vector<string> lines;
+	for (uint64_t i = 0; i < accesses; i++)
+	{
+		bool isWrite;
+		uint64_t addr;
+		gen.next(isWrite, addr);
+		stringstream line;
+		line << i * 10 << " " << (isWrite ? 1 : 0) << " " << addr;
+		lines.push_back(line.str());
+	}
+
+	uint64_t sum = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (size_t i = 0; i < lines.size(); i++)
+	{
+		uint64_t cycle, addr;
+		bool write;
+		if (parse_trace_line(lines[i], cycle, write, addr))
+			sum += addr;
+	}
+	double seconds = elapsed_seconds(start);
+
+	stringstream extra;
+	extra << ", \"checksum\": " << sum;
+	report("trace_parse", lines.size(), seconds, extra.str());
+}
+
+void HybridSimBench::bench_generator(string pattern)
+{
+	TrafficGenerator gen(pattern, footprint, write_fraction, 1);
+	uint64_t sum = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (uint64_t i = 0; i < accesses; i++)
+	{
+		bool isWrite;
+		uint64_t addr;
+		gen.next(isWrite, addr);
+		sum += addr + isWrite;
+	}
+	double seconds = elapsed_seconds(start);
+
+	stringstream extra;
+	extra << ", \"checksum\": " << sum;
+	report("generator_" + pattern, accesses, seconds, extra.str());
+}
+
+void HybridSimBench::bench_tag_lookup()
+{
+	// The cache is prefilled with the first CACHE_PAGES pages, so random accesses to them all hit.
+	HybridSystem *mem = new_system();
+	TrafficGenerator gen("random", CACHE_PAGES * PAGE_SIZE, write_fraction, 1);
+	mem->setFunctional(accesses);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (uint64_t i = 0; i < accesses; i++)
+	{
+		bool isWrite;
+		uint64_t addr;
+		gen.next(isWrite, addr);
+		mem->addTransaction(isWrite, addr);
+	}
+	double seconds = elapsed_seconds(start);
+
+	stringstream extra;
+	extra << ", \"misses\": " << mem->functional_misses;
+	report("tag_lookup", accesses, seconds, extra.str());
+	free_system(mem);
+}
+
+void HybridSimBench::bench_victim_selection()
+{
+	HybridSystem *mem = new_system();
+	TrafficGenerator gen("set_conflict", 0, write_fraction, 1);
+	mem->setFunctional(accesses);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (uint64_t i = 0; i < accesses; i++)
+	{
+		bool isWrite;
+		uint64_t addr;
+		gen.next(isWrite, addr);
+		mem->addTransaction(isWrite, addr);
+	}
+	double seconds = elapsed_seconds(start);
+
+	stringstream extra;
+	extra << ", \"misses\": " << mem->functional_misses << ", \"set_size\": " << SET_SIZE;
+	report("victim_selection", accesses, seconds, extra.str());
+	free_system(mem);
+}
+
+void HybridSimBench::bench_queue_handling()
+{
+	// Accesses to one set can only be worked on SET_SIZE at a time, so the rest sit in the trans_queue and
+	// are scanned every time the queue is checked.
+	HybridSystem *mem = new_system();
+	TrafficGenerator gen("set_conflict", 0, write_fraction, 1);
+	uint64_t n = accesses / 10;
+	uint64_t depth = 4 * SET_SIZE;
+
+	uint64_t issued = 0;
+	uint64_t cycles = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	while (completed < n)
+	{
+		while ((issued < n) && (issued - completed < depth))
+		{
+			bool isWrite;
+			uint64_t addr;
+			gen.next(isWrite, addr);
+			mem->addTransaction(isWrite, addr);
+			issued++;
+		}
+		mem->update();
+		cycles++;
+	}
+	double seconds = elapsed_seconds(start);
+
+	stringstream extra;
+	extra << ", \"queue_depth\": " << depth << ", \"cycles\": " << cycles << ", \"ns_per_cycle\": " << seconds * 1e9 / cycles;
+	report("queue_handling", n, seconds, extra.str());
+	free_system(mem);
+}
+
+void HybridSimBench::bench_logger_queue(uint64_t depth)
+{
+	// Keeps depth accesses waiting between access_start() and access_process() and retires them in random
+	// order, so the cost per access should not depend on depth.
+	HybridSystem *mem = new_system();
+	Logger &log = mem->log;
+	uint64_t n = accesses * 10;
+	uint64_t next_id = 1;
+	uint64_t seed = 1;
+
+	vector<uint64_t> waiting;
+	for (uint64_t i = 0; i < depth; i++)
+	{
+		log.access_start(next_id, next_id * 64);
+		waiting.push_back(next_id);
+		next_id++;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (uint64_t i = 0; i < n; i++)
+	{
+		log.access_start(next_id, next_id * 64);
+		waiting.push_back(next_id);
+		next_id++;
+
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		uint64_t pick = (seed >> 33) % waiting.size();
+		uint64_t id = waiting[pick];
+		waiting[pick] = waiting.back();
+		waiting.pop_back();
+
+		log.access_process(id, id * 64, (id % 4) != 0, (id % 3) != 0);
+		log.access_stop(id);
+		if ((i % 16) == 0)
+			log.update();
+	}
+	double seconds = elapsed_seconds(start);
+
+	stringstream extra;
+	extra << ", \"queue_depth\": " << depth;
+	stringstream name;
+	name << "logger_queue_" << depth;
+	report(name.str(), n, seconds, extra.str());
+	free_system(mem);
+}
+
+void HybridSimBench::bench_working_set(string mode)
+{
+	// The ini file is read when the system is created, so the mode is switched afterwards.
+	HybridSystem *mem = new_system();
+	Logger &log = mem->log;
+	string old_mode = WORKING_SET_MODE;
+	WORKING_SET_MODE = mode;
+	log.init();
+	WORKING_SET_MODE = old_mode;
+
+	TrafficGenerator gen("random", footprint, 0.0, 1);
+	uint64_t n = accesses * 10;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (uint64_t i = 0; i < n; i++)
+	{
+		bool isWrite;
+		uint64_t addr;
+		gen.next(isWrite, addr);
+		log.access_page(PAGE_ADDRESS(addr));
+	}
+	double seconds = elapsed_seconds(start);
+
+	stringstream extra;
+	extra << ", \"pages\": " << log.working_set_pages(false) << ", \"max_rss_kb\": " << max_rss_kb();
+	report("working_set_" + mode, n, seconds, extra.str());
+	free_system(mem);
+}
+
+void HybridSimBench::bench_stream_buffer(uint64_t entries)
+{
+	// Each op is a miss on a random page (which goes through the one miss table) and a hit on one of
+	// entries/2 ascending streams. The tables are constant time, so ns_per_op should not grow with entries.
+	// The tables are sized from the ini file when the system is created, so they are resized afterwards.
+	HybridSystem *mem = new_system();
+	mem->one_miss_table.init(entries);
+	mem->stream_buffers.init(entries);
+
+	uint64_t n = accesses * 10;
+	uint64_t seed = 1;
+	uint64_t streams = (entries > 1) ? entries / 2 : 1;
+	uint64_t spacing = TOTAL_PAGES / streams;
+
+	// Start each stream with two misses in a row.
+	vector<uint64_t> next_page;
+	for (uint64_t k = 0; k < streams; k++)
+	{
+		uint64_t base = (k * spacing + 1) * PAGE_SIZE;
+		mem->stream_buffer_miss_handler(base);
+		mem->stream_buffer_miss_handler(base + PAGE_SIZE);
+		next_page.push_back(base + 2 * PAGE_SIZE);
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (uint64_t i = 0; i < n; i++)
+	{
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		mem->stream_buffer_miss_handler((((seed >> 33) % (TOTAL_PAGES - 2)) + 1) * PAGE_SIZE);
+
+		uint64_t k = i % streams;
+		mem->stream_buffer_hit_handler(next_page[k]);
+		next_page[k] += PAGE_SIZE;
+
+		// Drop the prefetches, since the controller is never run.
+		if ((i % 1024) == 0)
+		{
+			mem->pending_count -= mem->trans_queue_size;
+			mem->trans_queue.clear();
+			mem->trans_queue_size = 0;
+		}
+	}
+	double seconds = elapsed_seconds(start);
+
+	stringstream extra;
+	extra << ", \"entries\": " << entries << ", \"stream_buffer_hits\": " << mem->stream_buffer_hits;
+	stringstream name;
+	name << "stream_buffer_" << entries;
+	report(name.str(), n, seconds, extra.str());
+	free_system(mem);
+}
+
+void HybridSimBench::bench_end_to_end(string pattern)
+{
+	HybridSystem *mem = new_system();
+	TrafficGenerator gen(pattern, footprint, write_fraction, 1);
+
+	// Closed loop: keep MAX_IN_FLIGHT accesses outstanding and add at most one access per cycle.
+	uint64_t issued = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	while (completed < accesses)
+	{
+		if ((issued < accesses) && (issued - completed < MAX_IN_FLIGHT))
+		{
+			bool isWrite;
+			uint64_t addr;
+			gen.next(isWrite, addr);
+			mem->addTransaction(isWrite, addr);
+			issued++;
+		}
+		mem->update();
+	}
+	double seconds = elapsed_seconds(start);
+
+	stringstream extra;
+	extra << ", \"cycles\": " << mem->currentClockCycle << ", \"cycles_per_second\": " << mem->currentClockCycle / seconds;
+	if (LOGGER_ON)
+	{
+		extra << ", \"miss_rate\": " << mem->log.miss_rate() << ", \"average_latency\": " 
+			<< mem->log.latency_cycles(mem->log.sum_latency, mem->log.num_accesses);
+	}
+	extra << ", \"max_rss_kb\": " << max_rss_kb();
+	report("end_to_end_" + pattern, accesses, seconds, extra.str());
+	free_system(mem);
+}
+
+void HybridSimBench::bench_sync_all()
+{
+	// Dirties random lines of the cache in detailed mode, then times an MMIO SYNC_ALL until every dirty line
+	// is written back. This also checks that the overlapping SYNCs are kept apart in the pending tables
+	// (run it with the analytic backends, which match their completions by id).
+	HybridSystem *mem = new_system();
+	TrafficGenerator gen("random", CACHE_PAGES * PAGE_SIZE, 1.0, 1);
+	uint64_t n = accesses / 10;
+
+	uint64_t issued = 0;
+	while (completed < n)
+	{
+		if ((issued < n) && (issued - completed < MAX_IN_FLIGHT))
+		{
+			bool isWrite;
+			uint64_t addr;
+			gen.next(isWrite, addr);
+			mem->addTransaction(isWrite, addr);
+			issued++;
+		}
+		mem->update();
+	}
+	while (!mem->isQuiescent())
+		mem->update();
+
+	uint64_t start_cycle = mem->currentClockCycle;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	mem->mmio(1, 0);
+	while (!mem->isQuiescent())
+		mem->update();
+	double seconds = elapsed_seconds(start);
+
+	stringstream extra;
+	extra << ", \"cycles\": " << mem->currentClockCycle - start_cycle << ", \"cache_pages\": " << CACHE_PAGES;
+	report("sync_all", CACHE_PAGES, seconds, extra.str());
+	free_system(mem);
+}
+
+void HybridSimBench::bench_sweep_memory()
+{
+	// Each point runs accesses/10 random accesses on a new HybridSystem, first closed loop (as in the other
+	// benchmarks) and then through OpenLoopDriver::run_rate(). Every point runs the same accesses, so anything
+	// left on the heap after a point is a leak. The first point of each sweep is not checked, since it also
+	// sets up state that lives as long as the process (iostreams, the open loop driver's tables).
+	uint64_t n = accesses / 10;
+	vector<uint64_t> heap;
+	heap.reserve(2 * SWEEP_POINTS);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (uint64_t point = 0; point < SWEEP_POINTS; point++)
+	{
+		HybridSystem *mem = new_system();
+		TrafficGenerator gen("random", footprint, write_fraction, 1);
+		uint64_t issued = 0;
+		while (completed < n)
+		{
+			if ((issued < n) && (issued - completed < MAX_IN_FLIGHT))
+			{
+				bool isWrite;
+				uint64_t addr;
+				gen.next(isWrite, addr);
+				mem->addTransaction(isWrite, addr);
+				issued++;
+			}
+			mem->update();
+		}
+		free_system(mem);
+		heap.push_back(heap_in_use);
+	}
+
+	OpenLoopDriver open_loop;
+	open_loop.ini = ini;
+	open_loop.accesses = n;
+	open_loop.footprint = footprint;
+	open_loop.write_fraction = write_fraction;
+	NullBuffer null_buffer;
+	streambuf *cout_buffer = cout.rdbuf(&null_buffer);
+	ofstream log; // Never opened, so the open loop log lines are dropped too.
+	for (uint64_t point = 0; point < SWEEP_POINTS; point++)
+	{
+		open_loop.run_rate(1.0, log);
+		heap.push_back(heap_in_use);
+	}
+	cout.rdbuf(cout_buffer);
+	double seconds = elapsed_seconds(start);
+
+	uint64_t growth = 0;
+	for (uint64_t point = 1; point < SWEEP_POINTS; point++)
+	{
+		growth = max(growth, heap[point] - min(heap[point], heap[point - 1]));
+		growth = max(growth, heap[SWEEP_POINTS + point] - min(heap[SWEEP_POINTS + point], heap[SWEEP_POINTS + point - 1]));
+	}
+
+	stringstream extra;
+	extra << ", \"points\": " << 2 * SWEEP_POINTS << ", \"heap_growth_bytes\": " << growth;
+	report("sweep_memory", 2 * SWEEP_POINTS * n, seconds, extra.str());
+	if (growth != 0)
+	{
+		cerr << "ERROR: The heap grew by " << growth << " bytes from one sweep point to the next.\n";
+		abort();
+	}
+}
+
+void usage(char *name)
+{
+	cout << "Usage: " << name << " [options]\n";
+	cout << "  --ini FILE             HybridSim ini file (default: the same as the trace based simulator).\n";
+	cout << "  --accesses N           Accesses per benchmark (default 100000).\n";
+	cout << "  --footprint BYTES      Footprint of the synthetic patterns (default 4x the cache).\n";
+	cout << "  --write-fraction F     Fraction of writes (default 0.3).\n";
+	cout << "  --only NAME            Only run the benchmarks whose name contains NAME.\n";
+	cout << "  --out FILE             Also append the results to FILE (default bench.jsonl).\n";
+	cout << "  --gen PATTERN N        Write a trace of N accesses of PATTERN to stdout and exit.\n";
+	cout << "Patterns: " << TrafficGenerator::pattern_names() << "\n";
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	HybridSimBench bench;
+	bench.ini = "";
+	bench.accesses = 100000;
+	bench.footprint = 0;
+	bench.write_fraction = 0.3;
+	string out_file = "bench.jsonl";
+	string gen_pattern;
+	uint64_t gen_accesses = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if ((arg == "--ini") && (i + 1 < argc))
+			bench.ini = argv[++i];
+		else if ((arg == "--accesses") && (i + 1 < argc))
+			convert_uint64_t(bench.accesses, argv[++i], "--accesses");
+		else if ((arg == "--footprint") && (i + 1 < argc))
+			convert_uint64_t(bench.footprint, argv[++i], "--footprint");
+		else if ((arg == "--write-fraction") && (i + 1 < argc))
+			bench.write_fraction = atof(argv[++i]);
+		else if ((arg == "--only") && (i + 1 < argc))
+			bench.only = argv[++i];
+		else if ((arg == "--out") && (i + 1 < argc))
+			out_file = argv[++i];
+		else if ((arg == "--gen") && (i + 2 < argc))
+		{
+			gen_pattern = argv[++i];
+			convert_uint64_t(gen_accesses, argv[++i], "--gen");
+		}
+		else
+			usage(argv[0]);
+	}
+
+	// Read the ini file for the cache geometry (each benchmark builds its own HybridSystem).
+	bench.free_system(bench.new_system());
+	if (bench.footprint == 0)
+		bench.footprint = 4 * CACHE_PAGES * PAGE_SIZE;
+
+	if (!gen_pattern.empty())
+	{
+		TrafficGenerator gen(gen_pattern, bench.footprint, bench.write_fraction, 1);
+		for (uint64_t i = 0; i < gen_accesses; i++)
+		{
+			bool isWrite;
+			uint64_t addr;
+			gen.next(isWrite, addr);
+			cout << i * 10 << " " << (isWrite ? 1 : 0) << " " << addr << "\n";
+		}
+		return 0;
+	}
+
+	bench.out.open(out_file.c_str(), ios_base::out | ios_base::app);
+	if (!bench.out.is_open())
+	{
+		cerr << "ERROR: Failed to open " << out_file << "\n";
+		abort();
+	}
+
+	const char *patterns[] = {"sequential", "strided", "random", "zipf", "set_conflict"};
+	const int num_patterns = sizeof(patterns) / sizeof(patterns[0]);
+
+	if (bench.selected("trace_parse"))
+		bench.bench_trace_parse();
+	for (int i = 0; i < num_patterns; i++)
+		if (bench.selected(string("generator_") + patterns[i]))
+			bench.bench_generator(patterns[i]);
+	if (bench.selected("tag_lookup"))
+		bench.bench_tag_lookup();
+	if (bench.selected("victim_selection"))
+		bench.bench_victim_selection();
+	if (bench.selected("queue_handling"))
+		bench.bench_queue_handling();
+	uint64_t logger_depths[] = {1, 64, 4096};
+	for (uint64_t i = 0; i < 3; i++)
+	{
+		stringstream name;
+		name << "logger_queue_" << logger_depths[i];
+		if (bench.selected(name.str()))
+			bench.bench_logger_queue(logger_depths[i]);
+	}
+	// Sketch first, so its max_rss_kb is not hidden by the exact maps.
+	if (bench.selected("working_set_sketch"))
+		bench.bench_working_set("sketch");
+	if (bench.selected("working_set_exact"))
+		bench.bench_working_set("exact");
+	uint64_t stream_buffer_sizes[] = {16, 4096};
+	for (uint64_t i = 0; i < 2; i++)
+	{
+		stringstream name;
+		name << "stream_buffer_" << stream_buffer_sizes[i];
+		if (bench.selected(name.str()))
+			bench.bench_stream_buffer(stream_buffer_sizes[i]);
+	}
+	for (int i = 0; i < num_patterns; i++)
+		if (bench.selected(string("end_to_end_") + patterns[i]))
+			bench.bench_end_to_end(patterns[i]);
+	if (bench.selected("sync_all"))
+		bench.bench_sync_all();
+	if (bench.selected("sweep_memory"))
+		bench.bench_sweep_memory();
+
+	bench.out.close();
+	return 0;
+}
@@ -37,11 +37,7 @@
 
 #define SEQUENTIAL_PREFETCHING_WINDOW 0
 
-// Stream Buffer Setup.
-#define ENABLE_STREAM_BUFFER 1
-#define ONE_MISS_TABLE_SIZE 10
-#define NUM_STREAM_BUFFERS 10
-#define STREAM_BUFFER_LENGTH 4
+// Stream Buffer Debugging (the stream buffer itself is set up in the ini file).
 #define DEBUG_STREAM_BUFFER 0
 #define DEBUG_STREAM_BUFFER_HIT 0 // This generates a lot of stuff.
 
@@ -57,12 +53,6 @@
 // Outputs the victim selection process during each eviction. Goes to debug_victim.log.
 #define DEBUG_VICTIM 0		
 
-// Outputs the full trace of accesses sent to NVDIMM. Goes to nvdimm_trace.log.
-#define DEBUG_NVDIMM_TRACE 0
-
-// Outputs the full trace of accesses received by HybridSim. Goes to full_trace.log.
-#define DEBUG_FULL_TRACE 0
-
 
 // Map the first CACHE_PAGES of the NVDIMM address space.
 // This is the initial state of the hybrid memory on boot.
@@ -132,6 +122,7 @@ const uint64_t FOURGB = 4294967296; // 1024^3 * 4
 #include <utility>
 #include <assert.h>
 
+#ifndef ANALYTIC_ONLY
 // Include external interface for DRAMSim.
 #include <DRAMSim.h>
 
@@ -145,11 +136,28 @@ using DRAMSim::SimulatorObject;
 
 // Include external interface for NVDIMM.
 #include <NVDIMMSim.h>
+#else
+// ANALYTIC_ONLY builds do not use DRAMSim or NVDIMMSim at all (only the analytic backends are available),
+// so provide the SimulatorObject base class that normally comes from DRAMSim.
+class SimulatorObject
+{
+	public:
+	uint64_t currentClockCycle;
+
+	SimulatorObject() : currentClockCycle(0) {}
+	virtual ~SimulatorObject() {}
+	void step() { currentClockCycle++; }
+	virtual void update()=0;
+};
+#endif
 
 
 // Include the Transaction type (which is needed below).
 #include "Transaction.h"
 
+// Include the clock crossing helper for the backends.
+#include "ClockDomain.h"
+
 // Declare error printout (used to be brought in from DRAMSim).
 #define ERROR(str) std::cerr<<"[ERROR ("<<__FILE__<<":"<<__LINE__<<")]: "<<str<<std::endl;
 
@@ -169,6 +177,22 @@ extern uint64_t ENABLE_LOGGER;
 extern uint64_t EPOCH_LENGTH;
 extern uint64_t HISTOGRAM_BIN;
 extern uint64_t HISTOGRAM_MAX;
+extern uint64_t HISTOGRAM_PRECISION;
+extern string WORKING_SET_MODE;
+extern uint64_t WORKING_SET_HLL_BITS;
+extern uint64_t HOT_PAGES;
+extern uint64_t HOT_PAGE_SKETCH_WIDTH;
+extern uint64_t HOT_PAGE_SKETCH_DEPTH;
+extern string MISSED_PAGE_LOG;
+extern uint64_t MISSED_PAGE_BUFFER;
+extern string EPOCH_STATS;
+extern string LIVE_STATS;
+extern uint64_t LIVE_STATS_PERIOD;
+extern uint64_t TRANSACTION_TRACE_SAMPLE;
+extern uint64_t TRANSACTION_TRACE_BUFFER;
+extern string FULL_TRACE;
+extern string NVDIMM_TRACE;
+extern uint64_t DEBUG_TRACE_BUFFER;
 
 extern uint64_t PAGE_SIZE; // in bytes, so divide this by 64 to get the number of DDR3 transfers per page
 extern uint64_t SET_SIZE; // associativity of cache
@@ -184,6 +208,53 @@ extern uint64_t CACHE_PAGES; // 1 GB
 // Need to confirm this and make it more flexible later.
 extern uint64_t CYCLES_PER_SECOND;
 
+// Backend selection ("dramsim" or "analytic" for DRAM, "nvdimmsim" or "analytic" for flash)
+extern string DRAM_BACKEND;
+extern string FLASH_BACKEND;
+
+// Analytic backend parameters (latencies and transfer times are in backend clock cycles)
+extern uint64_t ANALYTIC_DRAM_READ_LATENCY;
+extern uint64_t ANALYTIC_DRAM_WRITE_LATENCY;
+extern uint64_t ANALYTIC_DRAM_TRANSFER_CYCLES;
+extern uint64_t ANALYTIC_DRAM_CHANNELS;
+extern uint64_t ANALYTIC_DRAM_QUEUE_DEPTH;
+extern uint64_t ANALYTIC_FLASH_READ_LATENCY;
+extern uint64_t ANALYTIC_FLASH_WRITE_LATENCY;
+extern uint64_t ANALYTIC_FLASH_TRANSFER_CYCLES;
+extern uint64_t ANALYTIC_FLASH_CHANNELS;
+extern uint64_t ANALYTIC_FLASH_QUEUE_DEPTH;
+
+// Backend clocks in Hz (0 means update once per controller cycle)
+extern uint64_t DRAM_CYCLES_PER_SECOND;
+extern uint64_t FLASH_CYCLES_PER_SECOND;
+
+// Flash thread (0 steps the NVDIMM on the controller thread)
+extern uint64_t FLASH_THREAD;
+
+// Stream buffer prefetcher
+extern uint64_t ENABLE_STREAM_BUFFER;
+extern uint64_t ONE_MISS_TABLE_SIZE;
+extern uint64_t NUM_STREAM_BUFFERS;
+extern uint64_t STREAM_BUFFER_LENGTH;
+extern uint64_t STREAM_BUFFER_MAX_LENGTH;
+extern uint64_t STREAM_BUFFER_MAX_STRIDE;
+extern uint64_t STREAM_BUFFER_DESCENDING;
+
+// Number of accesses at the start of the run to process in functional mode (cache warmup)
+extern uint64_t FUNCTIONAL_ACCESSES;
+
+// Sampled simulation in the trace based simulator (SAMPLING_PERIOD of 0 disables sampling)
+extern uint64_t SAMPLING_PERIOD;
+extern uint64_t SAMPLING_WARMUP;
+extern uint64_t SAMPLING_DETAILED;
+
+// Closed loop core model in the trace based simulator
+extern uint64_t CORES;
+extern uint64_t CORE_MLP;
+extern uint64_t CORE_DEPENDENT_READS;
+extern uint64_t CORE_LOOKAHEAD;
+extern string CORE_IPC_SCALE;
+
 // INI files
 extern string dram_ini;
 extern string flash_ini;
@@ -243,6 +314,10 @@ class cache_line
 		}
 };
 
+// Transactions made inside HybridSim (prefetches, flushes and syncs) get ids from this range so that they
+// never share an id with an access or with each other (see dram_pending).
+#define INTERNAL_ID_BASE (1ULL << 63)
+
 enum PendingOperation
 {
 	VICTIM_READ, // Read victim line from DRAM
@@ -257,6 +332,7 @@ class Pending
 {
 	public:
 	PendingOperation op; // What operation is being performed.
+	uint64_t id; // Transaction id of the access (from INTERNAL_ID_BASE up for internal transactions).
 	uint64_t orig_addr;
 	uint64_t flash_addr;
 	uint64_t cache_addr;
@@ -265,11 +341,23 @@ class Pending
 	bool callback_sent;
 	TransactionType type; // DATA_READ or DATA_WRITE
 
-	Pending() : op(VICTIM_READ), flash_addr(0), cache_addr(0), victim_tag(0), type(DATA_READ) {};
-        string str() { stringstream out; out << "O=" << op << " F=" << flash_addr << " C=" << cache_addr << " V=" << victim_tag 
+	Pending() : op(VICTIM_READ), id(0), flash_addr(0), cache_addr(0), victim_tag(0), type(DATA_READ) {};
+        string str() { stringstream out; out << "O=" << op << " I=" << id << " F=" << flash_addr << " C=" << cache_addr << " V=" << victim_tag 
 		<< " T=" << type; return out.str(); }
 };
 
+// Entries in the stream buffer table (keyed by the next page the stream is expected to miss on).
+class StreamBuffer
+{
+	public:
+	int64_t stride; // Bytes from one page of the stream to the next (negative for descending streams).
+	uint64_t depth; // Number of pages prefetched ahead of the stream.
+	uint64_t last_prefetch; // Furthest page prefetched so far.
+	uint64_t cycle; // When the stream was allocated or last hit.
+
+	StreamBuffer() : stride(0), depth(0), last_prefetch(0), cycle(0) {};
+};
+
 } // namespace HybridSim
 
 #endif
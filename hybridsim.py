@@ -51,6 +51,28 @@ class HybridSim(object):
 	def printLogfile(self):
 		lib.HybridSim_C_printLogfile(self.hs)
 
+	def setFunctional(self, accesses):
+		lib.HybridSim_C_setFunctional(self.hs, c_ulonglong(accesses))
+
+	def isFunctional(self):
+		return lib.HybridSim_C_isFunctional(self.hs)
+
+	def isQuiescent(self):
+		return lib.HybridSim_C_isQuiescent(self.hs)
+
+	def drain(self):
+		lib.HybridSim_C_drain.restype = c_ulonglong
+		cycles = lib.HybridSim_C_drain(self.hs)
+
+		self.handle_callbacks()
+		return cycles
+
+	def saveCheckpoint(self, filename):
+		lib.HybridSim_C_saveCheckpoint(self.hs, filename)
+
+	def loadCheckpoint(self, filename):
+		lib.HybridSim_C_loadCheckpoint(self.hs, filename)
+
 def read_cb(sysID, addr, cycle):
 	print 'cycle %d: read callback from sysID %d for addr = %d'%(cycle.value, sysID.value, addr.value)
 def write_cb(sysID, addr, cycle):
@@ -66,8 +88,7 @@ def main():
 	hs.addTransaction(1, 16)
 	hs.addTransaction(1, 24)
 
-	for i in range(100000):
-		hs.update()
+	hs.drain()
 
 	hs.WillAcceptTransaction()
 	hs.reportPower()
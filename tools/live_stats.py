@@ -0,0 +1,119 @@
+# Show the live statistics a running HybridSim publishes in shared memory (LIVE_STATS=NAME in the ini).
+#
+# Usage: python tools/live_stats.py NAME [--interval SECONDS] [--csv [--count N]]
+#
+# Without --csv the counters are redrawn every interval (1 second by default) until the run finishes.
+# With --csv one line is printed per interval (at most N lines with --count). The segment layout is
+# described in LiveStats.h.
+
+import mmap
+import os
+import struct
+import sys
+import time
+from collections import OrderedDict
+
+def attach(name):
+	path = '/dev/shm/' + name.lstrip('/')
+	try:
+		f = open(path, 'rb')
+	except IOError:
+		sys.stderr.write('ERROR: %s does not exist (is the simulator running with LIVE_STATS=%s?)\n' % (path, name.lstrip('/')))
+		sys.exit(1)
+	m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+	f.close()
+
+	if len(m) < 48 or m[0:8] != b'HSLIVE\0\0':
+		sys.stderr.write('ERROR: %s is not a HybridSim live statistics segment\n' % path)
+		sys.exit(1)
+	(version, sequence, num_values, names_offset, names_size) = struct.unpack_from('=5Q', m, 8)
+	if version != 1:
+		sys.stderr.write('ERROR: Unsupported live statistics version %d\n' % version)
+		sys.exit(1)
+	names = m[names_offset:names_offset + names_size].decode('ascii').split('\n')[:num_values]
+	return (m, names)
+
+def snapshot(m, num_values):
+	# Retry until the sequence number is the same even number before and after the copy (see LiveStats.h).
+	while True:
+		before = struct.unpack_from('=Q', m, 16)[0]
+		if before % 2 == 0:
+			values = struct.unpack_from('=%dQ' % num_values, m, 48)
+			after = struct.unpack_from('=Q', m, 16)[0]
+			if before == after:
+				return values
+		time.sleep(0.0001)
+
+def alive(pid):
+	try:
+		os.kill(pid, 0)
+	except OSError as e:
+		return e.errno == 1 # EPERM: it exists but belongs to someone else.
+	return True
+
+def ratio(a, b):
+	if b == 0:
+		return 0.0
+	return float(a) / b
+
+def show(name, s):
+	out = sys.stdout
+	out.write('\033[H\033[2J')
+	out.write('HybridSim %s (pid %d)%s\n\n' % (name, s['pid'], ' - finished' if s['finished'] else ''))
+	out.write('%-24s %d\n' % ('cycle', s['cycle']))
+	out.write('%-24s %d\n' % ('cycles_per_second', s['cycles_per_second']))
+	out.write('%-24s %.4f\n' % ('miss_rate', ratio(s['misses'], s['accesses'])))
+	out.write('%-24s %.1f\n' % ('average_latency', ratio(s['sum_latency'], s['accesses'])))
+	out.write('%-24s %.4f\n' % ('idle_fraction', ratio(s['idle_cycles'], s['cycle'])))
+	out.write('\n')
+	for key in s:
+		if key not in ('pid', 'finished', 'cycle', 'cycles_per_second'):
+			out.write('%-24s %d\n' % (key, s[key]))
+	out.flush()
+
+def main():
+	args = sys.argv[1:]
+	interval = 1.0
+	csv = False
+	count = 0
+	name = None
+	try:
+		while args:
+			a = args.pop(0)
+			if a == '--interval':
+				interval = float(args.pop(0))
+			elif a == '--csv':
+				csv = True
+			elif a == '--count':
+				count = int(args.pop(0))
+			elif name is None and not a.startswith('--'):
+				name = a
+			else:
+				raise ValueError(a)
+	except (IndexError, ValueError):
+		name = None
+	if name is None:
+		sys.stderr.write('Usage: %s NAME [--interval SECONDS] [--csv [--count N]]\n' % sys.argv[0])
+		sys.exit(1)
+
+	(m, names) = attach(name)
+	if csv:
+		sys.stdout.write(','.join(names) + '\n')
+
+	samples = 0
+	while True:
+		values = snapshot(m, len(names))
+		if csv:
+			sys.stdout.write(','.join([str(v) for v in values]) + '\n')
+			sys.stdout.flush()
+		else:
+			show(name, OrderedDict(zip(names, values)))
+		samples += 1
+		if values[names.index('finished')] or not alive(values[names.index('pid')]):
+			break
+		if count > 0 and samples >= count:
+			break
+		time.sleep(interval)
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,54 @@
+# Print a binary missed page record (hybridsim_misses.bin, written with MISSED_PAGE_LOG=binary) as text
+# in the same format as the Missed Page Data in hybridsim_epoch.log, or as CSV.
+#
+# Usage: python tools/read_miss_record.py hybridsim_misses.bin [--csv]
+#
+# The file format is described in MissRecord.h.
+
+import struct
+import sys
+
+def read_records(filename):
+	f = open(filename, 'rb')
+	header = f.read(40)
+	if len(header) != 40 or header[0:8] != b'HSMISSES':
+		sys.stderr.write('ERROR: %s is not a HybridSim missed page record\n' % filename)
+		sys.exit(1)
+	(version, page_size, num_sets, record_size) = struct.unpack('<4Q', header[8:40])
+	if version != 1 or record_size != 41:
+		sys.stderr.write('ERROR: Unsupported missed page record version %d (record size %d)\n' % (version, record_size))
+		sys.exit(1)
+
+	while True:
+		data = f.read(record_size)
+		if len(data) < record_size:
+			if len(data) > 0:
+				sys.stderr.write('WARNING: Ignoring a partial record at the end of %s\n' % filename)
+			break
+		(cycle, missed, victim, cache_set, cache_page) = struct.unpack('<5Q', data[0:40])
+		flags = struct.unpack('<B', data[40:41])[0]
+		yield (cycle, missed, victim, cache_set, cache_page, flags & 1, (flags >> 1) & 1, page_size, num_sets)
+	f.close()
+
+def tag(addr, page_size, num_sets):
+	return (addr // page_size) // num_sets
+
+def main():
+	if len(sys.argv) < 2 or len(sys.argv) > 3 or (len(sys.argv) == 3 and sys.argv[2] != '--csv'):
+		sys.stderr.write('Usage: %s hybridsim_misses.bin [--csv]\n' % sys.argv[0])
+		sys.exit(1)
+	csv = (len(sys.argv) == 3)
+
+	out = sys.stdout
+	if csv:
+		out.write('cycle,missed_page,victim_page,cache_set,missed_tag,victim_tag,cache_page,dirty,valid\n')
+	for (cycle, missed, victim, cache_set, cache_page, dirty, valid, page_size, num_sets) in read_records(sys.argv[1]):
+		if csv:
+			out.write('%d,0x%x,0x%x,%d,%d,%d,0x%x,%d,%d\n' % (cycle, missed, victim, cache_set, tag(missed, page_size, num_sets), 
+				tag(victim, page_size, num_sets), cache_page, dirty, valid))
+		else:
+			out.write('%d: missed= 0x%x; victim= 0x%x; set= %d; missed_tag= %d; victim_tag= %d; cache_page= 0x%x; dirty = %d; valid= %d;\n' % 
+				(cycle, missed, victim, cache_set, tag(missed, page_size, num_sets), tag(victim, page_size, num_sets), cache_page, dirty, valid))
+
+if __name__ == '__main__':
+	main()
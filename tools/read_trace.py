@@ -0,0 +1,43 @@
+# Print a binary debug trace (full_trace.bin or nvdimm_trace.bin, written with FULL_TRACE=binary or
+# NVDIMM_TRACE=binary) as text in the same format as FULL_TRACE=text, which the trace based simulator reads.
+#
+# Usage: python tools/read_trace.py full_trace.bin
+#
+# The file format is described in TraceWriter.h.
+
+import struct
+import sys
+
+def read_records(filename):
+	f = open(filename, 'rb')
+	header = f.read(24)
+	if len(header) != 24 or header[0:8] != b'HSTRACE\0':
+		sys.stderr.write('ERROR: %s is not a HybridSim binary trace\n' % filename)
+		sys.exit(1)
+	(version, record_size) = struct.unpack('<2Q', header[8:24])
+	if version != 1 or record_size != 17:
+		sys.stderr.write('ERROR: Unsupported trace version %d (record size %d)\n' % (version, record_size))
+		sys.exit(1)
+
+	while True:
+		data = f.read(record_size)
+		if len(data) < record_size:
+			if len(data) > 0:
+				sys.stderr.write('WARNING: Ignoring a partial record at the end of %s\n' % filename)
+			break
+		(cycle, address) = struct.unpack('<2Q', data[0:16])
+		flags = struct.unpack('<B', data[16:17])[0]
+		yield (cycle, flags & 1, address)
+	f.close()
+
+def main():
+	if len(sys.argv) != 2:
+		sys.stderr.write('Usage: %s full_trace.bin\n' % sys.argv[0])
+		sys.exit(1)
+
+	out = sys.stdout
+	for (cycle, write, address) in read_records(sys.argv[1]):
+		out.write('%d %d %d\n' % (cycle, write, address))
+
+if __name__ == '__main__':
+	main()
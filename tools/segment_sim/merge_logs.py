@@ -0,0 +1,176 @@
+# Merge the hybridsim.log files from several segment runs into one hybridsim.log.
+#
+# Each segment is a disjoint part of the trace (its warmup is run in functional mode, which is
+# not logged), so counters are summed, averages are weighted by the counts they are averaged
+# over, and rates and percentages are recomputed from the merged counters.
+#
+# Usage: python merge_logs.py output.log seg0/hybridsim.log seg1/hybridsim.log ...
+
+import sys
+
+# Keys that are summed.
+SUM_KEYS = ['total accesses', 'cycles', 'execution time', 'misses', 'hits', 'reads', 'writes',
+	'idle counter', 'flash idle counter', 'dram idle counter', 'MMIO Accesses Dropped', 'MMIO Accesses Remapped']
+
+# Averages and the counter (in the same section) that they are weighted by.
+AVERAGE_KEYS = {'average latency' : None, 'average queue latency' : None,
+	'average miss latency' : 'misses', 'average hit latency' : 'hits',
+	'throughput' : 'cycles', 'average queue length' : 'cycles'}
+
+# Percentages and the counter they are computed from (divided by cycles).
+PERCENT_KEYS = {'idle percentage' : 'idle counter', 'flash idle percentage' : 'flash idle counter',
+	'dram idle percentage' : 'dram idle counter'}
+
+# The counter for each section that the section's averages are weighted by.
+SECTION_COUNT = {'all' : 'total accesses', 'reads' : 'reads', 'writes' : 'writes'}
+
+def number(s):
+	s = s.split()[0]
+	if '.' in s or 'e' in s or 'n' in s:
+		return float(s)
+	return int(s)
+
+def parse_log(filename):
+	log = {'order' : [], 'values' : {}, 'pages' : {}, 'histogram_header' : [], 'histogram' : [], 'conflicts' : {}}
+	section = 'all'
+	part = 'summary'
+	for line in open(filename, 'r'):
+		line = line.rstrip('\n')
+		if line.startswith('====='):
+			part = None
+			continue
+		if line == 'Pages accessed:':
+			part = 'pages'
+			continue
+		if line == 'Latency Histogram:':
+			part = 'histogram'
+			continue
+		if line == 'Set Conflicts:':
+			part = 'conflicts'
+			continue
+		if line.strip() == '' or part is None:
+			continue
+
+		key, value = line.split(':', 1)
+		key = key.strip()
+		value = value.strip()
+		if part == 'summary':
+			if key == 'reads':
+				section = 'reads'
+			elif key == 'writes':
+				section = 'writes'
+			log['order'].append((section, key))
+			log['values'][(section, key)] = value
+		elif part == 'pages':
+			log['pages'][key] = log['pages'].get(key, 0) + number(value)
+		elif part == 'histogram':
+			if key.startswith('HISTOGRAM_'):
+				log['histogram_header'].append((key, value))
+			else:
+				log['histogram'].append((key, number(value)))
+		elif part == 'conflicts':
+			log['conflicts'][int(key)] = number(value)
+	return log
+
+def divide(a, b):
+	if b == 0:
+		return 0.0
+	return float(a) / b
+
+def merge(logs):
+	first = logs[0]
+	frequency = number(first['values'][('all', 'frequency')])
+	pages = {}
+	for log in logs:
+		for page in log['pages']:
+			pages[page] = pages.get(page, 0) + log['pages'][page]
+
+	def total(section, key):
+		return sum([number(log['values'][(section, key)]) for log in logs])
+
+	out = []
+	for (section, key) in first['order']:
+		value = first['values'][(section, key)]
+		if key in SUM_KEYS:
+			merged = total(section, key)
+			if key == 'execution time':
+				value = '%s us'%(merged)
+			else:
+				value = str(merged)
+		elif key == 'miss rate':
+			value = str(divide(total(section, 'misses'), total(section, SECTION_COUNT[section])))
+		elif key in AVERAGE_KEYS:
+			weight_key = AVERAGE_KEYS[key]
+			if weight_key is None:
+				weight_key = SECTION_COUNT[section]
+			weight_section = section
+			if weight_key == 'cycles':
+				weight_section = 'all'
+			weighted = sum([number(log['values'][(section, key)]) * number(log['values'][(weight_section, weight_key)]) for log in logs])
+			average = divide(weighted, total(weight_section, weight_key))
+			if 'latency' in key and 'queue length' not in key:
+				value = '%s cycles (%s us)'%(average, average / frequency * 1000000)
+			elif key == 'throughput':
+				value = '%s KB/s'%(average)
+			else:
+				value = str(average)
+		elif key in PERCENT_KEYS:
+			value = str(divide(total('all', PERCENT_KEYS[key]), total('all', 'cycles')))
+		elif key == 'max queue length':
+			value = str(max([number(log['values'][(section, key)]) for log in logs]))
+		elif key == 'working set size in pages':
+			value = str(len(pages))
+		elif key == 'working set size in bytes':
+			value = '%d bytes'%(len(pages) * number(first['values'][('all', 'page size')]))
+		out.append((section, key, value))
+
+	histogram = []
+	for i in range(len(first['histogram'])):
+		histogram.append((first['histogram'][i][0], sum([log['histogram'][i][1] for log in logs])))
+
+	conflicts = {}
+	for log in logs:
+		for s in log['conflicts']:
+			conflicts[s] = conflicts.get(s, 0) + log['conflicts'][s]
+
+	return out, pages, first['histogram_header'], histogram, conflicts
+
+def write_log(filename, merged):
+	out, pages, histogram_header, histogram, conflicts = merged
+	f = open(filename, 'w')
+	section = 'all'
+	for (s, key, value) in out:
+		if s != section:
+			f.write('\n')
+			section = s
+		f.write('%s: %s\n'%(key, value))
+	f.write('\n\n')
+
+	f.write('================================================================================\n\n')
+	f.write('Pages accessed:\n')
+	for page in pages:
+		f.write('%s : %d\n'%(page, pages[page]))
+	f.write('\n\n')
+
+	f.write('================================================================================\n\n')
+	f.write('Latency Histogram:\n\n')
+	for (key, value) in histogram_header:
+		f.write('%s: %s\n'%(key, value))
+	f.write('\n')
+	for (key, value) in histogram:
+		f.write('%s: %d\n'%(key, value))
+	f.write('\n\n')
+
+	f.write('================================================================================\n\n')
+	f.write('Set Conflicts:\n\n')
+	for s in sorted(conflicts.keys()):
+		f.write('%d: %d\n'%(s, conflicts[s]))
+	f.close()
+
+if __name__ == '__main__':
+	if len(sys.argv) < 3:
+		sys.stderr.write('Usage: '+sys.argv[0]+' output.log input1.log input2.log ...\n')
+		sys.exit(1)
+
+	logs = [parse_log(i) for i in sys.argv[2:]]
+	write_log(sys.argv[1], merge(logs))
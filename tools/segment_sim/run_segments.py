@@ -0,0 +1,78 @@
+# Simulate one trace as several segments in parallel and merge the results.
+#
+# The trace is indexed into chunks (HybridSim tracefile --build-index N), then each segment runs
+# a range of chunks in its own process and directory (seg_0, seg_1, ...). Each segment warms up
+# the cache with the chunks before it in functional mode, so segments overlap only in warmup.
+# The hybridsim.log files of the segments are merged into hybridsim.log with merge_logs.py.
+#
+# Run this from the directory you would normally run HybridSim in (so the ini files are found
+# the same way).
+#
+# Usage: python run_segments.py hybridsim_binary tracefile segments warmup_chunks [chunk_accesses] [jobs]
+
+import os
+import sys
+import subprocess
+
+import merge_logs
+
+if len(sys.argv) < 5:
+	sys.stderr.write('Usage: '+sys.argv[0]+' hybridsim_binary tracefile segments warmup_chunks [chunk_accesses] [jobs]\n')
+	sys.exit(1)
+
+hybridsim = os.path.abspath(sys.argv[1])
+tracefile = os.path.abspath(sys.argv[2])
+segments = int(sys.argv[3])
+warmup = int(sys.argv[4])
+chunk_accesses = 1000000
+if len(sys.argv) > 5:
+	chunk_accesses = int(sys.argv[5])
+jobs = segments
+if len(sys.argv) > 6:
+	jobs = int(sys.argv[6])
+
+base = os.getcwd()
+env = dict(os.environ)
+env['HYBRIDSIM_BASE'] = base
+
+# Build the index if needed.
+if not os.path.exists(tracefile+'.idx'):
+	subprocess.check_call([hybridsim, tracefile, '--build-index', str(chunk_accesses)], env=env)
+
+num_chunks = 0
+for line in open(tracefile+'.idx', 'r'):
+	if line.startswith('chunks '):
+		num_chunks = int(line.split()[1])
+if segments > num_chunks:
+	segments = num_chunks
+
+# Split the chunks as evenly as possible.
+ranges = []
+for i in range(segments):
+	first = (num_chunks * i) // segments
+	last = (num_chunks * (i + 1)) // segments - 1
+	ranges.append((first, last))
+
+# Run the segments, at most jobs at a time.
+running = []
+logs = []
+for i in range(segments):
+	seg_dir = os.path.join(base, 'seg_%d'%(i))
+	if not os.path.exists(seg_dir):
+		os.mkdir(seg_dir)
+	first, last = ranges[i]
+	cmd = [hybridsim, tracefile, '--chunks', str(first), str(last), '--warmup', str(warmup)]
+	out = open(os.path.join(seg_dir, 'out.txt'), 'w')
+	err = open(os.path.join(seg_dir, 'err.txt'), 'w')
+	print('Segment %d: chunks %d to %d'%(i, first, last))
+	running.append((i, subprocess.Popen(cmd, cwd=seg_dir, env=env, stdout=out, stderr=err)))
+	logs.append(os.path.join(seg_dir, 'hybridsim.log'))
+
+	while len(running) >= jobs or (i == segments - 1 and len(running) > 0):
+		seg, p = running.pop(0)
+		if p.wait() != 0:
+			sys.stderr.write('Segment %d failed (see seg_%d/err.txt)\n'%(seg, seg))
+			sys.exit(1)
+
+merge_logs.write_log(os.path.join(base, 'hybridsim.log'), merge_logs.merge([merge_logs.parse_log(i) for i in logs]))
+print('Merged %d segment logs into hybridsim.log'%(segments))